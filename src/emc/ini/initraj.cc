@@ -230,6 +230,16 @@ static int loadTraj(EmcIniFile *trajInifile)
         old_inihal_data.traj_arc_blend_tangent_kink_ratio = arcBlendTangentKinkRatio;
         //TODO update inihal
 
+        double maxJerk = 0.0;
+        trajInifile->Find(&maxJerk, "MAX_LINEAR_JERK", "TRAJ");
+
+        if (0 != emcSetMaxJerk(maxJerk)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcSetMaxJerk\n");
+            }
+            return -1;
+        }
+
         double maxFeedScale = 1.0;
         trajInifile->Find(&maxFeedScale, "MAX_FEED_OVERRIDE", "DISPLAY");
 
@@ -22,6 +22,7 @@
 
 #include <errno.h>
 #include <float.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +36,7 @@
 #include "motion_struct.h"
 #include "motion_types.h"
 #include "mot_priv.h"
+#include "rtapi_atomic.h"
 
 static struct motion_logger_data_t {
     hal_bit_t *reopen;
@@ -107,7 +109,7 @@ static int init_comm_buffers(void) {
     memset(emcmotStruct, 0, sizeof(emcmot_struct_t));
 
     /* we'll reference emcmotStruct directly */
-    c = &emcmotStruct->command;
+    c = &emcmotStruct->commands.slot[0];
     emcmotStatus = &emcmotStruct->status;
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
@@ -307,11 +309,8 @@ int main(int argc, char* argv[]) {
     init_comm_buffers();
 
     while (1) {
-        if (c->commandNum != c->tail) {
-            // "split read"
-            continue;
-        }
-        if (c->commandNum == emcmotStatus->commandNumEcho) {
+        emcmot_command_ring_t *ring = &emcmotStruct->commands;
+        if (ring->tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
             // nothing new
             maybe_reopen_logfile();
             usleep(10 * 1000);
@@ -322,6 +321,8 @@ int main(int argc, char* argv[]) {
         // new incoming command!
         //
 
+        c = &ring->slot[ring->tail % EMCMOT_COMMAND_RING_SIZE];
+
         emcmotStatus->head++;
 
         switch (c->command) {
@@ -666,6 +667,11 @@ int main(int argc, char* argv[]) {
                 log_print("SET_JOINT_COMP\n");
                 break;
 
+            case EMCMOT_LOAD_JOINT_COMP:
+                log_print("LOAD_JOINT_COMP joint=%d, entries=%d\n",
+                    c->joint, emcmotStruct->compStage.entries);
+                break;
+
             case EMCMOT_SET_OFFSET:
                 log_print(
                     "SET_OFFSET x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f u=%.6f, v=%.6f, w=%.6f\n",
@@ -683,6 +689,10 @@ int main(int argc, char* argv[]) {
                 log_print("SETUP_ARC_BLENDS\n");
                 break;
 
+            case EMCMOT_SET_MAX_JERK:
+                log_print("SET_MAX_JERK %.6f\n", c->maxJerk);
+                break;
+
             case EMCMOT_SET_PROBE_ERR_INHIBIT:
                 log_print("SETUP_SET_PROBE_ERR_INHIBIT %d %d\n",
                           c->probe_jog_err_inhibit,
@@ -700,7 +710,11 @@ int main(int argc, char* argv[]) {
         emcmotStatus->commandEcho = c->command;
         emcmotStatus->commandNumEcho = c->commandNum;
         emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
+        // no planner here, so the queue never fills
+        emcmotStatus->commandTail = ring->tail + 1;
+        emcmotStatus->queueRoom = INT_MAX;
         emcmotStatus->tail = emcmotStatus->head;
+        atomic_store_explicit(&ring->tail, ring->tail + 1, memory_order_release);
     }
 
     return 0;
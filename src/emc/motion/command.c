@@ -65,6 +65,7 @@
 #include "rtapi_math.h"
 #include "motion_types.h"
 #include "homing.h"
+#include "rtapi_atomic.h"
 
 #include "tp_debug.h"
 
@@ -400,11 +401,68 @@ STATIC int is_feed_type(int motion_type)
     }
 }
 
+/* replaces the comp table of a joint with the one in the shared memory
+   staging area.  Returns 0 on success, or -1 if the staged table is bad,
+   in which case the table in use is left alone. */
+static int load_joint_comp(emcmot_joint_t *joint, int joint_num)
+{
+    emcmot_comp_stage_t *stage = &emcmotStruct->compStage;
+    emcmot_comp_entry_t *comp_entry;
+    double dnom;
+    int n, entries;
+
+    entries = stage->entries;
+    if (entries < 0 || entries > EMCMOT_COMP_SIZE) {
+	reportError(_("joint %d: too many compensation entries"), joint_num);
+	return -1;
+    }
+    /* check everything before touching the table in use */
+    for (n = 1; n < entries; n++) {
+	if (stage->array[n].nominal <= stage->array[n - 1].nominal) {
+	    reportError(_("joint %d: compensation values must increase"), joint_num);
+	    return -1;
+	}
+    }
+    comp_entry = &(joint->comp.array[0]);
+    /* entry 0 stays at -DBL_MAX; copy the staged points after it */
+    for (n = 0; n < entries; n++) {
+	comp_entry[n + 1].nominal = stage->array[n].nominal;
+	comp_entry[n + 1].fwd_trim = stage->array[n].fwd_trim;
+	comp_entry[n + 1].rev_trim = stage->array[n].rev_trim;
+	comp_entry[n + 1].fwd_slope = 0.0;
+	comp_entry[n + 1].rev_slope = 0.0;
+    }
+    for (n = entries + 1; n < EMCMOT_COMP_SIZE + 2; n++) {
+	comp_entry[n].nominal = DBL_MAX;
+	comp_entry[n].fwd_trim = 0.0;
+	comp_entry[n].rev_trim = 0.0;
+	comp_entry[n].fwd_slope = 0.0;
+	comp_entry[n].rev_slope = 0.0;
+    }
+    /* the trim is constant below the first point and above the last,
+       same as a table built with EMCMOT_SET_JOINT_COMP */
+    comp_entry[0].fwd_trim = entries > 0 ? comp_entry[1].fwd_trim : 0.0;
+    comp_entry[0].rev_trim = entries > 0 ? comp_entry[1].rev_trim : 0.0;
+    comp_entry[0].fwd_slope = 0.0;
+    comp_entry[0].rev_slope = 0.0;
+    for (n = 1; n < entries; n++) {
+	dnom = comp_entry[n + 1].nominal - comp_entry[n].nominal;
+	comp_entry[n].fwd_slope =
+	    (comp_entry[n + 1].fwd_trim - comp_entry[n].fwd_trim) / dnom;
+	comp_entry[n].rev_slope =
+	    (comp_entry[n + 1].rev_trim - comp_entry[n].rev_trim) / dnom;
+    }
+    joint->comp.entries = entries;
+    /* compute_screw_comp() walks from here to the right entry */
+    joint->comp.entry = &(joint->comp.array[0]);
+    return 0;
+}
+
 /*
-  emcmotCommandHandler() is called each main cycle to read the
-  shared memory buffer
+  emcmotCommandRun() performs the single command that emcmotCommand
+  currently points at
   */
-void emcmotCommandHandler(void *arg, long period)
+static void emcmotCommandRun(void)
 {
     int joint_num, axis_num, spindle_num;
     int n;
@@ -416,11 +474,6 @@ void emcmotCommandHandler(void *arg, long period)
     int abort = 0;
     char* emsg = "";
 
-    /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
-	emcmotDebug->split++;
-	return;			/* not really an error */
-    }
     if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
 	/* increment head count-- we'll be modifying emcmotStatus */
 	emcmotStatus->head++;
@@ -1913,6 +1966,19 @@ void emcmotCommandHandler(void *arg, long period)
 	    joint->comp.entries++;
 	    break;
 
+	case EMCMOT_LOAD_JOINT_COMP:
+	    /* replace the whole comp table with the staged one */
+	    /* can be done at any time; the correction ramp in control.c
+	       smooths any step between the old and new tables */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "LOAD_JOINT_COMP for joint %d", joint_num);
+	    if (joint == 0) {
+		break;
+	    }
+	    if (load_joint_comp(joint, joint_num) != 0) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+	    }
+	    break;
+
         case EMCMOT_SET_OFFSET:
             emcmotStatus->tool_offset = emcmotCommand->tool_offset;
             break;
@@ -1982,6 +2048,9 @@ void emcmotCommandHandler(void *arg, long period)
             emcmotConfig->arcBlendRampFreq = emcmotCommand->arcBlendRampFreq;
             emcmotConfig->arcBlendTangentKinkRatio = emcmotCommand->arcBlendTangentKinkRatio;
             break;
+        case EMCMOT_SET_MAX_JERK:
+            emcmotConfig->maxJerk = emcmotCommand->maxJerk;
+            break;
         case EMCMOT_SET_PROBE_ERR_INHIBIT:
             emcmotConfig->inhibit_probe_jog_error = emcmotCommand->probe_jog_err_inhibit;
             emcmotConfig->inhibit_probe_home_error = emcmotCommand->probe_home_err_inhibit;
@@ -1991,6 +2060,11 @@ void emcmotCommandHandler(void *arg, long period)
 	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
 	    rtapi_print_msg(RTAPI_MSG_DBG, "ERROR: %d",
 		emcmotStatus->commandStatus);
+	    /* queued commands don't wait for their echo, so keep the
+	       failure around for user space to report */
+	    emcmotStatus->failNumEcho = emcmotCommand->commandNum;
+	    emcmotStatus->failId = emcmotCommand->id;
+	    emcmotStatus->failStatus = emcmotStatus->commandStatus;
 	}
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n");
 	/* synch tail count */
@@ -2003,3 +2077,27 @@ void emcmotCommandHandler(void *arg, long period)
 
     return;
 }
+
+/*
+  emcmotCommandHandler() is called each main cycle to drain the
+  command ring in shared memory.  At most EMCMOT_COMMAND_BATCH commands
+  are run per cycle so a burst of queued moves can't overrun the servo
+  period; the rest are picked up next cycle.
+  */
+void emcmotCommandHandler(void *arg, long period)
+{
+    emcmot_command_ring_t *ring = &emcmotStruct->commands;
+    unsigned int head, tail;
+    int n;
+
+    tail = ring->tail;
+    /* pairs with the release store in usrmotWriteEmcmotCommand(), so the
+       slots up to head are completely written before we look at them */
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for (n = 0; tail != head && n < EMCMOT_COMMAND_BATCH; n++, tail++) {
+	emcmotCommand = &ring->slot[tail % EMCMOT_COMMAND_RING_SIZE];
+	emcmotCommandRun();
+    }
+    /* acknowledge the whole batch at once; the slots may be reused now */
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+}
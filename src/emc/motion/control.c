@@ -15,6 +15,7 @@
 
 #include "posemath.h"
 #include "rtapi.h"
+#include "rtapi_atomic.h"
 #include "hal.h"
 #include "motion.h"
 #include "mot_priv.h"
@@ -23,6 +24,7 @@
 #include "tc.h"
 #include "simple_tp.h"
 #include "motion_debug.h"
+#include "motion_struct.h"
 #include "config.h"
 #include "motion_types.h"
 #include "homing.h"
@@ -2042,6 +2044,7 @@ static void update_status(void)
     emcmot_joint_status_t *joint_status;
     emcmot_axis_t *axis;
     emcmot_axis_status_t *axis_status;
+    unsigned int pending;
 #ifdef WATCH_FLAGS
     static int old_joint_flags[8];
     static int old_motion_flag;
@@ -2122,7 +2125,14 @@ static void update_status(void)
     //KLUDGE add an API call for this
     emcmotStatus->reverse_run = emcmotDebug->coord_tp.reverse_run;
     emcmotStatus->motionType = tpGetMotionType(&emcmotDebug->coord_tp);
-    emcmotStatus->queueFull = tcqFull(&emcmotDebug->coord_tp.queue);
+    /* moves still waiting in the command ring will land in the queue
+       too, so count them before calling it not full */
+    emcmotStatus->commandTail = emcmotStruct->commands.tail;
+    emcmotStatus->queueRoom = tcqRoom(&emcmotDebug->coord_tp.queue);
+    pending = atomic_load_explicit(&emcmotStruct->commands.head,
+	memory_order_relaxed) - emcmotStatus->commandTail;
+    emcmotStatus->queueFull = tcqFull(&emcmotDebug->coord_tp.queue)
+	|| pending >= (unsigned int) emcmotStatus->queueRoom;
 
     /* check to see if we should pause in order to implement
        single emcmotDebug->stepping */
@@ -62,10 +62,13 @@
 #define DEFAULT_DIO 4
 #define DEFAULT_AIO 4
 
-/* size of motion queue
- * a TC_STRUCT is about 512 bytes so this queue is
- * about a megabyte.  */
+/* default size of motion queue, set with motmod's tc_queue_size=
+ * a TC_STRUCT is about 600 bytes, plus another 600 per entry for the
+ * synched IO pool, so this queue is a bit over two megabytes.  */
 #define DEFAULT_TC_QUEUE_SIZE 2000
+/* the queue keeps up to 200 entries of history for reverse run and calls
+   itself full 20 entries early, so it must be comfortably larger than that */
+#define MIN_TC_QUEUE_SIZE 300
 
 /* max following error */
 #define DEFAULT_MAX_FERROR 100
@@ -61,6 +61,8 @@ RTAPI_MP_INT(num_aio, "number of analog inputs/outputs");
 
 static int unlock_joints_mask = 0;/* mask to select joints for unlock pins */
 RTAPI_MP_INT(unlock_joints_mask, "mask to select joints for unlock pins");
+static int tc_queue_size = DEFAULT_TC_QUEUE_SIZE; /* trajectory planner queue length */
+RTAPI_MP_INT(tc_queue_size, "number of motion segments the trajectory planner can queue");
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
 ************************************************************************/
@@ -89,7 +91,7 @@ emcmot_axis_t axis_array[EMCMOT_MAX_AXIS];
 
   emcmotStruct is ptr to this memory.
 
-  emcmotCommand points to emcmotStruct->command,
+  emcmotCommand points to the emcmotStruct->commands slot being run,
   emcmotStatus points to emcmotStruct->status,
   emcmotError points to emcmotStruct->error, and
  */
@@ -107,6 +109,10 @@ struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
 
 /* RTAPI shmem ID - for comms with higher level user space stuff */
 static int emc_shmem_id;	/* the shared memory ID */
+/* RTAPI shmem ID for the trajectory planner queue, sized at load time */
+static int tc_shmem_id = -1;
+static TC_STRUCT *queueTcSpace;	/* tc_queue_size + 10 entries, for safety */
+static syncdio_t *queueSyncdioSpace;	/* tc_queue_size entries */
 
 static int mot_comp_id;	/* component ID for motion module */
 
@@ -264,6 +270,13 @@ int rtapi_app_main(void)
 	return -1;
     }
 
+    if ( tc_queue_size < MIN_TC_QUEUE_SIZE ) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    _("MOTION: tc_queue_size is %d, must be at least %d\n"), tc_queue_size, MIN_TC_QUEUE_SIZE);
+	hal_exit(mot_comp_id);
+	return -1;
+    }
+
     /* initialize/export HAL pins and parameters */
     retval = init_hal_io();
     if (retval != 0) {
@@ -311,6 +324,13 @@ void rtapi_app_exit(void)
 	    _("MOTION: hal_stop_threads() failed, returned %d\n"), retval);
     }
     /* free shared memory */
+    if (tc_shmem_id >= 0) {
+	retval = rtapi_shmem_delete(tc_shmem_id, mot_comp_id);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		_("MOTION: rtapi_shmem_delete() failed, returned %d\n"), retval);
+	}
+    }
     retval = rtapi_shmem_delete(emc_shmem_id, mot_comp_id);
     if (retval < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -698,6 +718,7 @@ static int init_comm_buffers(void)
     int joint_num, axis_num, spindle_num, n;
     emcmot_joint_t *joint;
     int retval;
+    unsigned long tc_space_size;
 
     rtapi_print_msg(RTAPI_MSG_INFO, "MOTION: init_comm_buffers() starting...\n");
 
@@ -724,8 +745,28 @@ static int init_comm_buffers(void)
     /* zero shared memory before doing anything else. */
     memset(emcmotStruct, 0, sizeof(emcmot_struct_t));
 
+    /* the planner queue and its synched IO pool get a segment of their own,
+       so their size can be chosen at load time and user space does not
+       copy them along with the debug struct */
+    tc_space_size = (tc_queue_size + 10) * sizeof(TC_STRUCT)
+	+ tc_queue_size * sizeof(syncdio_t);
+    tc_shmem_id = rtapi_shmem_new(key + 1, mot_comp_id, tc_space_size);
+    if (tc_shmem_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: rtapi_shmem_new failed, returned %d\n", tc_shmem_id);
+	return -1;
+    }
+    retval = rtapi_shmem_getptr(tc_shmem_id, (void **) &queueTcSpace);
+    if (retval < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: rtapi_shmem_getptr failed, returned %d\n", retval);
+	return -1;
+    }
+    memset(queueTcSpace, 0, tc_space_size);
+    queueSyncdioSpace = (syncdio_t *) (queueTcSpace + tc_queue_size + 10);
+
     /* we'll reference emcmotStruct directly */
-    emcmotCommand = &emcmotStruct->command;
+    emcmotCommand = &emcmotStruct->commands.slot[0];
     emcmotStatus = &emcmotStruct->status;
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
@@ -734,17 +775,18 @@ static int init_comm_buffers(void)
     /* init error struct */
     emcmotErrorInit(emcmotError);
 
-    /* init command struct */
-    emcmotCommand->head = 0;
-    emcmotCommand->command = 0;
-    emcmotCommand->commandNum = 0;
-    emcmotCommand->tail = 0;
+    /* init command ring */
+    emcmotStruct->commands.head = 0;
+    emcmotStruct->commands.tail = 0;
 
     /* init status struct */
     emcmotStatus->head = 0;
     emcmotStatus->commandEcho = 0;
     emcmotStatus->commandNumEcho = 0;
     emcmotStatus->commandStatus = 0;
+    emcmotStatus->failNumEcho = 0;
+    emcmotStatus->failId = 0;
+    emcmotStatus->failStatus = EMCMOT_COMMAND_OK;
 
     /* init more stuff */
     emcmotDebug->head = 0;
@@ -872,8 +914,8 @@ static int init_comm_buffers(void)
     emcmotDebug->running_time = 0.0;
 
     /* init motion emcmotDebug->coord_tp */
-    if (-1 == tpCreate(&emcmotDebug->coord_tp, DEFAULT_TC_QUEUE_SIZE,
-	    emcmotDebug->queueTcSpace)) {
+    if (-1 == tpCreate(&emcmotDebug->coord_tp, tc_queue_size,
+	    queueTcSpace, queueSyncdioSpace)) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: failed to create motion emcmotDebug->coord_tp\n");
 	return -1;
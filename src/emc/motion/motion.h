@@ -187,6 +187,8 @@ extern "C" {
         EMCMOT_SET_AXIS_VEL_LIMIT,      /* set the max axis vel */
         EMCMOT_SET_AXIS_ACC_LIMIT,      /* set the max axis acc */
         EMCMOT_SET_AXIS_LOCKING_JOINT,  /* set the axis locking joint */
+        EMCMOT_SET_MAX_JERK,            /* jerk limit for coordinated moves */
+        EMCMOT_LOAD_JOINT_COMP,         /* replace a joint's compensation table with the staged one */
 
     } cmd_code_t;
 
@@ -209,8 +211,9 @@ extern "C" {
        COMMAND STRUCTURE
 *********************************/
 
-/* This is the command structure.  There is one of these in shared
-   memory, and all commands from higher level code come thru it.
+/* This is the command structure.  There is a ring of these in shared
+   memory (see emcmot_command_ring_t below), and all commands from higher
+   level code come thru it.
 */
     typedef struct emcmot_command_t {
 	unsigned char head;	/* flag count for mutex detect */
@@ -272,10 +275,30 @@ extern "C" {
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        double maxJerk;         /* 0 for trapezoidal velocity profiles */
 	double ext_offset_vel;	/* velocity for an external axis offset */
 	double ext_offset_acc;	/* acceleration for an external axis offset */
     } emcmot_command_t;
 
+/* Commands are passed from user space to motion through a single-producer,
+   single-consumer ring rather than a single mailbox.  User space fills
+   slot[head % EMCMOT_COMMAND_RING_SIZE] and then advances head; motion
+   runs up to EMCMOT_COMMAND_BATCH commands per servo period and advances
+   tail once the batch is done.  Motion queue commands (lines, arcs and
+   their settings) don't wait for their echo, so task can queue many short
+   segments per servo period.  A queued command that fails is recorded in
+   the status (failNumEcho, failId, failStatus) and reported by the next
+   write against its own command number and motion id.
+   EMCMOT_COMMAND_RING_SIZE must be a power of two. */
+#define EMCMOT_COMMAND_RING_SIZE 64
+#define EMCMOT_COMMAND_BATCH 32
+
+    typedef struct emcmot_command_ring_t {
+	unsigned int head;	/* next slot to fill, written by user space */
+	unsigned int tail;	/* next slot to run, written by motion */
+	emcmot_command_t slot[EMCMOT_COMMAND_RING_SIZE];
+    } emcmot_command_ring_t;
+
 /*! \todo FIXME - these packed bits might be replaced with chars
    memory is cheap, and being able to access them without those
    damn macros would be nice
@@ -397,7 +420,7 @@ Suggestion: Split this in to an Error and a Status flag register..
     } emcmot_comp_entry_t; 
 
 
-#define EMCMOT_COMP_SIZE 256
+#define EMCMOT_COMP_SIZE 1024
     typedef struct {
 	int entries;		/* number of entries in the array */
 	emcmot_comp_entry_t *entry;  /* current entry in array */
@@ -405,6 +428,15 @@ Suggestion: Split this in to an Error and a Status flag register..
 	/* +2 because array has -HUGE_VAL and +HUGE_VAL entries at the ends */
     } emcmot_comp_t;
 
+/* staging area in shared memory for a whole compensation table.  User
+   space fills it in and issues EMCMOT_LOAD_JOINT_COMP, which swaps the
+   table into the joint in one servo period.  The slopes are computed by
+   motion; only nominal, fwd_trim and rev_trim need to be filled in. */
+    typedef struct emcmot_comp_stage_t {
+	int entries;		/* number of valid entries in array */
+	emcmot_comp_entry_t array[EMCMOT_COMP_SIZE];
+    } emcmot_comp_stage_t;
+
 /* motion controller states */
 
     typedef enum {
@@ -603,6 +635,9 @@ Suggestion: Split this in to an Error and a Status flag register..
 	cmd_code_t commandEcho;	/* echo of input command */
 	int commandNumEcho;	/* echo of input command number */
 	cmd_status_t commandStatus;	/* result of most recent command */
+	int failNumEcho;	/* number of the last command that failed */
+	int failId;		/* its motion id */
+	cmd_status_t failStatus;	/* and the status it failed with */
 	/* these are config info, updated when a command changes them */
 	double feed_scale;	/* velocity scale factor for all motion but rapids */
 	double rapid_scale;	/* velocity scale factor for rapids */
@@ -653,6 +688,8 @@ Suggestion: Split this in to an Error and a Status flag register..
 	int depth;		/* motion queue depth */
 	int activeDepth;	/* depth of active blend elements */
 	int queueFull;		/* Flag to indicate the tc queue is full */
+	int queueRoom;		/* tc queue entries left before it is full */
+	unsigned int commandTail;	/* command ring tail behind depth */
 	int paused;		/* Flag to signal motion paused */
 	int overrideLimitMask;	/* non-zero means one or more limits ignored */
 				/* 1 << (joint-num*2) = ignore neg limit */
@@ -742,6 +779,7 @@ Suggestion: Split this in to an Error and a Status flag register..
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        double maxJerk;         /* 0 for trapezoidal velocity profiles */
         int inhibit_probe_jog_error;
         int inhibit_probe_home_error;
     } emcmot_config_t;
@@ -17,6 +17,7 @@
 #include <stdlib.h>		/* exit() */
 #include <sys/stat.h>
 #include <string.h>		/* memcpy() */
+#include <stdint.h>		/* int32_t */
 #include <float.h>		/* DBL_MIN */
 #include "motion.h"		/* emcmot_status_t,CMD */
 #include "motion_debug.h"       /* emcmot_debug_t */
@@ -33,13 +34,13 @@
 #define READ_TIMEOUT_USEC 100000	/* microseconds for timeout */
 
 #include "rtapi.h"
+#include "rtapi_atomic.h"
 
 #include "dbuf.h"
 #include "stashf.h"
 
 static int inited = 0;		/* flag if inited */
 
-static emcmot_command_t *emcmotCommand = 0;
 static emcmot_status_t *emcmotStatus = 0;
 static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
@@ -71,12 +72,49 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
+/* Motion queue commands only append to the planner queue, so there's no
+   need to wait for motion to echo them.  Returns nonzero if c may be left
+   in the command ring without waiting. */
+static int usrmotCommandIsQueued(const emcmot_command_t * c)
+{
+    switch (c->command) {
+    case EMCMOT_SET_LINE:
+    case EMCMOT_SET_CIRCLE:
+    case EMCMOT_SET_VEL:
+    case EMCMOT_SET_ACC:
+    case EMCMOT_SET_TERM_COND:
+    case EMCMOT_SET_SPINDLESYNC:
+	return 1;
+    case EMCMOT_SET_DOUT:
+    case EMCMOT_SET_AOUT:
+	/* synched outputs are queued with the next move */
+	return !c->now;
+    default:
+	return 0;
+    }
+}
+
+/* reports a queued command that failed since the last write, if any */
+static int usrmotCheckQueuedFailure(const emcmot_status_t * s, int *failNum)
+{
+    if (s->failNumEcho == *failNum) {
+	return 0;
+    }
+    *failNum = s->failNumEcho;
+    rcs_print("USRMOT: ERROR: command %d (motion id %d) failed (%d)\n",
+	s->failNumEcho, s->failId, s->failStatus);
+    return 1;
+}
+
 /* writes command from c */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 {
     emcmot_status_t s;
+    emcmot_command_ring_t *ring;
     static int commandNum = 0;
+    static int failNum = 0;
     static unsigned char headCount = 0;
+    unsigned int head;
     double end;
 
     if (!MOTION_ID_VALID(c->id)) {
@@ -88,26 +126,51 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     c->commandNum = ++commandNum;
 
     /* check for mapped mem still around */
-    if (0 == emcmotCommand) {
+    if (0 == emcmotStruct) {
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
-    /* copy entire command structure to shared memory */
-    *emcmotCommand = *c;
-    /* poll for receipt of command */
+    ring = &emcmotStruct->commands;
     /* set timeout for comm failure, now + timeout */
     end = etime() + EMCMOT_COMM_TIMEOUT;
-    /* now check to see if it got it */
+    /* wait for motion to free a slot; we are the only writer of head */
+    head = ring->head;
+    while (head - rtapi_atomic_load_acquire(&ring->tail)
+	    >= EMCMOT_COMMAND_RING_SIZE) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command ring full\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    /* copy entire command structure to shared memory, then publish it */
+    ring->slot[head % EMCMOT_COMMAND_RING_SIZE] = *c;
+    rtapi_atomic_store_release(&ring->head, head + 1);
+
+    if (usrmotCommandIsQueued(c)) {
+	/* an earlier queued command may have failed; report it against
+	   its own number and motion id, not this one */
+	if (usrmotReadEmcmotStatus(&s) == 0
+		&& usrmotCheckQueuedFailure(&s, &failNum)) {
+	    return EMCMOT_COMM_ERROR_COMMAND;
+	}
+	return EMCMOT_COMM_OK;
+    }
+    /* poll for receipt of command; since the ring is run in order this
+       also acknowledges every command queued before it */
     while (etime() < end) {
 	/* update status */
 	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
 	    /* now check emcmot status flag */
-	    if (s.commandStatus == EMCMOT_COMMAND_OK) {
-		return EMCMOT_COMM_OK;
-	    } else {
+	    if (s.commandStatus != EMCMOT_COMMAND_OK) {
                 rcs_print("USRMOT: ERROR: invalid command\n");
+		failNum = s.failNumEcho;
 		return EMCMOT_COMM_ERROR_COMMAND;
 	    }
+	    if (usrmotCheckQueuedFailure(&s, &failNum)) {
+		return EMCMOT_COMM_ERROR_COMMAND;
+	    }
+	    return EMCMOT_COMM_OK;
 	}
 	esleep(25e-6);
     }
@@ -119,6 +182,7 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 int usrmotReadEmcmotStatus(emcmot_status_t * s)
 {
     int split_read_count;
+    unsigned int pending;
     
     /* check for shmem still around */
     if (0 == emcmotStatus) {
@@ -130,7 +194,15 @@ int usrmotReadEmcmotStatus(emcmot_status_t * s)
 	memcpy(s, emcmotStatus, sizeof(emcmot_status_t));
 	/* got it, now check head-tail matche */
 	if (s->head == s->tail) {
-	    /* head and tail match, done */
+	    /* head and tail match, done.  Commands written since motion
+	       took this status haven't reached the planner yet; count them
+	       as motion still to do, and against the room left in the queue,
+	       so nobody sees an empty or a not-full queue early */
+	    pending = emcmotStruct->commands.head - s->commandTail;
+	    s->depth += pending;
+	    if (pending >= (unsigned int) s->queueRoom) {
+		s->queueFull = 1;
+	    }
 	    return EMCMOT_COMM_OK;
 	}
 	/* inc counter and try again, max three times */
@@ -663,7 +735,6 @@ int usrmotInit(const char *modname)
 	return -1;
     }
     /* got it */
-    emcmotCommand = &(emcmotStruct->command);
     emcmotStatus = &(emcmotStruct->status);
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
@@ -682,7 +753,6 @@ int usrmotExit(void)
     }
 
     emcmotStruct = 0;
-    emcmotCommand = 0;
     emcmotStatus = 0;
     emcmotError = 0;
 /*! \todo Another #if 0 */
@@ -697,18 +767,60 @@ int usrmotExit(void)
     return 0;
 }
 
+/* Binary compensation files start with this 8 byte magic, followed by
+   the number of triplets as a native 32 bit integer and then that many
+   triplets of native doubles.  The triplets mean the same as the lines of
+   a text file of the same type. */
+#define COMP_BINARY_MAGIC "LCNCCMP1"
+#define COMP_BINARY_MAGIC_LEN 8
+
+/* reads the triplets of a binary comp file into stage, returns the
+   number read or -1 on error */
+static int usrmotReadBinaryComp(FILE *fp, const char *file,
+				emcmot_comp_stage_t *stage, int type)
+{
+    int32_t count;
+    double triplet[3];
+    int n;
+
+    if (1 != fread(&count, sizeof(count), 1, fp)) {
+	fprintf(stderr, "truncated compensation file %s\n", file);
+	return -1;
+    }
+    if (count < 0 || count > EMCMOT_COMP_SIZE) {
+	fprintf(stderr, "too many compensation entries in %s (%d, max %d)\n",
+		file, (int)count, EMCMOT_COMP_SIZE);
+	return -1;
+    }
+    for (n = 0; n < count; n++) {
+	if (1 != fread(triplet, sizeof(triplet), 1, fp)) {
+	    fprintf(stderr, "truncated compensation file %s\n", file);
+	    return -1;
+	}
+	stage->array[n].nominal = triplet[0];
+	stage->array[n].fwd_trim = type == 0 ? triplet[0] - triplet[1] : triplet[1];
+	stage->array[n].rev_trim = type == 0 ? triplet[0] - triplet[2] : triplet[2];
+    }
+    return count;
+}
+
 /* Loads pairs of comp from the compensation file.
    The default way is to specify nominal, forward & reverse triplets in the file
    However if type != 0, it expects nominal, forward_trim & reverse_trim 
 	(where forward_trim = nominal - forward
 	       reverse_trim = nominal - reverse)
+   The file may be text, one triplet per line, or binary (see
+   COMP_BINARY_MAGIC).  The whole table is put in the shared memory staging
+   area and handed to motion with a single command, replacing any table
+   the joint had before.
 */
 int usrmotLoadComp(int joint, const char *file, int type)
 {
     FILE *fp;
     char buffer[LINELEN];
     double nom, fwd, rev;
-    int ret = 0;
+    int n = 0;
+    emcmot_comp_stage_t *stage;
     emcmot_command_t emcmotCommand;
 
     /* check joint range */
@@ -716,6 +828,12 @@ int usrmotLoadComp(int joint, const char *file, int type)
 	fprintf(stderr, "joint out of range for compensation\n");
 	return -1;
     }
+    /* check for mapped mem still around */
+    if (0 == emcmotStruct) {
+	fprintf(stderr, "can't connect to shared memory\n");
+	return -1;
+    }
+    stage = &emcmotStruct->compStage;
 
     /* open input comp file */
     if (NULL == (fp = fopen(file, "r"))) {
@@ -723,36 +841,52 @@ int usrmotLoadComp(int joint, const char *file, int type)
 	return -1;
     }
 
-    while (!feof(fp)) {
-	if (NULL == fgets(buffer, LINELEN, fp)) {
-	    break;
-	}
-	if (3 != sscanf(buffer, "%lf %lf %lf", &nom, &fwd, &rev)) {
-	    break;
-	} else {
+    if (COMP_BINARY_MAGIC_LEN == fread(buffer, 1, COMP_BINARY_MAGIC_LEN, fp)
+	    && 0 == memcmp(buffer, COMP_BINARY_MAGIC, COMP_BINARY_MAGIC_LEN)) {
+	n = usrmotReadBinaryComp(fp, file, stage, type);
+    } else {
+	rewind(fp);
+	while (!feof(fp)) {
+	    if (NULL == fgets(buffer, LINELEN, fp)) {
+		break;
+	    }
+	    if (3 != sscanf(buffer, "%lf %lf %lf", &nom, &fwd, &rev)) {
+		break;
+	    }
 	    // got a triplet
+	    if (n >= EMCMOT_COMP_SIZE) {
+		fprintf(stderr, "too many compensation entries in %s (max %d)\n",
+			file, EMCMOT_COMP_SIZE);
+		n = -1;
+		break;
+	    }
 	    if (type == 0) {
 		/* expecting nominal-forward-reverse triplets, e.g., 
 		    0.000000 0.000000 -0.001279 
 		    0.100000 0.098742  0.051632 
 		    0.200000 0.171529  0.194216 */
-    		emcmotCommand.comp_nominal = nom;
-    		emcmotCommand.comp_forward = nom - fwd; //convert to diffs
-    		emcmotCommand.comp_reverse = nom - rev; //convert to diffs
+		stage->array[n].nominal = nom;
+		stage->array[n].fwd_trim = nom - fwd; //convert to diffs
+		stage->array[n].rev_trim = nom - rev; //convert to diffs
 	    } else {
 		/* expecting nominal-forw_trim-rev_trim triplets */
-    		emcmotCommand.comp_nominal = nom;
-    		emcmotCommand.comp_forward = fwd;
-    		emcmotCommand.comp_reverse = rev;		
+		stage->array[n].nominal = nom;
+		stage->array[n].fwd_trim = fwd;
+		stage->array[n].rev_trim = rev;
 	    }
-	    emcmotCommand.joint = joint;
-	    emcmotCommand.command = EMCMOT_SET_JOINT_COMP;
-	    ret |= usrmotWriteEmcmotCommand(&emcmotCommand);
+	    n++;
 	}
     }
     fclose(fp);
+    if (n < 0) {
+	return -1;
+    }
 
-    return ret;
+    stage->entries = n;
+    memset(&emcmotCommand, 0, sizeof(emcmotCommand));
+    emcmotCommand.joint = joint;
+    emcmotCommand.command = EMCMOT_LOAD_JOINT_COMP;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
 
@@ -17,12 +17,13 @@
 
 
 #include <string.h>		/* memcpy() */
+#include <stddef.h>		/* offsetof() */
+#include <stdlib.h>		/* malloc(), free() */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"
 #include "interpl.hh"		// these decls
 #include "emc.hh"
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
@@ -30,7 +31,12 @@ NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    ring = NULL;
+    ring_size = 0;
+    start = head = tail = 0;
+    held = false;
+    retired = NULL;
+    list_size = 0;
 
     next_line_number = 0;
     line_number = 0;
@@ -38,10 +44,10 @@ NML_INTERP_LIST::NML_INTERP_LIST()
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
-    }
+    free(ring);
+    ring = NULL;
+    free(retired);
+    retired = NULL;
 }
 
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
@@ -57,6 +63,58 @@ int NML_INTERP_LIST::set_line_number(int line)
     return 0;
 }
 
+// node at an offset in the ring, following the wrap back to the start
+NML_INTERP_LIST_NODE *NML_INTERP_LIST::node_at(long offset)
+{
+    if (offset >= ring_size ||
+	((NML_INTERP_LIST_NODE *) (ring + offset))->node_size == 0) {
+	offset = 0;
+    }
+    return (NML_INTERP_LIST_NODE *) (ring + offset);
+}
+
+// Move the queued nodes to the start of a larger ring. The node from get()
+// stays where it is, so the old ring is kept until the next get().
+int NML_INTERP_LIST::grow(long needed)
+{
+    long new_size = ring_size ? ring_size * 2 : NML_INTERP_LIST_RING_SIZE;
+    while (new_size < needed) {
+	new_size *= 2;
+    }
+
+    char *new_ring = (char *) malloc(new_size);
+    if (NULL == new_ring) {
+	rcs_print_error("NML_INTERP_LIST::append : out of memory\n");
+	return -1;
+    }
+
+    long offset = head;
+    long new_tail = 0;
+    for (int i = 0; i < list_size; i++) {
+	NML_INTERP_LIST_NODE *node_ptr = node_at(offset);
+	memcpy(new_ring + new_tail, node_ptr, node_ptr->node_size);
+	new_tail += node_ptr->node_size;
+	offset = ((char *) node_ptr - ring) + node_ptr->node_size;
+    }
+
+    if (held) {
+	free(retired);
+	retired = ring;
+    } else {
+	free(ring);
+    }
+    ring = new_ring;
+    ring_size = new_size;
+    start = head = 0;
+    tail = new_tail;
+    held = false;
+
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+	rcs_print("NML_INTERP_LIST(%p)::grow(): ring size=%ld\n", this, ring_size);
+    }
+    return 0;
+}
+
 int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 {
     /* check for invalid data */
@@ -82,39 +140,56 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	    ("NML_INTERP_LIST::append : command size is invalid.");
 	return -1;
     }
-#ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
-	rcs_print_error
-	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
-	return -1;
+
+    long node_size = offsetof(NML_INTERP_LIST_NODE, command) + nml_msg_ptr->size;
+    node_size = (node_size + NML_INTERP_LIST_ALIGN - 1) & ~(long) (NML_INTERP_LIST_ALIGN - 1);
+
+    if (0 == list_size && !held) {
+	start = head = tail = 0;
     }
-#endif
 
-    if (NULL == linked_list_ptr) {
-	return -1;
+    // find room after the tail, or wrap around to the front of the ring
+    bool empty = (0 == list_size && !held);
+    if (NULL == ring) {
+	if (0 != grow(node_size)) {
+	    return -1;
+	}
+    } else if (tail > start || empty) {
+	if (tail + node_size > ring_size) {
+	    if (node_size > start) {
+		if (0 != grow(tail - start + node_size)) {
+		    return -1;
+		}
+	    } else {
+		if (tail < ring_size) {
+		    ((NML_INTERP_LIST_NODE *) (ring + tail))->node_size = 0;
+		}
+		if (head == tail) {
+		    head = 0;
+		}
+		tail = 0;
+	    }
+	}
+    } else if (tail + node_size > start) {
+	if (0 != grow(ring_size + node_size)) {
+	    return -1;
+	}
     }
-    // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
 
-    // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    // fill in the NML_INTERP_LIST_NODE in place
+    NML_INTERP_LIST_NODE *node_ptr = (NML_INTERP_LIST_NODE *) (ring + tail);
+    node_ptr->line_number = next_line_number;
+    node_ptr->node_size = node_size;
+    memcpy(node_ptr->command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    tail += node_size;
+    list_size++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
 	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     list_size, node_ptr->line_number);
     }
 
     return 0;
@@ -125,17 +200,23 @@ NMLmsg *NML_INTERP_LIST::get()
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
 
-    if (NULL == linked_list_ptr) {
+    // the caller is done with the node from the last get()
+    free(retired);
+    retired = NULL;
+    held = false;
+    start = head;
+
+    if (0 == list_size) {
 	line_number = 0;
 	return NULL;
     }
 
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
+    node_ptr = node_at(head);
+    start = (char *) node_ptr - ring;
+    head = start + node_ptr->node_size;
+    held = true;
+    list_size--;
 
-    if (NULL == node_ptr) {
-	line_number = 0;
-	return NULL;
-    }
     // save line number of this one, for use by get_line_number
     line_number = node_ptr->line_number;
 
@@ -148,7 +229,7 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            list_size
         );
     }
 
@@ -157,45 +238,36 @@ NMLmsg *NML_INTERP_LIST::get()
 
 void NML_INTERP_LIST::clear()
 {
-    if (NULL != linked_list_ptr) {
-        if (emc_debug & EMC_DEBUG_INTERP_LIST) {
-            rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, linked_list_ptr->list_size);
-        }
-
-	linked_list_ptr->delete_members();
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+        rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, list_size);
     }
+
+    // the node from get() stays valid, as with the old linked list
+    list_size = 0;
+    head = tail;
 }
 
 void NML_INTERP_LIST::print()
 {
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
-    int line_number;
+    long offset = head;
 
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
-
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
-    while (NULL != node_ptr) {
-	line_number = node_ptr->line_number;
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n", list_size);
+    for (int i = 0; i < list_size; i++) {
+	node_ptr = node_at(offset);
 	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
-		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+		  node_ptr->line_number);
+	offset = ((char *) node_ptr - ring) + node_ptr->node_size;
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
-
-    return ((int) linked_list_ptr->list_size);
+    return list_size;
 }
 
 int NML_INTERP_LIST::get_line_number()
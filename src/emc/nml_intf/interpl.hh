@@ -21,9 +21,16 @@
 
 #define MAX_NML_COMMAND_SIZE 1000
 
-// these go on the interp list
+// initial size of the ring the interp list stores its commands in; it
+// grows if a program queues more than this
+#define NML_INTERP_LIST_RING_SIZE (256 * 1024)
+#define NML_INTERP_LIST_ALIGN 16
+
+// these go on the interp list, taking up only as much of the node as the
+// command needs (rounded up to NML_INTERP_LIST_ALIGN)
 struct NML_INTERP_LIST_NODE {
     int line_number;		// line number it was on
+    int node_size;		// bytes used in the ring, 0 marks a wrap
     union _dummy_union {
 	int32_t i;
 	int32_t l;
@@ -60,9 +67,22 @@ class NML_INTERP_LIST {
     int len();
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
-    int next_line_number;	// line number used to fill temp_node
+    NML_INTERP_LIST_NODE *node_at(long offset);
+    int grow(long needed);
+
+    // Commands are stored in place in a ring buffer, so appending and
+    // getting don't allocate once the ring is big enough. The node from
+    // get() stays valid until the next get(), as the caller may still
+    // be executing it.
+    char *ring;
+    long ring_size;
+    long start;			// oldest byte in use, the node from get() if held
+    long head;			// next node for get()
+    long tail;			// where the next append goes
+    bool held;			// node from get() is still in the ring at start
+    char *retired;		// smaller ring holding the node from get()
+    int list_size;
+    int next_line_number;	// line number used for appended nodes
     int line_number;		// line number of node from get()
 };
 
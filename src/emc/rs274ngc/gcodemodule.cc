@@ -18,6 +18,11 @@
 
 #include <Python.h>
 #include <structmember.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "rs274ngc.hh"
 #include "rs274ngc_interp.hh"
@@ -137,6 +142,661 @@ static PyTypeObject LineCodeType = {
     0,                      /*tp_is_gc*/
 };
 
+static void unrotate(double &x, double &y, double c, double s) {
+    double tx = x * c + y * s;
+    y = -x * s + y * c;
+    x = tx;
+}
+
+static void rotate(double &x, double &y, double c, double s) {
+    double tx = x * c - y * s;
+    y = x * s + y * c;
+    x = tx;
+}
+
+// Break an arc starting at the (translated) point lo into straight segments;
+// the end points of the segments are appended to points, nine per segment.
+static void arc_points(std::vector<double> &points, const double lo[9],
+        const double g5xoffset[9], const double g92offset[9],
+        double rotation_cos, double rotation_sin, int plane,
+        double x1, double y1, double cx, double cy, int rot, double z1,
+        double a, double b, double c, double u, double v, double w,
+        int max_segments) {
+    double o[9], n[9];
+    int X, Y, Z;
+
+    if(plane == 1) {
+        X=0; Y=1; Z=2;
+    } else if(plane == 3) {
+        X=2; Y=0; Z=1;
+    } else {
+        X=1; Y=2; Z=0;
+    }
+    n[X] = x1;
+    n[Y] = y1;
+    n[Z] = z1;
+    n[3] = a;
+    n[4] = b;
+    n[5] = c;
+    n[6] = u;
+    n[7] = v;
+    n[8] = w;
+    for(int ax=0; ax<9; ax++) o[ax] = lo[ax] - g5xoffset[ax];
+    unrotate(o[0], o[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
+
+    double theta1 = atan2(o[Y]-cy, o[X]-cx);
+    double theta2 = atan2(n[Y]-cy, n[X]-cx);
+
+    if(rot < 0) {
+        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+
+    // if multi-turn, add the right number of full circles
+    if(rot < -1) theta2 += 2*M_PI*(rot+1);
+    if(rot > 1) theta2 += 2*M_PI*(rot-1);
+
+    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
+    double rsteps = 1. / steps;
+
+    double dtheta = theta2 - theta1;
+    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[Z] = n[Z] - o[Z];
+
+    points.reserve(points.size() + 9 * steps);
+    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
+    for(int i=0; i<steps-1; i++) {
+        double f = (i+1) * rsteps;
+        double p[9];
+        rotate(tx, ty, dc, ds);
+        p[X] = tx + cx;
+        p[Y] = ty + cy;
+        p[Z] = o[Z] + d[Z] * f;
+        p[3] = o[3] + d[3] * f;
+        p[4] = o[4] + d[4] * f;
+        p[5] = o[5] + d[5] * f;
+        p[6] = o[6] + d[6] * f;
+        p[7] = o[7] + d[7] * f;
+        p[8] = o[8] + d[8] * f;
+        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
+        rotate(p[0], p[1], rotation_cos, rotation_sin);
+        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+        points.insert(points.end(), p, p+9);
+    }
+    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
+    rotate(n[0], n[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
+    points.insert(points.end(), n, n+9);
+}
+
+// Native preview: when the canon object passed to parse() has a "preview"
+// attribute holding a gcode.preview, motion and per-line state are
+// accumulated into packed arrays here instead of being delivered one Python
+// call at a time.  The canon still receives the rare events (offsets, tool
+// changes, comments, ...), preceded by next_line when the line has changed.
+struct preview_segment {
+    double start[9];
+    double end[9];
+    double feedrate;
+    double tlo[3];
+    int line_number;
+};
+
+struct preview_line {
+    int gcodes[ACTIVE_G_CODES];
+    int mcodes[ACTIVE_M_CODES];
+    double settings[ACTIVE_SETTINGS];
+};
+
+struct preview_dwell {
+    double pos[3];
+    double time;
+    int line_number;
+    int plane;
+    int code;		// 0 for G4, else the M1xx number
+};
+
+enum { PREVIEW_LINES, PREVIEW_TRAVERSE, PREVIEW_FEED, PREVIEW_ARCFEED,
+       PREVIEW_DWELLS, PREVIEW_NKINDS };
+
+static const char *preview_format[PREVIEW_NKINDS] = {
+    "=16i10i3d", "=9d9dd3di4x", "=9d9dd3di4x", "=9d9dd3di4x", "=4d3i4x"
+};
+
+// An arc whose tessellation is left to a worker thread, along with the
+// state it needs from the time it was programmed
+struct preview_arc {
+    preview_segment seg;	// start, feed rate, tool offset, line
+    double g5x[9], g92[9];
+    double rotation_cos, rotation_sin;
+    int plane, rot;
+    double x1, y1, cx, cy, z1, a, b, c, u, v, w;
+};
+
+// A run of consecutive moves.  Once submitted, a worker tessellates its arcs
+// and computes its extents; the main thread then appends it to the preview.
+// Lines and dwells ride along untouched, so that nothing is appended to the
+// preview arrays except in preview_data::collect.
+struct preview_chunk {
+    std::vector<preview_line> lines;
+    std::vector<preview_segment> traverse, feed, arcfeed;
+    std::vector<preview_dwell> dwells;
+    std::vector<preview_arc> arcs;
+    double ext[3][4][3];	// arcfeed, feed, traverse: start points only
+    int max_segments;
+    bool done;
+
+    explicit preview_chunk(int max_segments_) :
+        max_segments(max_segments_), done(false) {}
+    size_t size() const { return traverse.size() + feed.size() + arcs.size(); }
+    bool empty() const { return !size() && lines.empty() && dwells.empty(); }
+
+    void run() {
+        std::vector<double> points;
+        for(size_t i=0; i<arcs.size(); i++) {
+            const preview_arc &a = arcs[i];
+            points.clear();
+            arc_points(points, a.seg.start, a.g5x, a.g92,
+                    a.rotation_cos, a.rotation_sin, a.plane,
+                    a.x1, a.y1, a.cx, a.cy, a.rot, a.z1,
+                    a.a, a.b, a.c, a.u, a.v, a.w, max_segments);
+            preview_segment s = a.seg;
+            for(size_t j=0; j<points.size(); j+=9) {
+                memcpy(s.end, &points[j], sizeof(s.end));
+                arcfeed.push_back(s);
+                memcpy(s.start, s.end, sizeof(s.start));
+            }
+        }
+        const std::vector<preview_segment> *lists[] =
+            { &arcfeed, &feed, &traverse };
+        for(int i=0; i<3; i++) {
+            init_extents(ext[i]);
+            for(size_t j=0; j<lists[i]->size(); j++)
+                extend(ext[i], (*lists[i])[j].start, (*lists[i])[j].tlo);
+        }
+    }
+
+    static void init_extents(double ext[4][3]) {
+        for(int ax=0; ax<3; ax++) {
+            ext[0][ax] = ext[2][ax] = 9e99;
+            ext[1][ax] = ext[3][ax] = -9e99;
+        }
+    }
+
+    static void extend(double ext[4][3], const double *pt, const double *tlo) {
+        for(int ax=0; ax<3; ax++) {
+            ext[0][ax] = std::min(ext[0][ax], pt[ax]);
+            ext[1][ax] = std::max(ext[1][ax], pt[ax]);
+            ext[2][ax] = std::min(ext[2][ax], pt[ax] + tlo[ax]);
+            ext[3][ax] = std::max(ext[3][ax], pt[ax] + tlo[ax]);
+        }
+    }
+
+    static void merge(double ext[4][3], const double other[4][3]) {
+        for(int ax=0; ax<3; ax++) {
+            ext[0][ax] = std::min(ext[0][ax], other[0][ax]);
+            ext[1][ax] = std::max(ext[1][ax], other[1][ax]);
+            ext[2][ax] = std::min(ext[2][ax], other[2][ax]);
+            ext[3][ax] = std::max(ext[3][ax], other[3][ax]);
+        }
+    }
+};
+
+// Worker threads for submitted chunks.  They touch nothing but the chunk
+// they are given, so they run without the Python interpreter lock.
+class preview_pool {
+  public:
+    explicit preview_pool(int nthreads) : stopping(false) {
+        for(int i=0; i<nthreads; i++)
+            threads.push_back(std::thread(&preview_pool::worker, this));
+    }
+
+    ~preview_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work.notify_all();
+        for(size_t i=0; i<threads.size(); i++) threads[i].join();
+    }
+
+    void submit(preview_chunk *c) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(c);
+        }
+        work.notify_one();
+    }
+
+    bool done(preview_chunk *c, bool wait) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(wait) while(!c->done) finished.wait(lock);
+        return c->done;
+    }
+
+  private:
+    void worker() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            while(!stopping && queue.empty()) work.wait(lock);
+            if(queue.empty()) return;
+            preview_chunk *c = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            c->run();
+            lock.lock();
+            c->done = true;
+            finished.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable work, finished;
+    std::deque<preview_chunk*> queue;
+    std::vector<std::thread> threads;
+    bool stopping;
+};
+
+struct preview_data {
+    std::vector<preview_line> lines;
+    std::vector<preview_segment> traverse, feed, arcfeed;
+    std::vector<preview_dwell> dwells;
+    double ext[3][4][3];	// merged chunk extents, as in preview_chunk
+
+    double lo[9], tlo[9];
+    double g5x[9], g92[9];
+    double rotation_cos, rotation_sin;
+    double feedrate;
+    int plane;
+    bool first_move;
+
+    // only while a parse is running
+    preview_chunk *current;
+    std::deque<preview_chunk*> inflight;
+    preview_pool *pool;
+
+    preview_data() : current(0), pool(0) { reset(); }
+    ~preview_data() { finish(false); }
+
+    void reset() {
+        lines.clear(); traverse.clear(); feed.clear(); arcfeed.clear();
+        dwells.clear();
+        for(int i=0; i<3; i++) preview_chunk::init_extents(ext[i]);
+        for(int i=0; i<9; i++) lo[i] = tlo[i] = g5x[i] = g92[i] = 0;
+        rotation_cos = 1; rotation_sin = 0;
+        feedrate = 1;
+        plane = CANON_PLANE_XY;
+        first_move = true;
+    }
+
+    void rotate_and_translate(double p[9]) const {
+        for(int i=0; i<9; i++) p[i] += g92[i];
+        double rotx = p[0] * rotation_cos - p[1] * rotation_sin;
+        p[1] = p[0] * rotation_sin + p[1] * rotation_cos;
+        p[0] = rotx;
+        for(int i=0; i<9; i++) p[i] += g5x[i];
+    }
+
+    void fill(preview_segment &s, int line_number,
+            const double *start, const double *end) const {
+        memcpy(s.start, start, sizeof(s.start));
+        memcpy(s.end, end, sizeof(s.end));
+        s.feedrate = feedrate;
+        s.tlo[0] = tlo[0]; s.tlo[1] = tlo[1]; s.tlo[2] = tlo[2];
+        s.line_number = line_number;
+    }
+
+    void add(std::vector<preview_segment> &v, int line_number,
+            const double *start, const double *end) {
+        preview_segment s;
+        fill(s, line_number, start, end);
+        v.push_back(s);
+    }
+
+    void begin(int nthreads, int max_segments) {
+        pool = new preview_pool(nthreads);
+        current = new preview_chunk(max_segments);
+    }
+
+    void end_chunk() {
+        if(!current || current->empty()) return;
+        int max_segments = current->max_segments;
+        pool->submit(current);
+        inflight.push_back(current);
+        current = new preview_chunk(max_segments);
+    }
+
+    // Append finished chunks, in program order, to the preview arrays.
+    // Returns whether anything was added.
+    bool collect(bool wait) {
+        bool added = false;
+        while(!inflight.empty() && pool->done(inflight.front(), wait)) {
+            preview_chunk *c = inflight.front();
+            inflight.pop_front();
+            lines.insert(lines.end(), c->lines.begin(), c->lines.end());
+            dwells.insert(dwells.end(), c->dwells.begin(), c->dwells.end());
+            traverse.insert(traverse.end(), c->traverse.begin(), c->traverse.end());
+            feed.insert(feed.end(), c->feed.begin(), c->feed.end());
+            arcfeed.insert(arcfeed.end(), c->arcfeed.begin(), c->arcfeed.end());
+            for(int i=0; i<3; i++) preview_chunk::merge(ext[i], c->ext[i]);
+            delete c;
+            added = true;
+        }
+        return added;
+    }
+
+    // Wait for the workers and, if merge is set, add the remaining moves
+    void finish(bool merge) {
+        if(!pool) return;
+        if(merge) {
+            end_chunk();
+            collect(true);
+        }
+        delete pool;	// joins the workers
+        pool = 0;
+        while(!inflight.empty()) {
+            delete inflight.front();
+            inflight.pop_front();
+        }
+        delete current;
+        current = 0;
+    }
+
+    const char *contents(int kind, size_t &count, size_t &itemsize) const {
+        switch(kind) {
+        case PREVIEW_LINES:
+            count = lines.size(); itemsize = sizeof(preview_line);
+            return count ? (const char *)&lines[0] : "";
+        case PREVIEW_TRAVERSE:
+            count = traverse.size(); itemsize = sizeof(preview_segment);
+            return count ? (const char *)&traverse[0] : "";
+        case PREVIEW_FEED:
+            count = feed.size(); itemsize = sizeof(preview_segment);
+            return count ? (const char *)&feed[0] : "";
+        case PREVIEW_ARCFEED:
+            count = arcfeed.size(); itemsize = sizeof(preview_segment);
+            return count ? (const char *)&arcfeed[0] : "";
+        default:
+            count = dwells.size(); itemsize = sizeof(preview_dwell);
+            return count ? (const char *)&dwells[0] : "";
+        }
+    }
+};
+
+typedef struct {
+    PyObject_HEAD
+    preview_data *data;
+    int arcdivision;
+    int suppress;
+    int chunk_size;
+    int threads;
+    int exports;
+} Preview;
+
+typedef struct {
+    PyObject_HEAD
+    Preview *owner;
+    int kind;
+} PreviewArray;
+
+static PyObject *Preview_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    Preview *self = (Preview*)type->tp_alloc(type, 0);
+    if(!self) return NULL;
+    self->data = new preview_data;
+    self->arcdivision = 64;
+    self->chunk_size = 10000;
+    return (PyObject*)self;
+}
+
+static void Preview_dealloc(Preview *self) {
+    delete self->data;
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+static PyObject *Preview_clear(Preview *self) {
+    if(self->data->current) {
+        PyErr_SetString(PyExc_RuntimeError, "preview is being parsed into");
+        return NULL;
+    }
+    if(self->exports) {
+        PyErr_SetString(PyExc_BufferError,
+                "preview arrays are exported and cannot be resized");
+        return NULL;
+    }
+    self->data->reset();
+    Py_RETURN_NONE;
+}
+
+static void PreviewArray_dealloc(PreviewArray *self) {
+    Py_DECREF(self->owner);
+    PyObject_Del(self);
+}
+
+static Py_ssize_t PreviewArray_length(PreviewArray *self) {
+    size_t count, itemsize;
+    self->owner->data->contents(self->kind, count, itemsize);
+    return count;
+}
+
+static PyObject *PreviewArray_item(PreviewArray *self, Py_ssize_t i) {
+    size_t count, itemsize;
+    const char *base = self->owner->data->contents(self->kind, count, itemsize);
+    if(i < 0 || (size_t)i >= count) {
+        PyErr_SetString(PyExc_IndexError, "preview index out of range");
+        return NULL;
+    }
+    const char *item = base + i * itemsize;
+    switch(self->kind) {
+    case PREVIEW_LINES: {
+        LineCode *l = PyObject_New(LineCode, &LineCodeType);
+        if(!l) return NULL;
+        const preview_line *p = (const preview_line *)item;
+        memcpy(l->gcodes, p->gcodes, sizeof(l->gcodes));
+        memcpy(l->mcodes, p->mcodes, sizeof(l->mcodes));
+        memcpy(l->settings, p->settings, sizeof(l->settings));
+        return (PyObject*)l;
+    }
+    case PREVIEW_DWELLS: {
+        const preview_dwell *d = (const preview_dwell *)item;
+        return Py_BuildValue("i(ddd)idi", d->line_number,
+            d->pos[0], d->pos[1], d->pos[2], d->plane, d->time, d->code);
+    }
+    default: {
+        const preview_segment *s = (const preview_segment *)item;
+        return Py_BuildValue("i(ddddddddd)(ddddddddd)d(ddd)", s->line_number,
+            s->start[0], s->start[1], s->start[2], s->start[3], s->start[4],
+            s->start[5], s->start[6], s->start[7], s->start[8],
+            s->end[0], s->end[1], s->end[2], s->end[3], s->end[4],
+            s->end[5], s->end[6], s->end[7], s->end[8],
+            s->feedrate, s->tlo[0], s->tlo[1], s->tlo[2]);
+    }
+    }
+}
+
+static int PreviewArray_getbuffer(PreviewArray *self, Py_buffer *view, int flags) {
+    size_t count, itemsize;
+    const char *base = self->owner->data->contents(self->kind, count, itemsize);
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "preview arrays are read-only");
+        return -1;
+    }
+    // shape and stride, owned by this view
+    Py_ssize_t *dims = (Py_ssize_t*)PyMem_Malloc(2 * sizeof(Py_ssize_t));
+    if(!dims) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    dims[0] = count;
+    dims[1] = itemsize;
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = (void*)base;
+    view->len = count * itemsize;
+    view->readonly = 1;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)preview_format[self->kind] : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &dims[0] : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &dims[1] : NULL;
+    view->suboffsets = NULL;
+    view->internal = dims;
+    self->owner->exports++;
+    return 0;
+}
+
+static void PreviewArray_releasebuffer(PreviewArray *self, Py_buffer *view) {
+    PyMem_Free(view->internal);
+    self->owner->exports--;
+}
+
+static PyObject *PreviewArray_get_format(PreviewArray *self) {
+    return PyString_FromString(preview_format[self->kind]);
+}
+
+static PyObject *PreviewArray_get_itemsize(PreviewArray *self) {
+    size_t count, itemsize;
+    self->owner->data->contents(self->kind, count, itemsize);
+    return PyInt_FromLong(itemsize);
+}
+
+static PyGetSetDef PreviewArrayGetSet[] = {
+    {(char*)"format", (getter)PreviewArray_get_format},
+    {(char*)"itemsize", (getter)PreviewArray_get_itemsize},
+    {NULL, NULL},
+};
+
+static PySequenceMethods PreviewArraySequence = {
+    (lenfunc)PreviewArray_length,       /*sq_length*/
+    0,                                  /*sq_concat*/
+    0,                                  /*sq_repeat*/
+    (ssizeargfunc)PreviewArray_item,    /*sq_item*/
+};
+
+static PyBufferProcs PreviewArrayBuffer = {
+    // The old-style buffer procs are left out: they have no release hook,
+    // so the preview could not tell that a view is still held.
+    0,                                          /*bf_getreadbuffer*/
+    0,                                          /*bf_getwritebuffer*/
+    0,                                          /*bf_getsegcount*/
+    0,                                          /*bf_getcharbuffer*/
+    (getbufferproc)PreviewArray_getbuffer,      /*bf_getbuffer*/
+    (releasebufferproc)PreviewArray_releasebuffer, /*bf_releasebuffer*/
+};
+
+static PyTypeObject PreviewArrayType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.previewarray",   /*tp_name*/
+    sizeof(PreviewArray),   /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)PreviewArray_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &PreviewArraySequence,  /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &PreviewArrayBuffer,    /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    "Read-only view of one array of a gcode.preview", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    0,                      /*tp_methods*/
+    0,                      /*tp_members*/
+    PreviewArrayGetSet,     /*tp_getset*/
+};
+
+static PyObject *Preview_array(Preview *self, void *closure) {
+    PreviewArray *a = PyObject_New(PreviewArray, &PreviewArrayType);
+    if(!a) return NULL;
+    Py_INCREF(self);
+    a->owner = self;
+    a->kind = (int)(intptr_t)closure;
+    return (PyObject*)a;
+}
+
+static PyMethodDef PreviewMethods[] = {
+    {"clear", (PyCFunction)Preview_clear, METH_NOARGS,
+        "Discard all accumulated preview data"},
+    {NULL}
+};
+
+static PyGetSetDef PreviewGetSet[] = {
+    {(char*)"lines", (getter)Preview_array, NULL, NULL, (void*)PREVIEW_LINES},
+    {(char*)"traverse", (getter)Preview_array, NULL, NULL, (void*)PREVIEW_TRAVERSE},
+    {(char*)"feed", (getter)Preview_array, NULL, NULL, (void*)PREVIEW_FEED},
+    {(char*)"arcfeed", (getter)Preview_array, NULL, NULL, (void*)PREVIEW_ARCFEED},
+    {(char*)"dwells", (getter)Preview_array, NULL, NULL, (void*)PREVIEW_DWELLS},
+    {NULL, NULL},
+};
+
+static PyMemberDef PreviewMembers[] = {
+    {(char*)"arcdivision", T_INT, offsetof(Preview, arcdivision), 0},
+    {(char*)"suppress", T_INT, offsetof(Preview, suppress), 0},
+    {(char*)"chunk_size", T_INT, offsetof(Preview, chunk_size), 0},
+    {(char*)"threads", T_INT, offsetof(Preview, threads), 0},
+    {NULL}
+};
+
+static PyTypeObject PreviewType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.preview",        /*tp_name*/
+    sizeof(Preview),        /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Preview_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    "Packed preview data accumulated by gcode.parse", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    PreviewMethods,         /*tp_methods*/
+    PreviewMembers,         /*tp_members*/
+    PreviewGetSet,          /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    0,                      /*tp_init*/
+    0,                      /*tp_alloc*/
+    Preview_new,            /*tp_new*/
+    0,                      /*tp_free*/
+    0,                      /*tp_is_gc*/
+};
+
 static PyObject *callback;
 static int interp_error;
 static int last_sequence_number;
@@ -145,22 +805,20 @@ static double _pos_x, _pos_y, _pos_z, _pos_a, _pos_b, _pos_c, _pos_u, _pos_v, _p
 EmcPose tool_offset;
 
 static InterpBase *pinterp;
+static Preview *preview;
+static int reported_sequence_number;
+static bool have_preview_updated;
 
 #define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
 
-static void maybe_new_line(int sequence_number=pinterp->sequence_number());
-static void maybe_new_line(int sequence_number) {
-    if(!pinterp) return;
-    if(interp_error) return;
-    if(sequence_number == last_sequence_number)
-        return;
+static void report_line(int sequence_number) {
     LineCode *new_line_code =
         (LineCode*)(PyObject_New(LineCode, &LineCodeType));
     pinterp->active_settings(new_line_code->settings);
     pinterp->active_g_codes(new_line_code->gcodes);
     pinterp->active_m_codes(new_line_code->mcodes);
     new_line_code->gcodes[0] = sequence_number;
-    last_sequence_number = sequence_number;
+    reported_sequence_number = sequence_number;
     PyObject *result = 
         callmethod(callback, "next_line", "O", new_line_code);
     Py_DECREF(new_line_code);
@@ -168,6 +826,79 @@ static void maybe_new_line(int sequence_number) {
     Py_XDECREF(result);
 }
 
+// Hand the moves gathered so far to the workers, and add whatever they
+// have finished to the preview so the canon can draw it
+static void preview_flush() {
+    preview->data->end_chunk();
+    if(preview->exports || !preview->data->collect(false)) return;
+    if(!have_preview_updated || interp_error) return;
+    PyObject *result = callmethod(callback, "preview_updated", "");
+    if(result == NULL) interp_error ++;
+    Py_XDECREF(result);
+}
+
+static void maybe_new_line(int sequence_number=pinterp->sequence_number());
+static void maybe_new_line(int sequence_number) {
+    if(!pinterp) return;
+    if(interp_error) return;
+    if(sequence_number == last_sequence_number)
+        return;
+    last_sequence_number = sequence_number;
+    if(preview) {
+        preview_line l;
+        pinterp->active_settings(l.settings);
+        pinterp->active_g_codes(l.gcodes);
+        pinterp->active_m_codes(l.mcodes);
+        l.gcodes[0] = sequence_number;
+        preview->data->current->lines.push_back(l);
+        if(preview->data->current->size() >= (size_t)std::max(1, preview->chunk_size))
+            preview_flush();
+        return;
+    }
+    report_line(sequence_number);
+}
+
+// In preview mode the canon only hears about lines that carry one of the
+// rare events, and its "lo" is not maintained by Python, so bring both up
+// to date before calling into it.
+static void preview_sync() {
+    if(!preview || interp_error) return;
+    if(reported_sequence_number != last_sequence_number)
+        report_line(last_sequence_number);
+    if(interp_error) return;
+    const double *lo = preview->data->lo;
+    PyObject *o = Py_BuildValue("(ddddddddd)",
+        lo[0], lo[1], lo[2], lo[3], lo[4], lo[5], lo[6], lo[7], lo[8]);
+    if(!o || PyObject_SetAttrString(callback, "lo", o) < 0) interp_error ++;
+    Py_XDECREF(o);
+}
+
+static void preview_straight(std::vector<preview_segment> &segs, int line_number,
+        double x, double y, double z, double a, double b, double c,
+        double u, double v, double w) {
+    preview_data *d = preview->data;
+    if(preview->suppress > 0) return;
+    double l[9] = {x, y, z, a, b, c, u, v, w};
+    d->rotate_and_translate(l);
+    bool traverse = &segs == &d->current->traverse;
+    if(!traverse) d->first_move = false;
+    if(!traverse || !d->first_move)
+        d->add(segs, line_number, d->lo, l);
+    memcpy(d->lo, l, sizeof(l));
+}
+
+static void add_preview_dwell(double time, int code) {
+    preview_data *d = preview->data;
+    if(preview->suppress > 0) return;
+    preview_dwell r;
+    r.pos[0] = d->lo[0]; r.pos[1] = d->lo[1]; r.pos[2] = d->lo[2];
+    r.time = time;
+    r.line_number = last_sequence_number;
+    r.plane = d->plane;
+    r.code = code;
+    d->current->dwells.push_back(r);
+}
+
 void NURBS_FEED(int line_number, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
     double u = 0.0;
     unsigned int n = nurbs_control_points.size() - 1;
@@ -204,6 +935,36 @@ void ARC_FEED(int line_number,
     }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview) {
+        preview_data *d = preview->data;
+        if(preview->suppress > 0) return;
+        // only the end point is needed here; the segments in between are
+        // computed by a worker once the chunk is complete
+        preview_arc arc;
+        double n[9] = {0, 0, 0, a_position, b_position, c_position,
+            u_position, v_position, w_position};
+        int X = d->plane == 1 ? 0 : d->plane == 3 ? 2 : 1;
+        n[X] = first_end;
+        n[(X+1)%3] = second_end;
+        n[(X+2)%3] = axis_end_point;
+        d->rotate_and_translate(n);
+        d->fill(arc.seg, line_number, d->lo, n);
+        memcpy(arc.g5x, d->g5x, sizeof(arc.g5x));
+        memcpy(arc.g92, d->g92, sizeof(arc.g92));
+        arc.rotation_cos = d->rotation_cos;
+        arc.rotation_sin = d->rotation_sin;
+        arc.plane = d->plane;
+        arc.rot = rotation;
+        arc.x1 = first_end; arc.y1 = second_end;
+        arc.cx = first_axis; arc.cy = second_axis;
+        arc.z1 = axis_end_point;
+        arc.a = a_position; arc.b = b_position; arc.c = c_position;
+        arc.u = u_position; arc.v = v_position; arc.w = w_position;
+        d->current->arcs.push_back(arc);
+        d->first_move = false;
+        memcpy(d->lo, n, sizeof(d->lo));
+        return;
+    }
     PyObject *result =
         callmethod(callback, "arc_feed", "ffffifffffff",
                             first_end, second_end, first_axis, second_axis,
@@ -224,6 +985,10 @@ void STRAIGHT_FEED(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview) {
+        preview_straight(preview->data->current->feed, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "straight_feed", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -241,6 +1006,10 @@ void STRAIGHT_TRAVERSE(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview) {
+        preview_straight(preview->data->current->traverse, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "straight_traverse", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -255,6 +1024,13 @@ void SET_G5X_OFFSET(int g5x_index,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line();
     if(interp_error) return;
+    if(preview) {
+        double *o = preview->data->g5x;
+        o[0] = x; o[1] = y; o[2] = z; o[3] = a; o[4] = b; o[5] = c;
+        o[6] = u; o[7] = v; o[8] = w;
+        preview_sync();
+        if(interp_error) return;
+    }
     PyObject *result =
         callmethod(callback, "set_g5x_offset", "ifffffffff",
                             g5x_index, x, y, z, a, b, c, u, v, w);
@@ -268,6 +1044,13 @@ void SET_G92_OFFSET(double x, double y, double z,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line();
     if(interp_error) return;
+    if(preview) {
+        double *o = preview->data->g92;
+        o[0] = x; o[1] = y; o[2] = z; o[3] = a; o[4] = b; o[5] = c;
+        o[6] = u; o[7] = v; o[8] = w;
+        preview_sync();
+        if(interp_error) return;
+    }
     PyObject *result =
         callmethod(callback, "set_g92_offset", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -278,6 +1061,12 @@ void SET_G92_OFFSET(double x, double y, double z,
 void SET_XY_ROTATION(double t) {
     maybe_new_line();
     if(interp_error) return;
+    if(preview) {
+        preview->data->rotation_cos = cos(t * M_PI / 180.);
+        preview->data->rotation_sin = sin(t * M_PI / 180.);
+        preview_sync();
+        if(interp_error) return;
+    }
     PyObject *result =
         callmethod(callback, "set_xy_rotation", "f", t);
     if(result == NULL) interp_error ++;
@@ -289,6 +1078,11 @@ void USE_LENGTH_UNITS(CANON_UNITS u) { metric = u == CANON_UNITS_MM; }
 void SELECT_PLANE(CANON_PLANE pl) {
     maybe_new_line();   
     if(interp_error) return;
+    if(preview) {
+        preview->data->plane = pl;
+        preview_sync();
+        if(interp_error) return;
+    }
     PyObject *result =
         callmethod(callback, "set_plane", "i", pl);
     if(result == NULL) interp_error ++;
@@ -298,6 +1092,8 @@ void SELECT_PLANE(CANON_PLANE pl) {
 void SET_TRAVERSE_RATE(double rate) {
     maybe_new_line();   
     if(interp_error) return;
+    preview_sync();
+    if(interp_error) return;
     PyObject *result =
         callmethod(callback, "set_traverse_rate", "f", rate);
     if(result == NULL) interp_error ++;
@@ -318,6 +1114,11 @@ void SET_FEED_MODE(int spindle, int mode) {
 void CHANGE_TOOL(int pocket) {
     maybe_new_line();
     if(interp_error) return;
+    if(preview) {
+        preview->data->first_move = true;
+        preview_sync();
+        if(interp_error) return;
+    }
     PyObject *result = 
         callmethod(callback, "change_tool", "i", pocket);
     if(result == NULL) interp_error ++;
@@ -338,6 +1139,10 @@ void SET_FEED_RATE(double rate) {
     maybe_new_line();   
     if(interp_error) return;
     if(metric) rate /= 25.4;
+    if(preview) {
+        preview->data->feedrate = rate;
+        return;
+    }
     PyObject *result =
         callmethod(callback, "set_feed_rate", "f", rate);
     if(result == NULL) interp_error ++;
@@ -347,6 +1152,10 @@ void SET_FEED_RATE(double rate) {
 void DWELL(double time) {
     maybe_new_line();   
     if(interp_error) return;
+    if(preview) {
+        add_preview_dwell(time, 0);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "dwell", "f", time);
     if(result == NULL) interp_error ++;
@@ -356,6 +1165,8 @@ void DWELL(double time) {
 void MESSAGE(char *comment) {
     maybe_new_line();   
     if(interp_error) return;
+    preview_sync();
+    if(interp_error) return;
     PyObject *result =
         callmethod(callback, "message", "s", comment);
     if(result == NULL) interp_error ++;
@@ -370,10 +1181,19 @@ void LOGCLOSE() {}
 void COMMENT(const char *comment) {
     maybe_new_line();   
     if(interp_error) return;
+    preview_sync();
+    if(interp_error) return;
     PyObject *result =
         callmethod(callback, "comment", "s", comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
+    // comments like (AXIS,hide) toggle the canon's suppress count
+    if(preview && !interp_error && PyObject_HasAttrString(callback, "suppress")) {
+        PyObject *suppress = PyObject_GetAttrString(callback, "suppress");
+        if(suppress && PyInt_Check(suppress))
+            preview->suppress = PyInt_AsLong(suppress);
+        Py_XDECREF(suppress);
+    }
 }
 
 void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diameter,
@@ -387,6 +1207,19 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
     if(metric) {
         offset.tran.x /= 25.4; offset.tran.y /= 25.4; offset.tran.z /= 25.4;
         offset.u /= 25.4; offset.v /= 25.4; offset.w /= 25.4; }
+    if(preview) {
+        // the canon adjusts its own copy of lo, so sync it first
+        preview_sync();
+        if(interp_error) return;
+        preview_data *d = preview->data;
+        double t[9] = {offset.tran.x, offset.tran.y, offset.tran.z,
+            offset.a, offset.b, offset.c, offset.u, offset.v, offset.w};
+        for(int i=0; i<9; i++) {
+            d->lo[i] += d->tlo[i] - t[i];
+            d->tlo[i] = t[i];
+        }
+        d->first_move = true;
+    }
     PyObject *result = callmethod(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
         offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
     if(result == NULL) interp_error ++;
@@ -477,6 +1310,10 @@ void STRAIGHT_PROBE(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview) {
+        preview_straight(preview->data->current->feed, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "straight_probe", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -489,6 +1326,17 @@ void RIGID_TAP(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview) {
+        preview_data *d = preview->data;
+        if(preview->suppress > 0) return;
+        double l[9] = {x, y, z, 0, 0, 0, 0, 0, 0};
+        d->rotate_and_translate(l);
+        for(int i=3; i<9; i++) l[i] = d->lo[i];
+        d->first_move = false;
+        d->add(d->current->feed, line_number, d->lo, l);
+        d->add(d->current->feed, line_number, l, d->lo);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "rigid_tap", "fff",
             x, y, z);
@@ -554,6 +1402,10 @@ int WAIT(int index, int input_type, int wait_type, double timeout) { return 0;}
 static void user_defined_function(int num, double arg1, double arg2) {
     if(interp_error) return;
     maybe_new_line();
+    if(preview) {
+        add_preview_dwell(0, num);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "user_defined_function",
                             "idd", num, arg1, arg2);
@@ -701,6 +1553,23 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode) { motion_mode = mode; }
 CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
+// Holds the canon's preview object, if any, for the duration of a parse
+struct preview_ref {
+    preview_ref() {
+        PyObject *p = PyObject_GetAttrString(callback, "preview");
+        if(p && PyObject_TypeCheck(p, &PreviewType)) {
+            preview = (Preview*)p;
+            return;
+        }
+        Py_XDECREF(p);
+        PyErr_Clear();
+    }
+    ~preview_ref() {
+        if(preview) preview->data->finish(false);
+        Py_CLEAR(preview);
+    }
+};
+
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
 static PyObject *parse_file(PyObject *self, PyObject *args) {
     char *f;
@@ -720,6 +1589,23 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
             return NULL;
     }
 
+    preview_ref ref;
+    if(preview) {
+        if(preview->exports) {
+            PyErr_SetString(PyExc_BufferError,
+                    "preview arrays are exported and cannot be resized");
+            return NULL;
+        }
+        preview->data->reset();
+        preview->suppress = 0;
+        int threads = preview->threads;
+        if(threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        preview->data->begin(threads, preview->arcdivision);
+        have_preview_updated =
+            PyObject_HasAttrString(callback, "preview_updated");
+    }
+
     if(pinterp) {
         delete pinterp;
         pinterp = 0;
@@ -737,6 +1623,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     metric=false;
     interp_error = 0;
     last_sequence_number = -1;
+    reported_sequence_number = -1;
 
     _pos_x = _pos_y = _pos_z = _pos_a = _pos_b = _pos_c = 0;
     _pos_u = _pos_v = _pos_w = 0;
@@ -775,6 +1662,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
         gettimeofday(&t1, NULL);
         if(t1.tv_sec > t0.tv_sec + wait) {
             if(check_abort()) return NULL;
+            if(preview) preview_flush();
             t0 = t1;
         }
         if(!RESULT_OK) break;
@@ -797,7 +1685,16 @@ out_error:
     }
     PyErr_Clear();
     maybe_new_line();
+    preview_sync();
     if(PyErr_Occurred()) { interp_error = 1; goto out_error; }
+    if(preview) {
+        if(preview->exports) {
+            PyErr_SetString(PyExc_BufferError,
+                    "preview arrays are exported and cannot be resized");
+            return NULL;
+        }
+        preview->data->finish(true);
+    }
     PyObject *retval = PyTuple_New(2);
     PyTuple_SetItem(retval, 0, PyInt_FromLong(result));
     PyTuple_SetItem(retval, 1, PyInt_FromLong(last_sequence_number + error_line_offset));
@@ -815,7 +1712,28 @@ static PyObject *rs274_strerror(PyObject *s, PyObject *o) {
     return PyString_FromString(savedError);
 }
 
+// Same result as calc_extents(arcfeed, feed, traverse) on the equivalent lists
+static PyObject *preview_extents(Preview *p) {
+    const preview_data *d = p->data;
+    const std::vector<preview_segment> *lists[] =
+        { &d->arcfeed, &d->feed, &d->traverse };
+    double ext[4][3];
+    preview_chunk::init_extents(ext);
+    for(int i=0; i<3; i++) {
+        const std::vector<preview_segment> &segs = *lists[i];
+        if(segs.empty()) continue;
+        preview_chunk::merge(ext, d->ext[i]);
+        preview_chunk::extend(ext, segs.back().end, segs.back().tlo);
+    }
+    return Py_BuildValue("[ddd][ddd][ddd][ddd]",
+        ext[0][0], ext[0][1], ext[0][2],  ext[1][0], ext[1][1], ext[1][2],
+        ext[2][0], ext[2][1], ext[2][2],  ext[3][0], ext[3][1], ext[3][2]);
+}
+
 static PyObject *rs274_calc_extents(PyObject *self, PyObject *args) {
+    if(PyTuple_Size(args) == 1
+            && PyObject_TypeCheck(PyTuple_GET_ITEM(args, 0), &PreviewType))
+        return preview_extents((Preview*)PyTuple_GET_ITEM(args, 0));
     double min_x = 9e99, min_y = 9e99, min_z = 9e99,
            min_xt = 9e99, min_yt = 9e99, min_zt = 9e99,
            max_x = -9e99, max_y = -9e99, max_z = -9e99,
@@ -918,24 +1836,11 @@ static bool get_attr(PyObject *o, const char *attr_name, const char *fmt, ...) {
     return result;
 }
 
-static void unrotate(double &x, double &y, double c, double s) {
-    double tx = x * c + y * s;
-    y = -x * s + y * c;
-    x = tx;
-}
-
-static void rotate(double &x, double &y, double c, double s) {
-    double tx = x * c - y * s;
-    y = x * s + y * c;
-    x = tx;
-}
-
 static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     PyObject *canon;
     double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
+    double o[9], g5xoffset[9], g92offset[9];
     int rot, plane;
-    int X, Y, Z;
     double rotation_cos, rotation_sin;
     int max_segments = 128;
 
@@ -966,72 +1871,17 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
     if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
 
-    if(plane == 1) {
-        X=0; Y=1; Z=2;
-    } else if(plane == 3) {
-        X=2; Y=0; Z=1;
-    } else {
-        X=1; Y=2; Z=0;
-    }
-    n[X] = x1;
-    n[Y] = y1;
-    n[Z] = z1;
-    n[3] = a;
-    n[4] = b;
-    n[5] = c;
-    n[6] = u;
-    n[7] = v;
-    n[8] = w;
-    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
-    unrotate(o[0], o[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
-
-    double theta1 = atan2(o[Y]-cy, o[X]-cx);
-    double theta2 = atan2(n[Y]-cy, n[X]-cx);
-
-    if(rot < 0) {
-        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
-    } else {
-        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
-    }
+    std::vector<double> points;
+    arc_points(points, o, g5xoffset, g92offset, rotation_cos, rotation_sin,
+            plane, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w, max_segments);
 
-    // if multi-turn, add the right number of full circles
-    if(rot < -1) theta2 += 2*M_PI*(rot+1);
-    if(rot > 1) theta2 += 2*M_PI*(rot-1);
-
-    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
+    int steps = points.size() / 9;
     PyObject *segs = PyList_New(steps);
-
-    double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
-    d[Z] = n[Z] - o[Z];
-
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
-    for(int i=0; i<steps-1; i++) {
-        double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
-        p[Z] = o[Z] + d[Z] * f;
-        p[3] = o[3] + d[3] * f;
-        p[4] = o[4] + d[4] * f;
-        p[5] = o[5] + d[5] * f;
-        p[6] = o[6] + d[6] * f;
-        p[7] = o[7] + d[7] * f;
-        p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+    for(int i=0; i<steps; i++) {
+        const double *p = &points[9*i];
         PyList_SET_ITEM(segs, i,
             Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
     return segs;
 }
 
@@ -1052,6 +1902,10 @@ initgcode(void) {
                 "Interface to EMC rs274ngc interpreter");
     PyType_Ready(&LineCodeType);
     PyModule_AddObject(m, "linecode", (PyObject*)&LineCodeType);
+    PyType_Ready(&PreviewType);
+    PyModule_AddObject(m, "preview", (PyObject*)&PreviewType);
+    PyType_Ready(&PreviewArrayType);
+    PyModule_AddObject(m, "previewarray", (PyObject*)&PreviewArrayType);
     PyObject_SetAttrString(m, "MAX_ERROR", PyInt_FromLong(maxerror));
     PyObject_SetAttrString(m, "MIN_ERROR",
             PyInt_FromLong(INTERP_MIN_ERROR));
@@ -0,0 +1,606 @@
+/********************************************************************
+* Description: interp_expression.cc
+*
+*   Compiled evaluation of bracketed expressions. An expression is
+*   parsed once into postfix code, with numbered parameters resolved
+*   to their index and named parameters to a handle, and later reads
+*   of the same text only run the code.
+*
+* Author: LinuxCNC developers
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2026 All rights reserved.
+********************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+#include "rtapi_math.h"
+#include <cmath>
+
+using namespace interp_param_global;
+
+/* append an instruction to the code of an expression */
+static void emit(compiled_expression *expr, int opcode, int index)
+{
+  expr_instruction insn;
+
+  insn.opcode = opcode;
+  insn.arg.index = index;
+  expr->code.push_back(insn);
+}
+
+static void emit_number(compiled_expression *expr, double value)
+{
+  expr_instruction insn;
+
+  insn.opcode = EXPR_NUMBER;
+  insn.arg.value = value;
+  expr->code.push_back(insn);
+}
+
+/* the stack depth needed to run the code of an expression */
+static int expression_depth(compiled_expression *expr)
+{
+  int depth = 0, max_depth = 0;
+
+  for (size_t i = 0; i < expr->code.size(); i++) {
+    switch (expr->code[i].opcode) {
+    case EXPR_NUMBER:
+    case EXPR_PARAMETER:
+    case EXPR_NAMED:
+    case EXPR_EXISTS_NAMED:
+      depth++;
+      break;
+    case EXPR_ATAN:
+    case EXPR_BINARY:
+      depth--;
+      break;
+    default:
+      break;
+    }
+    if (depth > max_depth)
+      max_depth = depth;
+  }
+  return max_depth;
+}
+
+/****************************************************************************/
+
+/*! find_compiled_expression
+
+Returned Value: compiled_expression *
+   The compiled form of the expression starting at line[counter], which
+   must be a left bracket, or NULL if the line is not in the line cache.
+   The code is empty if the expression could not be compiled, and must
+   then be read from the text.
+
+Side effects:
+   The expression is compiled and added to the cache entry of the line
+   if it was not there.
+
+Called by: read_real_expression
+
+Expressions are only compiled on lines which are read again, and so
+are in the line cache; parse_line leaves the entry of the line it is
+reading in line_cache_parsing. The compiled code is kept on that entry
+by the offset of the expression on the line, since compiling does not
+depend on anything else; the values of parameters are only looked at
+when the code is run. Lines read once are read from the text as before.
+
+*/
+
+compiled_expression *Interp::find_compiled_expression(char *line, int counter)
+{
+  line_cache_entry *cached = _setup.line_cache_parsing;
+
+  if ((cached == NULL) || (line != _setup.blocktext))
+    return NULL;
+
+  std::map<int, compiled_expression>::iterator it =
+    cached->expressions.find(counter);
+
+  if (it != cached->expressions.end())
+    return &it->second;
+
+  compiled_expression *expr = &cached->expressions[counter];
+  int end = counter;
+
+  expr->length = 0;
+  expr->depth = 0;
+  if (compile_real_expression(line, &end, expr) != INTERP_OK) {
+    // the error is reported again when the text is read instead
+    expr->code.clear();
+    return expr;
+  }
+  expr->length = end - counter;
+  expr->depth = expression_depth(expr);
+  if (expr->depth > EXPRESSION_STACK_MAX)
+    expr->code.clear();
+  return expr;
+}
+
+/****************************************************************************/
+
+/*! compile_real_expression
+
+Returned Value: int
+   If any of the following functions returns an error code,
+   this returns that code.
+     compile_real_value
+     read_operation
+   Otherwise, it returns INTERP_OK.
+
+Side effects:
+   Code computing the value of the expression is appended to expr.
+   The counter is reset to point to the first character after the
+   expression.
+
+Called by:
+   find_compiled_expression
+   compile_real_value
+   compile_unary
+
+This follows read_real_expression exactly, but where that function
+applies a binary operation to the top two values of its stack, this
+emits the operation instead, so the code runs the operations in the
+same order.
+
+*/
+
+#define MAX_STACK 7
+
+int Interp::compile_real_expression(char *line,  //!< string: line of RS274/NGC code being processed
+                                int *counter,   //!< pointer to a counter for position on the line
+                                compiled_expression *expr) //!< code to append to
+{
+  int operators[MAX_STACK];
+  int stack_index;
+
+  CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  *counter = (*counter + 1);
+  CHP(compile_real_value(line, counter, expr));
+  CHP(read_operation(line, counter, operators));
+  stack_index = 1;
+  for (; operators[0] != RIGHT_BRACKET;) {
+    CHP(compile_real_value(line, counter, expr));
+    CHP(read_operation(line, counter, operators + stack_index));
+    if (precedence(operators[stack_index]) >
+        precedence(operators[stack_index - 1]))
+      stack_index++;
+    else {
+      for (; precedence(operators[stack_index]) <=
+           precedence(operators[stack_index - 1]);) {
+        emit(expr, EXPR_BINARY, operators[stack_index - 1]);
+        operators[stack_index - 1] = operators[stack_index];
+        if ((stack_index > 1) &&
+            (precedence(operators[stack_index - 1]) <=
+             precedence(operators[stack_index - 2])))
+          stack_index--;
+        else
+          break;
+      }
+    }
+  }
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_real_value
+
+Returned Value: int
+   If one of the following functions returns an error code,
+   this returns that code.
+      compile_real_expression
+      compile_parameter
+      compile_unary
+      read_real_number
+   If no characters are found before the end of the line this
+   returns NCE_NO_CHARACTERS_FOUND_IN_READING_REAL_VALUE.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   Code pushing the value is appended to expr.
+   The counter is reset to point to the first character after the
+   characters which make up the value.
+
+Called by:
+   compile_real_expression
+   compile_parameter
+
+The counterpart of read_real_value. Numbers are kept in the code as
+they are; any other value is followed by a check that it is a number
+and finite, as read_real_value does.
+
+*/
+
+int Interp::compile_real_value(char *line,  //!< string: line of RS274/NGC code being processed
+                           int *counter,        //!< pointer to a counter for position on the line
+                           compiled_expression *expr) //!< code to append to
+{
+  char c, c1;
+  double number;
+
+  c = line[*counter];
+  CHKS((c == 0), NCE_NO_CHARACTERS_FOUND_IN_READING_REAL_VALUE);
+
+  c1 = line[*counter+1];
+
+  if (c == '[')
+    CHP(compile_real_expression(line, counter, expr));
+  else if (c == '#')
+    CHP(compile_parameter(line, counter, expr, false));
+  else if (c == '+' && c1 && !isdigit(c1) && c1 != '.')
+  {
+    (*counter)++;
+    CHP(compile_real_value(line, counter, expr));
+  }
+  else if (c == '-' && c1 && !isdigit(c1) && c1 != '.')
+  {
+    (*counter)++;
+    CHP(compile_real_value(line, counter, expr));
+    emit(expr, EXPR_NEGATE, 0);
+  }
+  else if ((c >= 'a') && (c <= 'z'))
+    CHP(compile_unary(line, counter, expr));
+  else {
+    CHP(read_real_number(line, counter, &number));
+    emit_number(expr, number);
+    if (std::isfinite(number))
+      return INTERP_OK;
+  }
+
+  emit(expr, EXPR_CHECK, 0);
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_parameter
+
+Returned Value: int
+   If compile_real_value or read_name returns an error code, this
+   returns that code.
+   If the first character read is not #, this returns
+   NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   Code pushing the value of the parameter, or whether it exists, is
+   appended to expr.
+   The counter is reset to point to the first character after the
+   parameter.
+
+Called by:
+   compile_real_value
+   compile_bracketed_parameter
+
+The counterpart of read_parameter. A parameter number given as a plain
+number is resolved here, so the code reads the parameter table
+directly; the range checks of read_parameter are then done at run time
+only for computed numbers, and for the current position parameters,
+which cannot be read with cutter radius compensation on.
+
+*/
+
+int Interp::compile_parameter(
+    char *line,   //!< string: line of RS274/NGC code being processed
+    int *counter, //!< pointer to a counter for position on the line
+    compiled_expression *expr, //!< code to append to
+    bool check_exists)    //!< test for existence, not value
+{
+  char paramNameBuf[LINELEN+1];
+  int handle;
+
+  CHKS((line[*counter] != '#'), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+
+  *counter = (*counter + 1);
+
+  if (line[*counter] == '<') {
+    CHP(read_name(line, counter, paramNameBuf));
+    handle = intern_named_param(paramNameBuf);
+    emit(expr, check_exists ? EXPR_EXISTS_NAMED : EXPR_NAMED, handle);
+    return INTERP_OK;
+  }
+
+  CHP(compile_real_value(line, counter, expr));
+  if (!check_exists && expr->code.back().opcode == EXPR_NUMBER) {
+    double number = expr->code.back().arg.value;
+    int index = (int) floor(number);
+
+    if ((number - index) > 0.9999)
+      index = (int) ceil(number);
+    if (((number - index) <= 0.0001) &&
+        (index >= 1) && (index < RS274NGC_MAX_PARAMETERS) &&
+        ((index < 5420) || (index > 5428))) {
+      expr->code.pop_back();
+      emit(expr, EXPR_PARAMETER, index);
+      return INTERP_OK;
+    }
+  }
+  emit(expr, check_exists ? EXPR_EXISTS_AT : EXPR_PARAMETER_AT, 0);
+  return INTERP_OK;
+}
+
+int Interp::compile_bracketed_parameter(
+    char *line,   //!< string: line of RS274/NGC code being processed
+    int *counter, //!< pointer to a counter for position on the line
+    compiled_expression *expr, //!< code to append to
+    bool check_exists)    //!< test for existence, not value
+{
+  CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  *counter = (*counter + 1);
+  CHKS((line[*counter] != '#'), _("Expected # reading parameter"));
+  CHP(compile_parameter(line, counter, expr, check_exists));
+  CHKS((line[*counter] != ']'), _("Expected ] reading bracketed parameter"));
+  *counter = (*counter + 1);
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_unary
+
+Returned Value: int
+   If any of the following functions returns an error code,
+   this returns that code.
+     read_operation_unary
+     compile_real_expression
+     compile_bracketed_parameter
+   If a left bracket does not follow the operation name, or for atan
+   the slash and the bracket of the second argument are missing, this
+   returns the same errors as read_unary and read_atan.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   Code computing the value of the operation is appended to expr.
+   The counter is reset to point to the first character after the
+   operation and its arguments.
+
+Called by: compile_real_value
+
+*/
+
+int Interp::compile_unary(char *line,    //!< string: line of RS274/NGC code being processed
+                      int *counter,     //!< pointer to a counter for position on the line
+                      compiled_expression *expr) //!< code to append to
+{
+  int operation;
+
+  CHP(read_operation_unary(line, counter, &operation));
+  CHKS((line[*counter] != '['),
+      NCE_LEFT_BRACKET_MISSING_AFTER_UNARY_OPERATION_NAME);
+
+  if (operation == EXISTS)
+    return compile_bracketed_parameter(line, counter, expr, true);
+
+  CHP(compile_real_expression(line, counter, expr));
+
+  if (operation == ATAN) {
+    CHKS((line[*counter] != '/'), NCE_SLASH_MISSING_AFTER_FIRST_ATAN_ARGUMENT);
+    *counter = (*counter + 1);
+    CHKS((line[*counter] != '['),
+        NCE_LEFT_BRACKET_MISSING_AFTER_SLASH_WITH_ATAN);
+    CHP(compile_real_expression(line, counter, expr));
+    emit(expr, EXPR_ATAN, 0);
+  } else
+    emit(expr, EXPR_UNARY, operation);
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! intern_named_param
+
+Returned Value: int
+   The handle of the named parameter, an index into named_param_handles.
+
+Side effects:
+   The name is added to named_param_handles if it was not there.
+
+Called by: compile_parameter
+
+Names are compared without regard to case, like the frames do.
+
+*/
+
+int Interp::intern_named_param(const char *nameBuf)
+{
+  named_param_index_type::iterator it = _setup.named_param_index.find(nameBuf);
+
+  if (it != _setup.named_param_index.end())
+    return it->second;
+
+  named_param_handle h;
+  h.name = strstore(nameBuf);
+  h.global = (nameBuf[0] == '_');
+  h.frame = NULL;
+  h.param = NULL;
+  h.generation = 0;
+  _setup.named_param_handles.push_back(h);
+  int handle = _setup.named_param_handles.size() - 1;
+  _setup.named_param_index[h.name] = handle;
+  return handle;
+}
+
+/****************************************************************************/
+
+/*! evaluate_named_param
+
+Returned Value: int
+   If named_parameter_value returns an error code, this returns that code.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   The value of the named parameter is put into what value points at.
+   The entry the parameter was found in is remembered in its handle.
+
+Called by: evaluate_expression
+
+Plain values are read straight from the remembered entry while it is
+valid. Parameters which are unset, looked up by a function or computed
+by Python, and those not found in their frame (_hal[] and undefined
+ones), go through named_parameter_value every time.
+
+*/
+
+int Interp::evaluate_named_param(int handle,   //!< from intern_named_param
+                                 double *value) //!< pointer to the value read
+{
+  named_param_handle *h = &_setup.named_param_handles[handle];
+  context_pointer frame =
+    &_setup.sub_context[h->global ? 0 : _setup.call_level];
+
+  if ((h->frame != frame) || (h->generation != _setup.named_param_generation)) {
+    parameter_map_iterator pi = frame->named_params.find(h->name);
+
+    if (pi == frame->named_params.end()) {
+      h->frame = NULL;
+    } else {
+      h->frame = frame;
+      h->param = &pi->second;
+      h->generation = _setup.named_param_generation;
+    }
+  }
+  if ((h->frame == frame) &&
+      !(h->param->attr & (PA_UNSET | PA_USE_LOOKUP | PA_PYTHON))) {
+    *value = h->param->value;
+    return INTERP_OK;
+  }
+  *value = 0.0;
+  CHP(named_parameter_value(h->name, value, false));
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! expression_integer
+
+Returned Value: int
+   If the value is not within 0.0001 of an integer, this returns
+   NCE_NON_INTEGER_VALUE_FOR_INTEGER. Otherwise, this returns INTERP_OK.
+
+Side effects:
+   The integer the value is close to is put into what integer_ptr
+   points at.
+
+Called by: evaluate_expression
+
+The same rounding as read_integer_value, for computed parameter numbers.
+
+*/
+
+int Interp::expression_integer(double float_value, //!< value computed
+                               int *integer_ptr)   //!< pointer to the integer
+{
+  *integer_ptr = (int) floor(float_value);
+  if ((float_value - *integer_ptr) > 0.9999) {
+    *integer_ptr = (int) ceil(float_value);
+  } else if ((float_value - *integer_ptr) > 0.0001)
+    ERS(NCE_NON_INTEGER_VALUE_FOR_INTEGER);
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! evaluate_expression
+
+Returned Value: int
+   If any of the following functions returns an error code,
+   this returns that code.
+     execute_binary
+     execute_unary
+     evaluate_named_param
+     named_parameter_value
+     expression_integer
+   Parameter numbers out of range, current position parameters read
+   with cutter radius compensation on, and values which are not a
+   number or infinite give the same errors as when the expression is
+   read from the text.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   The value of the expression is put into what value points at.
+
+Called by: read_real_expression
+
+*/
+
+int Interp::evaluate_expression(compiled_expression *expr, //!< from find_compiled_expression
+                                double *value,      //!< pointer to double to be computed
+                                double *parameters) //!< array of system parameters
+{
+  double stack[EXPRESSION_STACK_MAX];
+  int top = -1;
+  int index;
+
+  for (size_t i = 0; i < expr->code.size(); i++) {
+    const expr_instruction &insn = expr->code[i];
+
+    switch (insn.opcode) {
+    case EXPR_NUMBER:
+      stack[++top] = insn.arg.value;
+      break;
+    case EXPR_PARAMETER:
+      stack[++top] = parameters[insn.arg.index];
+      break;
+    case EXPR_PARAMETER_AT:
+      CHP(expression_integer(stack[top], &index));
+      CHKS(((index < 1) || (index >= RS274NGC_MAX_PARAMETERS)),
+          NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
+      CHKS(((index >= 5420) && (index <= 5428) && (_setup.cutter_comp_side)),
+           _("Cannot read current position with cutter radius compensation on"));
+      stack[top] = parameters[index];
+      break;
+    case EXPR_EXISTS_AT:
+      CHP(expression_integer(stack[top], &index));
+      stack[top] = index >= 1 && index < RS274NGC_MAX_PARAMETERS;
+      break;
+    case EXPR_NAMED:
+      CHP(evaluate_named_param(insn.arg.index, &stack[++top]));
+      break;
+    case EXPR_EXISTS_NAMED:
+      CHP(named_parameter_value(_setup.named_param_handles[insn.arg.index].name,
+                                &stack[++top], true));
+      break;
+    case EXPR_NEGATE:
+      stack[top] = -stack[top];
+      break;
+    case EXPR_UNARY:
+      CHP(execute_unary(&stack[top], insn.arg.index));
+      break;
+    case EXPR_ATAN:
+      stack[top - 1] = atan2(stack[top - 1], stack[top]);  /* value in radians */
+      stack[top - 1] = ((stack[top - 1] * 180.0) / M_PIl);   /* convert to degrees */
+      top--;
+      break;
+    case EXPR_BINARY:
+      CHP(execute_binary(&stack[top - 1], insn.arg.index, &stack[top]));
+      top--;
+      break;
+    case EXPR_CHECK:
+      CHKS(std::isnan(stack[top]),
+          _("Calculation resulted in 'not a number'"));
+      CHKS(std::isinf(stack[top]),
+          _("Calculation resulted in 'infinity'"));
+      break;
+    default:
+      ERS(NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+    }
+  }
+  *value = stack[0];
+  return INTERP_OK;
+}
@@ -334,14 +334,46 @@ Side effects:
 
 Called by:  Interp::read
 
+If cached is not NULL, the line was read before by a loop or
+subroutine call. When the words of the line were stored then, they are
+copied into the block instead of reading them again. Otherwise they are
+stored for next time, unless they may read differently: lines with
+parameters, expressions or semicolon comments, and o-word, m98 and m99
+lines, which depend on the state of the interpreter.
+
 */
 
 int Interp::parse_line(char *line,       //!< array holding a line of RS274 code  
                       block_pointer block,      //!< pointer to a block to be filled     
-                      setup_pointer settings)   //!< pointer to machine settings         
+                      setup_pointer settings,   //!< pointer to machine settings         
+                      line_cache_entry *cached) //!< cache entry of the line, or NULL
 {
-  CHP(init_block(block));
-  CHP(read_items(block, line, settings->parameters));
+  if (cached && cached->parsed && (settings->skipping_o == 0) &&
+      (cached->lathe_diameter_mode == settings->lathe_diameter_mode)) {
+    // these are not set by reading the line
+    long offset = block->offset;
+    int saved_line_number = block->saved_line_number;
+    int phase = block->phase;
+
+    *block = cached->parsed_block;
+    block->offset = offset;
+    block->saved_line_number = saved_line_number;
+    block->phase = phase;
+  } else {
+    CHP(init_block(block));
+    // expressions on the line are compiled into its cache entry
+    settings->line_cache_parsing = cached;
+    int status = read_items(block, line, settings->parameters);
+    settings->line_cache_parsing = NULL;
+    CHP(status);
+    if (cached && (settings->skipping_o == 0) &&
+        (strpbrk(line, "#[;") == NULL) && (block->o_name == 0) &&
+        (block->m_modes[4] != 99)) {
+      cached->parsed_block = *block;
+      cached->lathe_diameter_mode = settings->lathe_diameter_mode;
+      cached->parsed = true;
+    }
+  }
 
   if(settings->skipping_o == 0)
   {
@@ -19,6 +19,9 @@
 #include <stdio.h>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <string>
+#include <vector>
 #include <bitset>
 #include "canon.hh"
 #include "emcpos.h"
@@ -622,6 +625,87 @@ struct offset_struct {
 typedef std::map<const char *, offset, nocase_cmp> offset_map_type;
 typedef std::map<const char *, offset, nocase_cmp>::iterator offset_map_iterator;
 
+// compiled form of a bracketed expression, see interp_expression.cc.
+// The code is in postfix order: each instruction pushes a value or
+// replaces the top values of the stack with the result of an operation
+enum expr_opcodes {
+  EXPR_NUMBER,          // push arg.value
+  EXPR_PARAMETER,       // push parameters[arg.index]
+  EXPR_PARAMETER_AT,    // replace index on top by parameters[index]
+  EXPR_EXISTS_AT,       // replace index on top by 1 if it is in range
+  EXPR_NAMED,           // push named parameter arg.index
+  EXPR_EXISTS_NAMED,    // push 1 if named parameter arg.index exists
+  EXPR_NEGATE,          // unary minus in front of a value
+  EXPR_UNARY,           // arg.index is the operation (ABS, SIN, ...)
+  EXPR_ATAN,            // atan[top-1]/[top]
+  EXPR_BINARY,          // arg.index is the operation (PLUS, AND2, ...)
+  EXPR_CHECK,           // fail if top is not a number or infinite
+};
+
+struct expr_instruction {
+  int opcode;
+  union {
+    double value;
+    int index;
+  } arg;
+};
+
+struct compiled_expression {
+  int length;           // characters of the line taken by the expression
+  int depth;            // stack depth needed to evaluate it
+  std::vector<expr_instruction> code; // empty if it could not be compiled
+};
+
+// a line which was read again because of a loop or subroutine call.
+// Later reads of the same line are served from here instead of the file;
+// the block is kept only for lines whose words do not depend on
+// parameters or interpreter state, since expressions are evaluated
+// while reading
+struct line_cache_entry {
+  long next_offset;          // offset of the following line in the file
+  std::string linetext;      // raw line, as returned by read_text
+  std::string blocktext;     // close_and_downcased line
+  bool parsed;               // block holds the result of read_items
+  bool lathe_diameter_mode;  // x words are read differently in G7
+  block parsed_block;
+  // compiled expressions by offset on the line, see interp_expression.cc
+  std::map<int, compiled_expression> expressions;
+};
+
+struct line_cache_file {
+  std::string filename;
+  long high_water;           // largest line offset read so far
+  std::map<long, line_cache_entry> lines;
+};
+
+typedef std::map<std::string, line_cache_file> line_cache_type;
+
+// upper bound on the number of cached lines, over all files
+#define LINE_CACHE_MAX 8192
+
+// a named parameter, interned when an expression using it is compiled.
+// The entry it was last found in is kept, and used as long as the frame
+// is the same and named_param_generation has not changed, that is no
+// entries have been removed from any frame since
+struct named_param_handle {
+  const char *name;          // strstore'd
+  bool global;               // leading underscore, lives in frame 0
+  context_pointer frame;     // frame param was found in, or NULL
+  parameter_pointer param;
+  unsigned generation;
+};
+
+typedef std::map<const char *, int, nocase_cmp> named_param_index_type;
+
+// subroutine files by file name ("foo.ngc"), built from the directories
+// find_ngc_file searches, in the order it searches them. The directories
+// are watched with inotify, and the index is rebuilt on the next lookup
+// after any of them changed
+typedef std::unordered_map<std::string, std::string> ngc_file_index_type;
+
+// deeper expressions are evaluated from the text
+#define EXPRESSION_STACK_MAX 32
+
 /*
 
 The current_x, current_y, and current_z are the location of the tool
@@ -768,6 +852,13 @@ struct setup
   context sub_context[INTERP_SUB_ROUTINE_LEVELS];
   int call_state;                  //  enum call_states - inidicate Py handler reexecution
   offset_map_type offset_map;      // store label x name, file, line
+  line_cache_type line_cache;      // lines re-read by loops and subs
+  line_cache_file *line_cache_current; // entry for filename, or NULL
+  int line_cache_size;             // number of lines in line_cache
+  line_cache_entry *line_cache_parsing; // entry of the line being read
+  std::vector<named_param_handle> named_param_handles;
+  named_param_index_type named_param_index; // name to named_param_handles
+  unsigned named_param_generation; // bumped when named params are removed
 
   bool adaptive_feed;              // adaptive feed is enabled
   bool feed_hold;                  // feed hold is enabled
@@ -780,6 +871,10 @@ struct setup
                                      // the input file
   int lazy_closing;                  // close has been called
   char wizard_root[PATH_MAX];
+  ngc_file_index_type ngc_file_index; // subroutine file name to path
+  int ngc_file_index_fd;             // inotify fd, -1 when not indexing
+  bool ngc_file_index_stale;         // a watched directory has changed
+  bool ngc_file_index_complete;      // every searched directory is watched
   int tool_change_at_g30;
   int tool_change_quill_up;
   int tool_change_with_spindle_on;
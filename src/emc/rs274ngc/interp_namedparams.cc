@@ -143,15 +143,43 @@ int Interp::read_named_parameter(
 				 double *parameters,   //!< array of system parameters
 				 bool check_exists)    //!< test for existence, not value
 {
-    static char name[] = "read_named_parameter";
     char paramNameBuf[LINELEN+1];
-    int exists;
-    double value;
-    parameter_map_iterator pi;
 
     CHKS((line[*counter] != '<'),
 	 NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
     CHP(read_name(line, counter, paramNameBuf));
+    CHP(named_parameter_value(paramNameBuf, double_ptr, check_exists));
+    return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! named_parameter_value
+
+Returned Value: int
+   If find_named_param returns an error code, this returns that code.
+   If the named parameter has not been defined before use, this returns
+   NCE_NAMED_PARAMETER_NOT_DEFINED, unless a subroutine is being defined.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   The value of the parameter, or 1.0/0.0 if check_exists is set and the
+   parameter does/does not exist, is put into what double_ptr points at.
+
+Called by:
+   read_named_parameter
+   evaluate_named_param
+
+*/
+
+int Interp::named_parameter_value(
+				 const char *paramNameBuf, //!< name of the parameter
+				 double *double_ptr,   //!< pointer to double to be read
+				 bool check_exists)    //!< test for existence, not value
+{
+    static char name[] = "named_parameter_value";
+    int exists;
+    double value;
 
     CHP(find_named_param(paramNameBuf, &exists, &value));
     if (check_exists) {
@@ -475,6 +503,7 @@ int Interp::add_named_param(
 int Interp::free_named_parameters(context_pointer frame)
 {
     frame->named_params.clear();
+    _setup.named_param_generation++;
     return INTERP_OK;
 }
 
@@ -748,6 +777,7 @@ int Interp::init_python_predef_parameter(const char *name)
 	if (exists) {
 	    fprintf(stderr, "warning: redefining named parameter %s\n",name);
 	    _setup.sub_context[0].named_params.erase(name);
+	    _setup.named_param_generation++;
 	}
 	param.value = 0.0;
 	param.attr = PA_READONLY|PA_PYTHON|PA_GLOBAL;
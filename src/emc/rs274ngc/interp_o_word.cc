@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <sys/inotify.h>
 #include <new>
 #include "rs274ngc.hh"
 #include "rs274ngc_return.hh"
@@ -85,6 +86,139 @@ int Interp::findFile( // ARGUMENTS
     ERS(NCE_FILE_NOT_OPEN);
 }
 
+/*
+  Add the files in a directory to the subroutine file index, and if
+  recurse is set, those in the directories below it, in the order
+  findFile would find them. Names already in the index are kept, so
+  the directory searched first wins. A directory that cannot be opened
+  is not watched, so files appearing there later would go unnoticed;
+  the index then no longer covers every directory searched.
+*/
+
+int Interp::index_ngc_dir(setup_pointer settings,
+			  const char *direct, // the directory to index
+			  bool recurse)       // descend into subdirectories
+{
+    DIR *aDir;
+    struct dirent *aFile;
+    std::vector<std::string> subdirs;
+
+    aDir = opendir(direct);
+    if (!aDir) {
+	settings->ngc_file_index_complete = false;
+	return INTERP_OK;
+    }
+    if (inotify_add_watch(settings->ngc_file_index_fd, direct,
+			  IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+			  IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+	logOword("inotify_add_watch(%s): %s", direct, strerror(errno));
+	closedir(aDir);
+	return INTERP_ERROR;
+    }
+    while ((aFile = readdir(aDir))) {
+	if (aFile->d_type == DT_DIR) {
+	    if (recurse &&
+		(0 != strcmp(aFile->d_name, "..")) &&
+		(0 != strcmp(aFile->d_name, ".")))
+		subdirs.push_back(aFile->d_name);
+	    continue;
+	}
+	char path[PATH_MAX+1];
+	snprintf(path, PATH_MAX, "%s/%s", direct, aFile->d_name);
+	settings->ngc_file_index.emplace(aFile->d_name, path);
+    }
+    closedir(aDir);
+
+    for (size_t i = 0; i < subdirs.size(); i++) {
+	char path[PATH_MAX+1];
+	snprintf(path, PATH_MAX, "%s/%s", direct, subdirs[i].c_str());
+	if (index_ngc_dir(settings, path, true) != INTERP_OK)
+	    return INTERP_ERROR;
+    }
+    return INTERP_OK;
+}
+
+/*
+  (Re)build the index of subroutine files from program_prefix, the
+  SUBROUTINE_PATH directories and the wizard tree. If inotify is not
+  available, or a directory cannot be watched, there is no index and
+  find_ngc_file searches the directories each time.
+*/
+
+void Interp::build_ngc_file_index(setup_pointer settings)
+{
+    int dct;
+
+    settings->ngc_file_index.clear();
+    settings->ngc_file_index_stale = false;
+    settings->ngc_file_index_complete = true;
+    if (settings->ngc_file_index_fd >= 0)
+	::close(settings->ngc_file_index_fd);
+    settings->ngc_file_index_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (settings->ngc_file_index_fd < 0) {
+	logOword("inotify_init1: %s, not indexing subroutines", strerror(errno));
+	return;
+    }
+
+    int status = INTERP_OK;
+    if (settings->program_prefix[0])
+	status = index_ngc_dir(settings, settings->program_prefix, false);
+    for (dct = 0; (status == INTERP_OK) && (dct < MAX_SUB_DIRS); dct++) {
+	if (settings->subroutines[dct])
+	    status = index_ngc_dir(settings, settings->subroutines[dct], false);
+    }
+    if ((status == INTERP_OK) && settings->wizard_root[0])
+	status = index_ngc_dir(settings, settings->wizard_root, true);
+
+    if (status != INTERP_OK) {
+	logOword("not indexing subroutines");
+	settings->ngc_file_index.clear();
+	::close(settings->ngc_file_index_fd);
+	settings->ngc_file_index_fd = -1;
+	return;
+    }
+    logOword("indexed %d subroutine files",
+	     (int) settings->ngc_file_index.size());
+}
+
+/*
+  Look a subroutine file name up in the index. Returns false if the
+  directories must be searched: there is no index, or the index does
+  not have the file and cannot prove it absent. That is the case for
+  names with a directory part, which are never indexed, and when some
+  searched directory is not watched. Otherwise *path is set to the file
+  found, or NULL if no searched directory holds it.
+*/
+
+bool Interp::find_indexed_ngc_file(setup_pointer settings,
+				   const char *fileName, // "name.ngc"
+				   const char **path)    // where found, or NULL
+{
+    char buf[4096]
+	__attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    if (settings->ngc_file_index_fd < 0)
+	return false;
+    // any event at all means the files may have moved
+    while (::read(settings->ngc_file_index_fd, buf, sizeof(buf)) > 0)
+	settings->ngc_file_index_stale = true;
+    if (settings->ngc_file_index_stale) {
+	build_ngc_file_index(settings);
+	if (settings->ngc_file_index_fd < 0)
+	    return false;
+    }
+
+    ngc_file_index_type::iterator it = settings->ngc_file_index.find(fileName);
+    if (it != settings->ngc_file_index.end()) {
+	*path = it->second.c_str();
+	return true;
+    }
+    if (strchr(fileName, '/') || !settings->ngc_file_index_complete)
+	return false;
+    *path = NULL;
+    return true;
+}
+
 
 /*
  *  this now uses STL maps for offset access
@@ -666,6 +800,7 @@ int Interp::enter_context(setup_pointer settings, block_pointer block)
     }
     context_pointer frame = &settings->sub_context[settings->call_level];
     frame->clear();
+    settings->named_param_generation++;
     // mark frame for finishing remap
     frame->context_status = (block->call_type  == CT_REMAP) ? REMAP_FRAME : 0;
     frame->subName = block->o_name;
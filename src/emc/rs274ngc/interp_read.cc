@@ -2643,6 +2643,12 @@ N.B.: We are now using six levels (right-bracket, logical operations,
 relational operations, plus-like operations, times-like operations, and
 power).
 
+Expressions on lines in the line cache are compiled by
+find_compiled_expression the first time they are read from there, and
+from then on evaluated from the compiled code. The text is only read
+here for other lines, or if it could not be compiled, which is also how
+errors in the expression get reported.
+
 */
 
 #define MAX_STACK 7
@@ -2655,8 +2661,15 @@ int Interp::read_real_expression(char *line,     //!< string: line of RS274/NGC
   double values[MAX_STACK];
   int operators[MAX_STACK];
   int stack_index;
+  compiled_expression *expr;
 
   CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  expr = find_compiled_expression(line, *counter);
+  if (expr && !expr->code.empty()) {
+    CHP(evaluate_expression(expr, value, parameters));
+    *counter = (*counter + expr->length);
+    return INTERP_OK;
+  }
   *counter = (*counter + 1);
   CHP(read_real_value(line, counter, values, parameters));
   CHP(read_operation(line, counter, operators));
@@ -3177,6 +3190,142 @@ int Interp::read_text(
 
 /****************************************************************************/
 
+/*! find_cached_line
+
+Returned Value: line_cache_entry *
+   The cached copy of the line starting at offset in the current file,
+   or NULL if there is none.
+
+Side effects:
+   The high water mark of the current file is advanced. reread is set
+   if the line was read before and there is room to cache it.
+
+Called by: Interp::read
+
+Lines are only cached once they are read a second time, that is when a
+loop goes around again or a subroutine is called again, so a long
+program which runs straight through costs nothing but a map lookup per
+file switch.
+
+*/
+
+line_cache_entry *Interp::find_cached_line(setup_pointer settings,
+                                           long offset, bool *reread)
+{
+  line_cache_file *file = settings->line_cache_current;
+
+  *reread = false;
+  if (file == NULL || file->filename != settings->filename) {
+    file = &settings->line_cache[settings->filename];
+    if (file->filename.empty()) {
+      file->filename = settings->filename;
+      file->high_water = -1;
+    }
+    settings->line_cache_current = file;
+  }
+  if (offset > file->high_water) {
+    file->high_water = offset;
+    return NULL;
+  }
+  std::map<long, line_cache_entry>::iterator it = file->lines.find(offset);
+  if (it != file->lines.end())
+    return &it->second;
+  *reread = (settings->line_cache_size < LINE_CACHE_MAX);
+  return NULL;
+}
+
+/****************************************************************************/
+
+/*! cache_line
+
+Returned Value: line_cache_entry *
+   The new cache entry for the line just read by read_text.
+
+Side effects:
+   The text of the line and the offset of the next line are stored in
+   the cache of the current file. The block is filled in later by
+   parse_line, if the line is suitable.
+
+Called by: Interp::read
+
+*/
+
+line_cache_entry *Interp::cache_line(setup_pointer settings, long offset)
+{
+  line_cache_entry &entry = settings->line_cache_current->lines[offset];
+
+  entry.next_offset = ftell(settings->file_pointer);
+  entry.linetext = settings->linetext;
+  entry.blocktext = settings->blocktext;
+  entry.parsed = false;
+  entry.lathe_diameter_mode = false;
+  settings->line_cache_size++;
+  return &entry;
+}
+
+/****************************************************************************/
+
+/*! reset_line_cache
+
+Returned Value: none
+
+Side effects:
+   All cached lines are dropped, so that files are read afresh.
+
+Called by:
+   Interp::init
+   Interp::unwind_call
+   Interp::execute (at the end of an MDI command)
+
+*/
+
+void Interp::reset_line_cache(setup_pointer settings)
+{
+  settings->line_cache.clear();
+  settings->line_cache_current = NULL;
+  settings->line_cache_parsing = NULL;
+  settings->line_cache_size = 0;
+}
+
+/****************************************************************************/
+
+/*! read_cached_text
+
+Returned Value: int
+   INTERP_OK
+
+Side effects:
+   Same as read_text, for a line found by find_cached_line. The file is
+   positioned at the following line, as if it had been read.
+
+Called by: Interp::read
+
+*/
+
+int Interp::read_cached_text(
+    line_cache_entry *cached,  //!< the line as read before
+    FILE * inport,     //!< a file pointer for the input file
+    char *raw_line,    //!< array to write raw input line into
+    char *line,        //!< array for input line to be processed in
+    int *length)       //!< a pointer to an integer to be set
+{
+  fseek(inport, cached->next_offset, SEEK_SET);
+  _setup.sequence_number++;
+  strcpy(raw_line, cached->linetext.c_str());
+  strcpy(line, cached->blocktext.c_str());
+
+  _setup.parameter_occurrence = 0;      /* initialize parameter buffer */
+
+  if ((line[0] == 0) || ((line[0] == '/') && (GET_BLOCK_DELETE())))
+    *length = 0;
+  else
+    *length = strlen(line);
+
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
 /*! read_unary
 
 Returned Value: int
@@ -21,6 +21,7 @@
 #define BOOST_PYTHON_MAX_ARITY 4
 #endif
 #include <string.h>
+#include <unistd.h>
 #include "rs274ngc_interp.hh"
 #include <boost/python/object.hpp>
 
@@ -151,6 +152,10 @@ setup::setup() :
     call_level(0),
     sub_context{},
     call_state(0),
+    line_cache_current(NULL),
+    line_cache_size(0),
+    line_cache_parsing(NULL),
+    named_param_generation(0),
     adaptive_feed(0),
     feed_hold(0),
     loggingLevel(0),
@@ -161,6 +166,9 @@ setup::setup() :
     use_lazy_close(0),
     lazy_closing(0),
     wizard_root{},
+    ngc_file_index_fd(-1),
+    ngc_file_index_stale(false),
+    ngc_file_index_complete(false),
     tool_change_at_g30(0),
     tool_change_quill_up(0),
     tool_change_with_spindle_on(0),
@@ -188,6 +196,7 @@ setup::setup() :
 setup::~setup() {
     assert(!pythis || Py_IsInitialized());
     if(pythis) delete pythis;
+    if(ngc_file_index_fd >= 0) close(ngc_file_index_fd);
 }
 
 block_struct::block_struct ()
@@ -20,6 +20,8 @@
 //
 
 #define BOOST_PYTHON_MAX_ARITY 7
+#include <boost/python/extract.hpp>
+#include <boost/python/import.hpp>
 #include <boost/python/object.hpp>
 #include <boost/python/suite/indexing/map_indexing_suite.hpp>
 #include <map>
@@ -55,6 +57,32 @@ static bp::object remap_str( remap_struct &r) {
 				      r.remap_ngc, r.remap_py, r.epilog_func));
 }
 
+// compiled expressions remember the entry a named parameter was found in,
+// so removing or replacing entries has to bump the generation as
+// free_named_parameters() does
+static void named_params_changed()
+{
+    Interp &interp = bp::extract<Interp &>(bp::import("interpreter").attr("this"));
+    interp._setup.named_param_generation++;
+}
+
+static void parameter_map_delitem(parameter_map &m, const char *name)
+{
+    parameter_map_iterator pi = m.find(name);
+    if (pi == m.end()) {
+	PyErr_SetString(PyExc_KeyError, name);
+	bp::throw_error_already_set();
+    }
+    m.erase(pi);
+    named_params_changed();
+}
+
+static void set_named_params(context &c, const parameter_map &m)
+{
+    c.named_params = m;
+    named_params_changed();
+}
+
 void export_Internals()
 {
     using namespace boost::python;
@@ -77,7 +105,10 @@ void export_Internals()
 		       bp::make_function( active_settings_w(&saved_settings_wrapper),
 					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
 	.def_readwrite("context_status", &context::context_status)
-	.def_readwrite("named_params",  &context::named_params)
+	.add_property("named_params",
+		      bp::make_getter(&context::named_params,
+				      bp::return_internal_reference<>()),
+		      &set_named_params)
 
 	.def_readwrite("call_type",  &context::call_type)
 	//.def_readwrite("tupleargs",  &context::tupleargs)
@@ -113,5 +144,6 @@ void export_Internals()
 
     class_<parameter_map,noncopyable>("ParameterMap",no_init)
         .def(map_indexing_suite<parameter_map>())
+	.def("__delitem__", &parameter_map_delitem)
 	;
 }
@@ -394,7 +394,8 @@ public:
                                 setup_pointer settings);
  int move_endpoint_and_flush(setup_pointer, double, double);
  int parse_line(char *line, block_pointer block,
-                      setup_pointer settings);
+                      setup_pointer settings,
+                      line_cache_entry *cached = NULL);
  int precedence(int an_operator);
  int _read(const char *command);
  int read_a(char *line, int *counter, block_pointer block,
@@ -464,6 +465,8 @@ int read_dollar(char *line, int *counter, block_pointer block,
  int read_name(char *line, int *counter, char *nameBuf);
  int read_named_parameter(char *line, int *counter, double *double_ptr,
                           double *parameters, bool check_exists);
+ int named_parameter_value(const char *paramNameBuf, double *double_ptr,
+                          bool check_exists);
  int read_parameter(char *line, int *counter, double *double_ptr,
                           double *parameters, bool check_exists);
  int read_parameter_setting(char *line, int *counter,
@@ -478,6 +481,20 @@ int read_dollar(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_real_expression(char *line, int *counter,
                                 double *hold2, double *parameters);
+ compiled_expression *find_compiled_expression(char *line, int counter);
+ int compile_real_expression(char *line, int *counter,
+                                compiled_expression *expr);
+ int compile_real_value(char *line, int *counter, compiled_expression *expr);
+ int compile_parameter(char *line, int *counter, compiled_expression *expr,
+                          bool check_exists);
+ int compile_bracketed_parameter(char *line, int *counter,
+                          compiled_expression *expr, bool check_exists);
+ int compile_unary(char *line, int *counter, compiled_expression *expr);
+ int intern_named_param(const char *nameBuf);
+ int evaluate_expression(compiled_expression *expr, double *value,
+                          double *parameters);
+ int evaluate_named_param(int handle, double *value);
+ int expression_integer(double float_value, int *integer_ptr);
  int read_real_number(char *line, int *counter, double *double_ptr);
  int read_real_value(char *line, int *counter, double *double_ptr,
                            double *parameters);
@@ -487,6 +504,12 @@ int read_dollar(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_text(const char *command, FILE * inport, char *raw_line,
                      char *line, int *length);
+ int read_cached_text(line_cache_entry *cached, FILE * inport,
+                     char *raw_line, char *line, int *length);
+ line_cache_entry *find_cached_line(setup_pointer settings, long offset,
+                     bool *reread);
+ line_cache_entry *cache_line(setup_pointer settings, long offset);
+ void reset_line_cache(setup_pointer settings);
  int read_unary(char *line, int *counter, double *double_ptr,
                       double *parameters);
  int read_u(char *line, int *counter, block_pointer block,
@@ -516,6 +539,10 @@ int read_dollar(char *line, int *counter, block_pointer block,
 		     char *direct,  // the directory to start looking in
 		     char *target,  // the name of the file to find
 		     char *foundFileDirect); // where to store the result
+ int index_ngc_dir(setup_pointer settings, const char *direct, bool recurse);
+ void build_ngc_file_index(setup_pointer settings);
+ bool find_indexed_ngc_file(setup_pointer settings, const char *fileName,
+			    const char **path);
 
  int control_save_offset(    /* ARGUMENTS                   */
 			 // int line,                  /* (o-word) line number        */
@@ -346,6 +346,7 @@ int Interp::_execute(const char *command)
       if (MDImode) {
 	  FINISH();
           _setup.offset_map.clear();
+          reset_line_cache(&_setup);
       }
       return INTERP_OK;
     }
@@ -982,6 +983,7 @@ int Interp::init()
           {
               logDebug("SUBROUTINE_PATH not found");
           }
+          build_ngc_file_index(&_setup);
           // subroutine to execute on aborts - for instance to retract
           // toolchange HAL pins
           if (NULL != (inistring = inifile.Find("ON_ABORT_COMMAND", "RS274NGC"))) {
@@ -1196,6 +1198,7 @@ int Interp::init()
   _setup.defining_sub = 0;
   _setup.skipping_o = 0;
   _setup.offset_map.clear();
+  reset_line_cache(&_setup);
 
   _setup.lathe_diameter_mode = false;
   _setup.parameters[5599] = 1.0; // enable (DEBUG, ) output
@@ -1599,14 +1602,28 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
   _setup.parameters[5427] = _setup.v_current;
   _setup.parameters[5428] = _setup.w_current;
 
+  line_cache_entry *cached = NULL;
+  bool reread = false;
+
   if(_setup.file_pointer)
   {
       EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
+      if (command == NULL)
+	  cached = find_cached_line(&_setup, EXECUTING_BLOCK(_setup).offset,
+				    &reread);
   }
 
-  read_status =
-    read_text(command, _setup.file_pointer, _setup.linetext,
-              _setup.blocktext, &_setup.line_length);
+  if (cached)
+    read_status =
+      read_cached_text(cached, _setup.file_pointer, _setup.linetext,
+		       _setup.blocktext, &_setup.line_length);
+  else
+    read_status =
+      read_text(command, _setup.file_pointer, _setup.linetext,
+		_setup.blocktext, &_setup.line_length);
+
+  if (reread && (read_status == INTERP_OK))
+    cached = cache_line(&_setup, EXECUTING_BLOCK(_setup).offset);
 
   if (read_status == INTERP_ERROR && _setup.skipping_to_sub) {
     _setup.skipping_to_sub = NULL;
@@ -1618,7 +1635,8 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
   if ((read_status == INTERP_EXECUTE_FINISH)
       || (read_status == INTERP_OK)) {
     if (_setup.line_length != 0) {
-	CHP(parse_line(_setup.blocktext, &(EXECUTING_BLOCK(_setup)), &_setup));
+	CHP(parse_line(_setup.blocktext, &(EXECUTING_BLOCK(_setup)), &_setup,
+		       cached));
     }
 
     else // Blank line (zero length)
@@ -1709,6 +1727,7 @@ int Interp::unwind_call(int status, const char *file, int line, const char *func
     _setup.skipping_o = 0;
     _setup.skipping_to_sub = 0;
     _setup.offset_map.clear();
+    reset_line_cache(&_setup);
     _setup.mdi_interrupt = false;
 
     qc_reset();
@@ -2535,6 +2554,22 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
     // find subroutine by search: program_prefix, subroutines, wizard_root
     // use first file found
 
+    // the index knows where, if the directories can be watched; a name
+    // it doesn't hold is only missing if it proves that, else search
+    const char *indexed;
+    if (find_indexed_ngc_file(settings, tmpFileName, &indexed)) {
+	if (!indexed)
+	    return NULL;
+	newFP = fopen(indexed, "r");
+	if (newFP) {
+	    if (foundhere)
+		strcpy(foundhere, indexed);
+	    return newFP;
+	}
+	// gone before the event arrived, search as usual
+	settings->ngc_file_index_stale = true;
+    }
+
     // first look in the program_prefix place
     sprintf(newFileName, "%s/%s", settings->program_prefix, tmpFileName);
     newFP = fopen(newFileName, "r");
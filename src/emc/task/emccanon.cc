@@ -139,6 +139,10 @@ struct AccelData{
 static PM_QUATERNION quat(1, 0, 0, 0);
 
 static void flush_segments(void);
+static void arc_move(int line_number, CANON_POSITION endpt,
+                     PM_CARTESIAN end_cart, PM_CARTESIAN center_cart,
+                     PM_CARTESIAN normal_cart, PM_CARTESIAN plane_x,
+                     PM_CARTESIAN plane_y, int shift_ind, int rotation);
 
 /*
   These decls were from the old 3-axis canon.hh, and refer functions
@@ -856,6 +860,85 @@ static void drop_segments(void) {
     chained_points.clear();
 }
 
+/* true if every chained point is within tolerance of the line from the
+   current end point to (x, y, z) */
+static bool fits_line(double x, double y, double z) {
+    PM_CARTESIAN M(x-canon.endPoint.x, y-canon.endPoint.y, z-canon.endPoint.z),
+                 B(canon.endPoint.x, canon.endPoint.y, canon.endPoint.z);
+    double mm = dot(M, M);
+    for(std::vector<struct pt>::iterator it = chained_points.begin();
+            it != chained_points.end(); it++) {
+        PM_CARTESIAN P(it->x, it->y, it->z);
+        double t0 = mm > 0 ? dot(M, P-B) / mm : 0;
+        if(t0 < 0) t0 = 0;
+        if(t0 > 1) t0 = 1;
+
+        double D = mag(P - (B + t0 * M));
+        if(D > canon.naivecamTolerance) return false;
+    }
+    return true;
+}
+
+struct arc_fit { double cx, cy; int rotation; };
+
+/* Try to fit the current end point and all chained points with a single
+   XY arc (helical in Z) so the whole run can be sent as one circular
+   move.  The circle goes through the start, middle and last points; every
+   point must lie within tolerance of it radially, progress monotonically
+   around it by less than a full turn, and have a Z within tolerance of the
+   helix.  The chords between points must also stay within tolerance of the
+   arc, so a coarse polygon is not mistaken for a circle. */
+static bool fits_arc(struct arc_fit &fit) {
+    unsigned n = chained_points.size();
+    if(n < 2 || canon.activePlane != CANON_PLANE_XY) return false;
+
+    double tol = canon.naivecamTolerance;
+    double sx = canon.endPoint.x, sy = canon.endPoint.y, sz = canon.endPoint.z;
+    struct pt &m = chained_points[(n-1)/2], &e = chained_points.back();
+
+    double bx = m.x - sx, by = m.y - sy, ex = e.x - sx, ey = e.y - sy;
+    double b2 = bx*bx + by*by, e2 = ex*ex + ey*ey;
+    double d = 2 * (bx*ey - by*ex);
+    // (nearly) collinear: the line test already had its chance
+    if(fabs(d) <= 1e-9 * (b2 + e2)) return false;
+
+    double ux = (ey*b2 - by*e2) / d, uy = (bx*e2 - ex*b2) / d;
+    double r = hypot(ux, uy);
+    fit.cx = sx + ux;
+    fit.cy = sy + uy;
+    fit.rotation = d > 0 ? 1 : -1;
+
+    double theta = atan2(sy - fit.cy, sx - fit.cx), total = 0;
+    for(unsigned i = 0; i < n; i++) {
+        struct pt &p = chained_points[i];
+        if(fabs(hypot(p.x - fit.cx, p.y - fit.cy) - r) > tol) return false;
+        double next = atan2(p.y - fit.cy, p.x - fit.cx);
+        double step = fit.rotation * (next - theta);
+        while(step > M_PI) step -= 2 * M_PI;
+        while(step <= -M_PI) step += 2 * M_PI;
+        if(step <= 0) return false;
+        if(r * (1 - cos(step / 2)) > tol) return false;
+        total += step;
+        theta = next;
+    }
+    if(total >= 2 * M_PI) return false;
+
+    double dz = e.z - sz;
+    theta = atan2(sy - fit.cy, sx - fit.cx);
+    double swept = 0;
+    for(unsigned i = 0; i < n; i++) {
+        struct pt &p = chained_points[i];
+        double next = atan2(p.y - fit.cy, p.x - fit.cx);
+        double step = fit.rotation * (next - theta);
+        while(step > M_PI) step -= 2 * M_PI;
+        while(step <= -M_PI) step += 2 * M_PI;
+        swept += step;
+        theta = next;
+        if(fabs(p.z - (sz + dz * swept / total)) > tol) return false;
+    }
+    return true;
+}
+
 static void flush_segments(void) {
     if(chained_points.empty()) return;
 
@@ -872,6 +955,17 @@ static void flush_segments(void) {
     printf("\n");
 #endif
 
+    struct arc_fit fit;
+    if(!fits_line(x, y, z) && fits_arc(fit)) {
+        CANON_POSITION endpt(x, y, z, a, b, c, u, v, w);
+        PM_CARTESIAN end_cart(x, y, z), center_cart(fit.cx, fit.cy, z);
+        drop_segments();
+        arc_move(line_no, endpt, end_cart, center_cart,
+                 PM_CARTESIAN(0.0, 0.0, 1.0), PM_CARTESIAN(1.0, 0.0, 0.0),
+                 PM_CARTESIAN(0.0, 1.0, 0.0), 0, fit.rotation);
+        return;
+    }
+
     VelData linedata = getStraightVelocity(x, y, z, a, b, c, u, v, w);
     double vel = linedata.vel;
 
@@ -957,20 +1051,16 @@ linkable(double x, double y, double z,
     if(w != pos.w) return false;
 
     if(x==canon.endPoint.x && y==canon.endPoint.y && z==canon.endPoint.z) return false;
-    
-    for(std::vector<struct pt>::iterator it = chained_points.begin();
-            it != chained_points.end(); it++) {
-        PM_CARTESIAN M(x-canon.endPoint.x, y-canon.endPoint.y, z-canon.endPoint.z),
-                     B(canon.endPoint.x, canon.endPoint.y, canon.endPoint.z),
-                     P(it->x, it->y, it->z);
-        double t0 = dot(M, P-B) / dot(M, M);
-        if(t0 < 0) t0 = 0;
-        if(t0 > 1) t0 = 1;
 
-        double D = mag(P - (B + t0 * M));
-        if(D > canon.naivecamTolerance) return false;
-    }
-    return true;
+    if(fits_line(x, y, z)) return true;
+
+    // Not straight enough; see whether the points bend along an arc
+    struct arc_fit fit;
+    pt next = {x, y, z, a, b, c, u, v, w, 0};
+    chained_points.push_back(next);
+    bool ok = fits_arc(fit);
+    chained_points.pop_back();
+    return ok;
 }
 
 static void
@@ -1449,138 +1539,21 @@ static double axis_acc_time(const CANON_POSITION & start, const CANON_POSITION &
 }
 #endif
 
-void ARC_FEED(int line_number,
-              double first_end, double second_end,
-	      double first_axis, double second_axis, int rotation,
-	      double axis_end_point, 
-              double a, double b, double c,
-              double u, double v, double w)
+/*
+  Emit a circular (or, for rotation 0, linear) move from the current end
+  point.  All positions and basis vectors are in canon units, already
+  rotated and offset; shift_ind selects the active plane as in ARC_FEED.
+*/
+static void arc_move(int line_number, CANON_POSITION endpt,
+                     PM_CARTESIAN end_cart, PM_CARTESIAN center_cart,
+                     PM_CARTESIAN normal_cart, PM_CARTESIAN plane_x,
+                     PM_CARTESIAN plane_y, int shift_ind, int rotation)
 {
-
     EMC_TRAJ_CIRCULAR_MOVE circularMoveMsg;
     EMC_TRAJ_LINEAR_MOVE linearMoveMsg;
 
-    canon_debug("line = %d\n", line_number);
-    canon_debug("first_end = %f, second_end = %f\n", first_end,second_end);
-
-    if( canon.activePlane == CANON_PLANE_XY && canon.motionMode == CANON_CONTINUOUS) {
-        double mx, my;
-        double lx, ly, lz;
-        double unused;
-
-        get_last_pos(lx, ly, lz);
-
-        double fe=FROM_PROG_LEN(first_end), se=FROM_PROG_LEN(second_end), ae=FROM_PROG_LEN(axis_end_point);
-        double fa=FROM_PROG_LEN(first_axis), sa=FROM_PROG_LEN(second_axis);
-        rotate_and_offset_pos(fe, se, ae, unused, unused, unused, unused, unused, unused);
-        rotate_and_offset_pos(fa, sa, unused, unused, unused, unused, unused, unused, unused);
-        if (chord_deviation(lx, ly, fe, se, fa, sa, rotation, mx, my) < canon.naivecamTolerance) {
-            a = FROM_PROG_ANG(a);
-            b = FROM_PROG_ANG(b);
-            c = FROM_PROG_ANG(c);
-            u = FROM_PROG_LEN(u);
-            v = FROM_PROG_LEN(v);
-            w = FROM_PROG_LEN(w);
-
-            rotate_and_offset_pos(unused, unused, unused, a, b, c, u, v, w);
-            see_segment(line_number, mx, my,
-                        (lz + ae)/2, 
-                        (canon.endPoint.a + a)/2, 
-                        (canon.endPoint.b + b)/2, 
-                        (canon.endPoint.c + c)/2, 
-                        (canon.endPoint.u + u)/2, 
-                        (canon.endPoint.v + v)/2, 
-                        (canon.endPoint.w + w)/2);
-            see_segment(line_number, fe, se, ae, a, b, c, u, v, w);
-            return;
-        }
-    }
-
     linearMoveMsg.feed_mode = canon.feed_mode;
     circularMoveMsg.feed_mode = canon.feed_mode;
-    flush_segments();
-
-    // Start by defining 3D points for the motion end and center.
-    PM_CARTESIAN end_cart(first_end, second_end, axis_end_point);
-    PM_CARTESIAN center_cart(first_axis, second_axis, axis_end_point);
-    PM_CARTESIAN normal_cart(0.0,0.0,1.0);
-    PM_CARTESIAN plane_x(1.0,0.0,0.0);
-    PM_CARTESIAN plane_y(0.0,1.0,0.0);
-
-
-    canon_debug("start = %f %f %f\n",
-            canon.endPoint.x,
-            canon.endPoint.y,
-            canon.endPoint.z);
-    canon_debug("end = %f %f %f\n",
-            end_cart.x,
-            end_cart.y,
-            end_cart.z);
-    canon_debug("center = %f %f %f\n",
-            center_cart.x,
-            center_cart.y,
-            center_cart.z);
-
-    // Rearrange the X Y Z coordinates in the correct order based on the active plane (XY, YZ, or XZ)
-    // KLUDGE CANON_PLANE is 1-indexed, hence the subtraction here to make a 0-index value
-    int shift_ind = 0;
-    switch(canon.activePlane) {
-        case CANON_PLANE_XY:
-            shift_ind = 0;
-            break;
-        case CANON_PLANE_XZ:
-            shift_ind = -2;
-            break;
-        case CANON_PLANE_YZ:
-            shift_ind = -1;
-            break;
-        case CANON_PLANE_UV:
-        case CANON_PLANE_VW:
-        case CANON_PLANE_UW:
-            CANON_ERROR("Can't set plane in UVW axes, assuming XY");
-            break;
-    }
-
-    canon_debug("active plane is %d, shift_ind is %d\n",canon.activePlane,shift_ind);
-    end_cart = circshift(end_cart, shift_ind);
-    center_cart = circshift(center_cart, shift_ind);
-    normal_cart = circshift(normal_cart, shift_ind);
-    plane_x = circshift(plane_x, shift_ind);
-    plane_y = circshift(plane_y, shift_ind);
-
-    canon_debug("normal = %f %f %f\n",
-            normal_cart.x,
-            normal_cart.y,
-            normal_cart.z);
-
-    canon_debug("plane_x = %f %f %f\n",
-            plane_x.x,
-            plane_x.y,
-            plane_x.z);
-
-    canon_debug("plane_y = %f %f %f\n",
-            plane_y.x,
-            plane_y.y,
-            plane_y.z);
-    // Define end point in PROGRAM units and convert to CANON
-    CANON_POSITION endpt(0,0,0,a,b,c,u,v,w);
-    from_prog(endpt);
-
-    // Store permuted XYZ end position
-    from_prog_len(end_cart);
-    endpt.set_xyz(end_cart);
-
-    // Convert to CANON units
-    from_prog_len(center_cart);
-
-    // Rotate and offset the new end point to be in the same coordinate system as the current end point
-    rotate_and_offset(endpt);
-    rotate_and_offset_xyz(center_cart);
-    rotate_and_offset_xyz(end_cart);
-    // Also rotate the basis vectors
-    to_rotated(plane_x);
-    to_rotated(plane_y);
-    to_rotated(normal_cart);
 
     canon_debug("end = %f %f %f\n",
             end_cart.x,
@@ -1816,6 +1789,137 @@ void ARC_FEED(int line_number,
 }
 
 
+void ARC_FEED(int line_number,
+              double first_end, double second_end,
+	      double first_axis, double second_axis, int rotation,
+	      double axis_end_point, 
+              double a, double b, double c,
+              double u, double v, double w)
+{
+    canon_debug("line = %d\n", line_number);
+    canon_debug("first_end = %f, second_end = %f\n", first_end,second_end);
+
+    if( canon.activePlane == CANON_PLANE_XY && canon.motionMode == CANON_CONTINUOUS) {
+        double mx, my;
+        double lx, ly, lz;
+        double unused;
+
+        get_last_pos(lx, ly, lz);
+
+        double fe=FROM_PROG_LEN(first_end), se=FROM_PROG_LEN(second_end), ae=FROM_PROG_LEN(axis_end_point);
+        double fa=FROM_PROG_LEN(first_axis), sa=FROM_PROG_LEN(second_axis);
+        rotate_and_offset_pos(fe, se, ae, unused, unused, unused, unused, unused, unused);
+        rotate_and_offset_pos(fa, sa, unused, unused, unused, unused, unused, unused, unused);
+        if (chord_deviation(lx, ly, fe, se, fa, sa, rotation, mx, my) < canon.naivecamTolerance) {
+            a = FROM_PROG_ANG(a);
+            b = FROM_PROG_ANG(b);
+            c = FROM_PROG_ANG(c);
+            u = FROM_PROG_LEN(u);
+            v = FROM_PROG_LEN(v);
+            w = FROM_PROG_LEN(w);
+
+            rotate_and_offset_pos(unused, unused, unused, a, b, c, u, v, w);
+            see_segment(line_number, mx, my,
+                        (lz + ae)/2, 
+                        (canon.endPoint.a + a)/2, 
+                        (canon.endPoint.b + b)/2, 
+                        (canon.endPoint.c + c)/2, 
+                        (canon.endPoint.u + u)/2, 
+                        (canon.endPoint.v + v)/2, 
+                        (canon.endPoint.w + w)/2);
+            see_segment(line_number, fe, se, ae, a, b, c, u, v, w);
+            return;
+        }
+    }
+
+    flush_segments();
+
+    // Start by defining 3D points for the motion end and center.
+    PM_CARTESIAN end_cart(first_end, second_end, axis_end_point);
+    PM_CARTESIAN center_cart(first_axis, second_axis, axis_end_point);
+    PM_CARTESIAN normal_cart(0.0,0.0,1.0);
+    PM_CARTESIAN plane_x(1.0,0.0,0.0);
+    PM_CARTESIAN plane_y(0.0,1.0,0.0);
+
+
+    canon_debug("start = %f %f %f\n",
+            canon.endPoint.x,
+            canon.endPoint.y,
+            canon.endPoint.z);
+    canon_debug("end = %f %f %f\n",
+            end_cart.x,
+            end_cart.y,
+            end_cart.z);
+    canon_debug("center = %f %f %f\n",
+            center_cart.x,
+            center_cart.y,
+            center_cart.z);
+
+    // Rearrange the X Y Z coordinates in the correct order based on the active plane (XY, YZ, or XZ)
+    // KLUDGE CANON_PLANE is 1-indexed, hence the subtraction here to make a 0-index value
+    int shift_ind = 0;
+    switch(canon.activePlane) {
+        case CANON_PLANE_XY:
+            shift_ind = 0;
+            break;
+        case CANON_PLANE_XZ:
+            shift_ind = -2;
+            break;
+        case CANON_PLANE_YZ:
+            shift_ind = -1;
+            break;
+        case CANON_PLANE_UV:
+        case CANON_PLANE_VW:
+        case CANON_PLANE_UW:
+            CANON_ERROR("Can't set plane in UVW axes, assuming XY");
+            break;
+    }
+
+    canon_debug("active plane is %d, shift_ind is %d\n",canon.activePlane,shift_ind);
+    end_cart = circshift(end_cart, shift_ind);
+    center_cart = circshift(center_cart, shift_ind);
+    normal_cart = circshift(normal_cart, shift_ind);
+    plane_x = circshift(plane_x, shift_ind);
+    plane_y = circshift(plane_y, shift_ind);
+
+    canon_debug("normal = %f %f %f\n",
+            normal_cart.x,
+            normal_cart.y,
+            normal_cart.z);
+
+    canon_debug("plane_x = %f %f %f\n",
+            plane_x.x,
+            plane_x.y,
+            plane_x.z);
+
+    canon_debug("plane_y = %f %f %f\n",
+            plane_y.x,
+            plane_y.y,
+            plane_y.z);
+    // Define end point in PROGRAM units and convert to CANON
+    CANON_POSITION endpt(0,0,0,a,b,c,u,v,w);
+    from_prog(endpt);
+
+    // Store permuted XYZ end position
+    from_prog_len(end_cart);
+    endpt.set_xyz(end_cart);
+
+    // Convert to CANON units
+    from_prog_len(center_cart);
+
+    // Rotate and offset the new end point to be in the same coordinate system as the current end point
+    rotate_and_offset(endpt);
+    rotate_and_offset_xyz(center_cart);
+    rotate_and_offset_xyz(end_cart);
+    // Also rotate the basis vectors
+    to_rotated(plane_x);
+    to_rotated(plane_y);
+    to_rotated(normal_cart);
+
+    arc_move(line_number, endpt, end_cart, center_cart, normal_cart,
+             plane_x, plane_y, shift_ind, rotation);
+}
+
 void DWELL(double seconds)
 {
     EMC_TRAJ_DELAY delayMsg;
@@ -102,6 +102,13 @@ static RCS_CMD_MSG *emcCommand = 0;
 // global EMC status
 EMC_STAT *emcStatus = 0;
 
+// copy of emcStatus as last written to emcStatusBuffer, see emcStatusPublish()
+static EMC_STAT *emcStatusPublished = 0;
+static double emcStatusPublishedTime = 0.0;
+
+/* how often the status is written when only the heartbeats change */
+#define EMC_STAT_HEARTBEAT_PERIOD 0.1
+
 // timer stuff
 static RCS_TIMER *timer = 0;
 
@@ -895,6 +902,7 @@ static int emcTaskPlan(void)
 	    case EMC_JOINT_HALT_TYPE:
 	    case EMC_JOINT_HOME_TYPE:
 	    case EMC_JOINT_UNHOME_TYPE:
+	    case EMC_JOINT_LOAD_COMP_TYPE:
 	    case EMC_JOG_CONT_TYPE:
 	    case EMC_JOG_INCR_TYPE:
 	    case EMC_JOG_ABS_TYPE:
@@ -1011,6 +1019,7 @@ static int emcTaskPlan(void)
 		case EMC_JOINT_SET_FERROR_TYPE:
 		case EMC_JOINT_SET_MIN_FERROR_TYPE:
 		case EMC_JOINT_UNHOME_TYPE:
+		case EMC_JOINT_LOAD_COMP_TYPE:
 		case EMC_TRAJ_PAUSE_TYPE:
 		case EMC_TRAJ_RESUME_TYPE:
 		case EMC_TRAJ_ABORT_TYPE:
@@ -1116,6 +1125,7 @@ static int emcTaskPlan(void)
 		case EMC_JOINT_SET_FERROR_TYPE:
 		case EMC_JOINT_SET_MIN_FERROR_TYPE:
 		case EMC_JOINT_UNHOME_TYPE:
+		case EMC_JOINT_LOAD_COMP_TYPE:
 		case EMC_TRAJ_PAUSE_TYPE:
 		case EMC_TRAJ_RESUME_TYPE:
 		case EMC_TRAJ_ABORT_TYPE:
@@ -1188,6 +1198,7 @@ static int emcTaskPlan(void)
 		case EMC_JOINT_SET_FERROR_TYPE:
 		case EMC_JOINT_SET_MIN_FERROR_TYPE:
 		case EMC_JOINT_UNHOME_TYPE:
+		case EMC_JOINT_LOAD_COMP_TYPE:
 		case EMC_TRAJ_PAUSE_TYPE:
 		case EMC_TRAJ_RESUME_TYPE:
 		case EMC_TRAJ_ABORT_TYPE:
@@ -1274,6 +1285,7 @@ static int emcTaskPlan(void)
 		case EMC_JOINT_SET_FERROR_TYPE:
 		case EMC_JOINT_SET_MIN_FERROR_TYPE:
 		case EMC_JOINT_UNHOME_TYPE:
+		case EMC_JOINT_LOAD_COMP_TYPE:
 		case EMC_TRAJ_PAUSE_TYPE:
 		case EMC_TRAJ_RESUME_TYPE:
 		case EMC_TRAJ_ABORT_TYPE:
@@ -1356,6 +1368,7 @@ static int emcTaskPlan(void)
 	    case EMC_JOINT_SET_FERROR_TYPE:
 	    case EMC_JOINT_SET_MIN_FERROR_TYPE:
 	    case EMC_JOINT_UNHOME_TYPE:
+	    case EMC_JOINT_LOAD_COMP_TYPE:
 	    case EMC_TRAJ_SET_SCALE_TYPE:
 	    case EMC_TRAJ_SET_RAPID_SCALE_TYPE:
 	    case EMC_TRAJ_SET_MAX_VELOCITY_TYPE:
@@ -3114,9 +3127,43 @@ static int emctask_shutdown(void)
 	delete emcStatus;
 	emcStatus = 0;
     }
+
+    if (0 != emcStatusPublished) {
+	delete emcStatusPublished;
+	emcStatusPublished = 0;
+    }
     return 0;
 }
 
+/*
+  emcStatusPublish() writes emcStatus to the status buffer if it differs
+  from what was written last. The heartbeats count cycles, so they are
+  left out of the comparison and are only written on their own every
+  EMC_STAT_HEARTBEAT_PERIOD. A machine sitting idle then does not bump
+  the buffer every cycle, and peek()ing user interfaces and remote
+  subscribers only see new data when there is some.
+*/
+static void emcStatusPublish()
+{
+    double now = etime();
+
+    if (0 == emcStatusPublished) {
+	emcStatusPublished = new EMC_STAT;
+    } else if (now - emcStatusPublishedTime < EMC_STAT_HEARTBEAT_PERIOD) {
+	emcStatusPublished->task.heartbeat = emcStatus->task.heartbeat;
+	emcStatusPublished->motion.heartbeat = emcStatus->motion.heartbeat;
+	emcStatusPublished->io.heartbeat = emcStatus->io.heartbeat;
+	if (!memcmp((void *) emcStatusPublished, (void *) emcStatus,
+		    sizeof(EMC_STAT))) {
+	    return;
+	}
+    }
+
+    emcStatusBuffer->write(emcStatus);
+    memcpy((void *) emcStatusPublished, (void *) emcStatus, sizeof(EMC_STAT));
+    emcStatusPublishedTime = now;
+}
+
 static int iniLoad(const char *filename)
 {
     IniFile inifile;
@@ -3536,7 +3583,7 @@ int main(int argc, char *argv[])
 	// since emcStatus was passed to the WM init functions, it
 	// will be updated in the _update() functions above. There's
 	// no need to call the individual functions on all WM items.
-	emcStatusBuffer->write(emcStatus);
+	emcStatusPublish();
 
 	// wait on timer cycle, if specified, or calculate actual
 	// interval if ini file says to run full out via
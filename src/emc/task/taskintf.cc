@@ -2029,6 +2029,12 @@ int emcSetMaxFeedOverride(double maxFeedScale) {
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcSetMaxJerk(double maxJerk) {
+    emcmotCommand.command = EMCMOT_SET_MAX_JERK;
+    emcmotCommand.maxJerk = maxJerk;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcSetProbeErrorInhibit(int j_inhibit, int h_inhibit) {
     emcmotCommand.command = EMCMOT_SET_PROBE_ERR_INHIBIT;
     emcmotCommand.probe_jog_err_inhibit = j_inhibit;
@@ -1858,3 +1858,131 @@ double pmCircleEffectiveMinRadius(PmCircle const * circle)
     return effective_radius;
 }
 
+
+
+/**
+ * Find the highest velocity from which a segment can slow to v_final within
+ * a given distance, if acceleration can change no faster than j_max.
+ * The slowdown starts and ends at zero acceleration. For j_max <= 0 this is
+ * the usual constant-acceleration result.
+ */
+double findSCurveVPeak(double a_t_max, double j_max, double v_final, double distance)
+{
+    if (distance <= 0.0) {
+        return v_final;
+    }
+    if (j_max <= 0.0) {
+        return pmSqrt(pmSq(v_final) + 2.0 * a_t_max * distance);
+    }
+
+    // Velocity change and distance needed to just reach a_t_max
+    double dv_full = pmSq(a_t_max) / j_max;
+    double d_full = (2.0 * v_final + dv_full) * a_t_max / j_max;
+
+    if (distance >= d_full) {
+        // Constant deceleration between the jerk ramps, so
+        // d = (v^2 - v_f^2) / (2 a) + (v + v_f) a / (2 j)
+        double c = v_final * dv_full - pmSq(v_final) - 2.0 * a_t_max * distance;
+        return (-dv_full + pmSqrt(pmSq(dv_full) - 4.0 * c)) / 2.0;
+    }
+
+    // Jerk ramps only, d = (2 v_f + dv) sqrt(dv / j). Solve
+    // s^3 + 2 v_f s - d sqrt(j) = 0 for s = sqrt(dv) by Newton's method,
+    // starting above the root so the iteration can't overshoot.
+    double p = 2.0 * v_final;
+    double q = distance * pmSqrt(j_max);
+    double s = pow(q, 1.0 / 3.0);
+    if (p > 0.0) {
+        s = fmin(s, q / p);
+    }
+    int i;
+    for (i = 0; i < 20; ++i) {
+        double ds = (s * s * s + p * s - q) / (3.0 * s * s + p);
+        s -= ds;
+        if (ds <= 1e-12 * s) {
+            break;
+        }
+    }
+    return v_final + pmSq(s);
+}
+
+
+/**
+ * Find the acceleration for one cycle which reaches a velocity change dv if
+ * every following cycle steps the acceleration back towards zero by
+ * j_max * dt. The last step may be smaller, so dv is met exactly. For
+ * j_max <= 0 the whole change is made in this cycle.
+ */
+double findSCurveAccelGoal(double dv, double j_max, double dt)
+{
+    if (dv <= 0.0 || dt <= 0.0) {
+        return 0.0;
+    }
+    double step = j_max * dt;
+    if (step <= 0.0) {
+        return dv / dt;
+    }
+    // With the acceleration at u steps, the velocity gained on the way down
+    // is (m + 1) u - m (m + 1) / 2 steps of dt, m being u rounded up, less 1
+    double g = dv / (step * dt);
+    double m = floor((pmSqrt(8.0 * g + 1.0) - 1.0) / 2.0);
+    return (g + m * (m + 1.0) / 2.0) / (m + 1.0) * step;
+}
+
+
+/**
+ * Advance a state by a constant-jerk phase and return the distance covered.
+ */
+static double jerkPhaseDistance(double * const v, double * const a,
+        double jerk, double t)
+{
+    double d = *v * t + *a * pmSq(t) / 2.0 + jerk * t * pmSq(t) / 6.0;
+    *v += *a * t + jerk * pmSq(t) / 2.0;
+    *a += jerk * t;
+    return d;
+}
+
+
+/**
+ * Find the shortest distance in which motion at velocity v and acceleration a
+ * can slow to v_final without exceeding a_t_max and j_max. If the velocity
+ * falls below v_final anyway while the acceleration returns to zero, this is
+ * the distance to the point where it crosses v_final.
+ */
+double findSCurveStopDistance(double v, double a, double v_final,
+        double a_t_max, double j_max)
+{
+    double a_peak;
+    double t_const = 0.0;
+    double dist = 0.0;
+
+    a = fmax(a, -a_t_max);
+
+    // Velocity change from ramping the acceleration straight back to zero
+    double dv_ramp = a * fabs(a) / (2.0 * j_max);
+    if (v + dv_ramp <= v_final) {
+        if (v <= v_final || a >= 0.0) {
+            return 0.0;
+        }
+        double t_cross = (-a - pmSqrt(pmSq(a) - 2.0 * j_max * (v - v_final))) / j_max;
+        return jerkPhaseDistance(&v, &a, j_max, t_cross);
+    }
+
+    // Deceleration from the ramp down to a_peak, a constant phase and a ramp
+    // back to zero has to remove exactly v - v_final
+    double excess = v - v_final + pmSq(a) / (2.0 * j_max);
+    t_const = (excess - pmSq(a_t_max) / j_max) / a_t_max;
+    if (t_const >= 0.0) {
+        a_peak = -a_t_max;
+    } else {
+        t_const = 0.0;
+        a_peak = -pmSqrt(excess * j_max);
+    }
+
+    if (a > a_peak) {
+        dist += jerkPhaseDistance(&v, &a, -j_max, (a - a_peak) / j_max);
+    }
+    dist += jerkPhaseDistance(&v, &a, 0.0, t_const);
+    dist += jerkPhaseDistance(&v, &a, j_max, -a / j_max);
+    return dist;
+}
@@ -259,6 +259,11 @@ int pmCircleAngleFromProgress(PmCircle const * const circle,
         double * const angle);
 double pmCircleEffectiveMinRadius(const PmCircle *circle);
 
+double findSCurveVPeak(double a_t_max, double j_max, double v_final, double distance);
+double findSCurveAccelGoal(double dv, double j_max, double dt);
+double findSCurveStopDistance(double v, double a, double v_final,
+        double a_t_max, double j_max);
+
 static inline double findVPeak(double a_t_max, double distance)
 {
     return pmSqrt(a_t_max * distance);
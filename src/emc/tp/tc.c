@@ -220,7 +220,7 @@ int tcCanConsume(TC_STRUCT const * const tc)
         return false;
     }
 
-    if (tc->syncdio.anychanged || tc->blend_prev || tc->atspeed) {
+    if (tc->syncdio >= 0 || tc->blend_prev || tc->atspeed) {
         //TODO add other conditions here (for any segment that should not be consumed by blending
         return false;
     }
@@ -638,6 +638,7 @@ int tcInit(TC_STRUCT * const tc,
 
     /** Segment settings (given values later during setup / optimization) */
     tc->indexer_jnum = -1;
+    tc->syncdio = -1;
 
     tc->active_depth = 1;
 
@@ -329,6 +329,35 @@ int tcqFull(TC_QUEUE_STRUCT const * const tcq)
     return 0;
 }
 
+/*! tcqRoom() function
+ *
+ * \brief get the number of elements that can be put before tcqFull() says full
+ *
+ * Function called by update_status() in control.c, to count the moves still
+ * waiting in the command ring against the queue
+ *
+ * @param    tcq       pointer to the TC_QUEUE_STRUCT
+ *
+ * @return	 int       returns number of free elements ahead of the margin
+ */
+int tcqRoom(TC_QUEUE_STRUCT const * const tcq)
+{
+    if (tcqCheck(tcq)) {
+        return 0;
+    }
+
+    if (tcq->size <= TC_QUEUE_MARGIN) {
+        /* no margin available, so only a really full queue has no room */
+        return tcq->allFull ? 0 : tcq->size - tcq->_len;
+    }
+
+    if (tcq->_len >= tcq->size - TC_QUEUE_MARGIN) {
+        return 0;
+    }
+
+    return tcq->size - TC_QUEUE_MARGIN - tcq->_len;
+}
+
 /*! tcqLast() function
  *
  * \brief gets the last TC element in the queue, without removing it
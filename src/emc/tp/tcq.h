@@ -72,4 +72,7 @@ extern TC_STRUCT * tcqLast(TC_QUEUE_STRUCT const * const tcq);
 /* get full status */
 extern int tcqFull(TC_QUEUE_STRUCT const * const tcq);
 
+/* how many tcs can be put before the queue is full */
+extern int tcqRoom(TC_QUEUE_STRUCT const * const tcq);
+
 #endif
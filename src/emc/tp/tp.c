@@ -130,6 +130,27 @@ STATIC double tpGetTangentKinkRatio(void) {
 }
 
 
+/**
+ * Jerk limit for coordinated motion from the INI file, or 0 for the
+ * trapezoidal planner.
+ */
+STATIC double tpGetMaxJerk(void) {
+    return fmax(emcmotConfig->maxJerk, 0.0);
+}
+
+
+/**
+ * Check if a segment should follow a jerk-limited velocity profile.
+ * Spindle-synced motion has to follow the spindle, so it keeps the
+ * trapezoidal profile.
+ */
+STATIC int tcUsesJerkLimit(TC_STRUCT const * const tc) {
+    return tpGetMaxJerk() > 0.0 &&
+        tc->motion_type != TC_RIGIDTAP &&
+        tc->synchronized == TC_SYNC_NONE;
+}
+
+
 STATIC int tpGetMachineAccelBounds(PmCartesian  * const acc_bound) {
     if (!acc_bound) {
         return TP_ERR_FAIL;
@@ -313,10 +334,12 @@ STATIC inline double tpGetSignedSpindlePosition(spindle_status_t *status) {
 
 /**
  * Create the trajectory planner structure with an empty queue.
+ * syncdioSpace must hold as many entries as the queue.
  */
-int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace)
+int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace,
+        syncdio_t * const syncdioSpace)
 {
-    if (0 == tp) {
+    if (0 == tp || 0 == syncdioSpace) {
         return TP_ERR_FAIL;
     }
 
@@ -330,6 +353,7 @@ int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace)
     if (-1 == tcqCreate(&tp->queue, tp->queueSize, tcSpace)) {
         return TP_ERR_FAIL;
     }
+    tp->syncdio_pool = syncdioSpace;
 
     /* init the rest of our data */
     return tpInit(tp);
@@ -382,6 +406,7 @@ int tpClear(TP_STRUCT * const tp)
     tp->reverse_run = 0;
     tp->synchronized = 0;
     tp->uu_per_rev = 0.0;
+    tp->syncdio_next = 0;
     emcmotStatus->current_vel = 0.0;
     emcmotStatus->requested_vel = 0.0;
     emcmotStatus->distance_to_go = 0.0;
@@ -669,7 +694,8 @@ STATIC double tpCalculateTriangleVel(TC_STRUCT const *tc) {
 STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_STRUCT * const tc)
 {
     double acc_scaled = tcGetTangentialMaxAccel(tc);
-    double triangle_vel = findVPeak(acc_scaled, tc->target);
+    // stop within the half of the segment a blend can't consume
+    double triangle_vel = findSCurveVPeak(acc_scaled, tpGetMaxJerk(), 0.0, tc->target / 2.0);
     double max_vel = tpGetMaxTargetVel(tp, tc);
     tp_debug_json_start(tpCalculateOptimizationInitialVel);
     tp_debug_json_double(triangle_vel);
@@ -714,7 +740,7 @@ STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
             acc);
 
     // Skip syncdio setup since this blend extends the previous line
-    blend_tc->syncdio = prev_tc->syncdio; //enqueue the list of DIOs that need toggling
+    blend_tc->syncdio = prev_tc->syncdio; //share the pool slot, so the DIOs are toggled only once
 
     // find "helix" length for target
     double length;
@@ -1425,13 +1451,21 @@ STATIC int tpCheckCanonType(TC_STRUCT * prev_tc, TC_STRUCT * tc)
     return TP_ERR_OK;
 }
 
+/**
+ * Hand the pending DIO changes to a new segment.
+ * Pool slots are handed out in queue order, and the pool is as large as the
+ * queue, so a slot is only reused once the segment that held it has left the
+ * queue.
+ */
 STATIC int tpSetupSyncedIO(TP_STRUCT * const tp, TC_STRUCT * const tc) {
     if (tp->syncdio.anychanged != 0) {
-        tc->syncdio = tp->syncdio; //enqueue the list of DIOs that need toggling
+        tc->syncdio = tp->syncdio_next;
+        tp->syncdio_pool[tc->syncdio] = tp->syncdio; //enqueue the list of DIOs that need toggling
+        tp->syncdio_next = (tp->syncdio_next + 1) % tp->queue.size;
         tpClearDIOs(tp); // clear out the list, in order to prepare for the next time we need to use it
         return TP_ERR_OK;
     } else {
-        tc->syncdio.anychanged = 0;
+        tc->syncdio = -1;
         return TP_ERR_NO_ACTION;
     }
 
@@ -1555,7 +1589,7 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
     double acc_this = tcGetTangentialMaxAccel(tc);
 
     // Find the reachable velocity of tc, moving backwards in time
-    double vs_back = pmSqrt(pmSq(tc->finalvel) + 2.0 * acc_this * tc->target);
+    double vs_back = findSCurveVPeak(acc_this, tpGetMaxJerk(), tc->finalvel, tc->target);
     // Find the reachable velocity of prev1_tc, moving forwards in time
 
     double vf_limit_this = tc->maxvel;
@@ -1592,9 +1626,15 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
  * Do "rising tide" optimization to find allowable final velocities for each queued segment.
  * Walk along the queue from the back to the front. Based on the "current"
  * segment's final velocity, calculate the previous segment's maximum allowable
- * final velocity. The depth we walk along the queue is controlled by the
- * TP_LOOKAHEAD_DEPTH constant for now. The process safetly aborts early due to
+ * final velocity. The depth we walk along the queue is limited by
+ * ARC_BLEND_OPTIMIZATION_DEPTH. The process safetly aborts early due to
  * a short queue or other conflicts.
+ *
+ * Each pass leaves every segment it visits consistent with the one after it,
+ * so once a recomputed final velocity comes out unchanged, everything further
+ * back is already up to date and the walk can stop. Adding a segment then
+ * only costs as many steps as the velocity change actually propagates, which
+ * lets the depth limit be large without slowing down long queues.
  */
 STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     // Pointers to the "current", previous, and 2nd previous trajectory
@@ -1684,7 +1724,16 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             }
             tc->finalvel = 0.0;
         } else {
+            double finalvel_old = prev1_tc->finalvel;
             tpComputeOptimalVelocity(tp, tc, prev1_tc);
+            // Adding a segment can also change the two before it (a blend
+            // arc and the segment it shortened), so always walk past them
+            if (x >= 3 && prev1_tc->finalvel == finalvel_old) {
+                tp_debug_print("Final velocity of segment %d unchanged, stopping optimization\n",
+                        prev1_tc->id);
+                tc->active_depth = x - 2 - hit_peaks;
+                return TP_ERR_OK;
+            }
         }
 
         tc->active_depth = x - 2 - hit_peaks;
@@ -2212,6 +2261,7 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
         tc->progress = bisaturate(tc->progress, tcGetTarget(tc, TC_DIR_FORWARD), tcGetTarget(tc, TC_DIR_REVERSE));
     }
     tc->currentvel = v_next;
+    tc->currentacc = v_next > 0.0 ? acc : 0.0;
 
     // Check if we can make the desired velocity
     tc->on_final_decel = (fabs(vel_desired - tc->currentvel) < TP_VEL_EPSILON) && (acc < 0.0);
@@ -2308,6 +2358,102 @@ void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp, TC_STRUCT * const t
     *vel_desired = maxnewvel;
 }
 
+/**
+ * Check if a segment can still slow to its final velocity in time after a
+ * cycle spent at the given acceleration.
+ * Each cycle holds its acceleration, which matches a continuous profile
+ * passing through that value mid-cycle. By the end of the cycle, the ramp
+ * back towards zero has moved on by half a step. The margin covers the
+ * distance by which the held steps of that ramp outrun the continuous one.
+ */
+STATIC int tcCanStopAfterAccel(TC_STRUCT const * const tc, double acc, double dx,
+        double v_final, double maxaccel, double jerk)
+{
+    double v_next = fmax(tc->currentvel + acc * tc->cycle_time, 0.0);
+    double dx_next = dx - (tc->currentvel + v_next) * 0.5 * tc->cycle_time;
+    double acc_next = acc + 0.5 * jerk * tc->cycle_time;
+    double margin = fabs(acc) * pmSq(tc->cycle_time) / 12.0;
+    return dx_next - margin >= findSCurveStopDistance(v_next, acc_next, v_final, maxaccel, jerk);
+}
+
+
+/**
+ * Compute the acceleration for a cycle with a jerk-limited (S-curve) profile.
+ * The acceleration moves towards the value that reaches the target velocity
+ * when ramped back to zero, changing by at most MAX_LINEAR_JERK * dt per
+ * cycle. Of those choices it takes the largest that still leaves room to slow
+ * to the final velocity under the same limits, without braking below the
+ * final velocity before the acceleration is back to zero. Only when no choice
+ * can stop in time does the trapezoidal result take over.
+ */
+STATIC int tpCalculateSCurveAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double * const acc,
+        double * const vel_desired)
+{
+    double acc_trap;
+    tpCalculateTrapezoidalAccel(tp, tc, nexttc, &acc_trap, vel_desired);
+    tc_debug_print("using S-curve acceleration\n");
+
+    double jerk = tpGetMaxJerk();
+    double maxaccel = tcGetTangentialMaxAccel(tc);
+    double dt = fmax(tc->cycle_time, TP_TIME_EPSILON);
+    double dx = tcGetDistanceToGo(tc, tp->reverse_run);
+    double v_final = tpGetRealFinalVel(tp, tc, nexttc);
+
+    // Acceleration for this cycle which, stepped back to zero by jerk * dt a
+    // cycle after it, arrives at the target velocity
+    double dv = tpGetRealTargetVel(tp, tc) - tc->currentvel;
+    double acc_goal = findSCurveAccelGoal(fabs(dv), jerk, dt);
+    if (dv < 0.0) {
+        acc_goal = -acc_goal;
+    }
+    acc_goal = saturate(acc_goal, maxaccel);
+
+    double acc_min = fmax(tc->currentacc - jerk * dt, -maxaccel);
+    double acc_hi = fmax(tc->currentacc + saturate(acc_goal - tc->currentacc, jerk * dt), acc_min);
+    // Braking harder than this drops below the final velocity before the
+    // acceleration is stepped back to zero
+    double acc_floor = -findSCurveAccelGoal(tc->currentvel - v_final, jerk, dt);
+    acc_floor = fmin(fmax(acc_floor, acc_min), acc_hi);
+
+    if (!tcCanStopAfterAccel(tc, acc_hi, dx, v_final, maxaccel, jerk)) {
+        // Stopping in time comes before reaching the final velocity smoothly
+        double acc_lo = acc_floor;
+        if (!tcCanStopAfterAccel(tc, acc_lo, dx, v_final, maxaccel, jerk)) {
+            acc_lo = acc_min;
+        }
+        if (!tcCanStopAfterAccel(tc, acc_lo, dx, v_final, maxaccel, jerk)) {
+            // Too late to stop within the jerk limit (e.g. after a feed
+            // override jump), so brake as the trapezoidal planner would
+            acc_hi = fmin(acc_lo, acc_trap);
+        } else {
+            // Bisect for the largest acceleration which still allows stopping
+            int i;
+            for (i = 0; i < 10; ++i) {
+                double acc_mid = (acc_lo + acc_hi) / 2.0;
+                if (tcCanStopAfterAccel(tc, acc_mid, dx, v_final, maxaccel, jerk)) {
+                    acc_lo = acc_mid;
+                } else {
+                    acc_hi = acc_mid;
+                }
+            }
+            acc_hi = acc_lo;
+        }
+    }
+    *acc = acc_hi;
+
+    // Coming to rest closer to the end than the smallest jerk-limited move
+    // could cover, so finish there
+    if (tc->currentvel + *acc * dt <= 0.0 && dx <= jerk * pmSq(dt) * dt) {
+        *acc = -tc->currentvel / dt;
+        tc->progress = tcGetTarget(tc, tp->reverse_run);
+    }
+
+    return TP_ERR_OK;
+}
+
 /**
  * Calculate "ramp" acceleration for a cycle.
  */
@@ -2357,21 +2503,26 @@ STATIC int tpCalculateRampAccel(TP_STRUCT const * const tp,
     return TP_ERR_OK;
 }
 
-void tpToggleDIOs(TC_STRUCT * const tc) {
+void tpToggleDIOs(TP_STRUCT * const tp, TC_STRUCT * const tc) {
 
     int i=0;
-    if (tc->syncdio.anychanged != 0) { // we have DIO's to turn on or off
+    if (tc->syncdio < 0) {
+        return;
+    }
+    syncdio_t * const syncdio = &tp->syncdio_pool[tc->syncdio];
+    if (syncdio->anychanged != 0) { // we have DIO's to turn on or off
         for (i=0; i < emcmotConfig->numDIO; i++) {
-            if (!(tc->syncdio.dio_mask & (1 << i))) continue;
-            if (tc->syncdio.dios[i] > 0) emcmotDioWrite(i, 1); // turn DIO[i] on
-            if (tc->syncdio.dios[i] < 0) emcmotDioWrite(i, 0); // turn DIO[i] off
+            if (!(syncdio->dio_mask & (1 << i))) continue;
+            if (syncdio->dios[i] > 0) emcmotDioWrite(i, 1); // turn DIO[i] on
+            if (syncdio->dios[i] < 0) emcmotDioWrite(i, 0); // turn DIO[i] off
         }
         for (i=0; i < emcmotConfig->numAIO; i++) {
-            if (!(tc->syncdio.aio_mask & (1 << i))) continue;
-            emcmotAioWrite(i, tc->syncdio.aios[i]); // set AIO[i]
+            if (!(syncdio->aio_mask & (1 << i))) continue;
+            emcmotAioWrite(i, syncdio->aios[i]); // set AIO[i]
         }
-        tc->syncdio.anychanged = 0; //we have turned them all on/off, nothing else to do for this TC the next time
+        syncdio->anychanged = 0;
     }
+    tc->syncdio = -1; //we have turned them all on/off, nothing else to do for this TC the next time
 }
 
 
@@ -2604,6 +2755,7 @@ STATIC int tpCompleteSegment(TP_STRUCT * const tp,
     tc->cycle_time = tp->cycleTime;
     //Velocities are by definition zero for a non-active segment
     tc->currentvel = 0.0;
+    tc->currentacc = 0.0;
     tc->term_vel = 0.0;
     //TODO make progress to match target?
     // done with this move
@@ -2912,7 +3064,7 @@ STATIC int tpDoParabolicBlending(TP_STRUCT * const tp, TC_STRUCT * const tc,
     if(tc->currentvel > nexttc->currentvel) {
         tpUpdateMovementStatus(tp, tc);
     } else {
-        tpToggleDIOs(nexttc);
+        tpToggleDIOs(tp, nexttc);
         tpUpdateMovementStatus(tp, nexttc);
     }
 #ifdef TP_SHOW_BLENDS
@@ -2949,9 +3101,12 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
     int res_accel = 1;
     double acc=0, vel_desired=0;
     
-    // If the slowdown is not too great, use velocity ramping instead of trapezoidal velocity
-    // Also, don't ramp up for parabolic blends
-    if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
+    if (tcUsesJerkLimit(tc)) {
+        // Jerk is limited directly, so there's no need for ramping
+        res_accel = tpCalculateSCurveAccel(tp, tc, nexttc, &acc, &vel_desired);
+    } else if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
+        // If the slowdown is not too great, use velocity ramping instead of trapezoidal velocity
+        // Also, don't ramp up for parabolic blends
         res_accel = tpCalculateRampAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
 
@@ -3177,6 +3332,7 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
         case TC_TERM_COND_TANGENT:
             nexttc->cycle_time = tp->cycleTime - tc->cycle_time;
             nexttc->currentvel = tc->term_vel;
+            nexttc->currentacc = tc->currentacc;
             tp_debug_print("Doing tangent split\n");
             break;
         case TC_TERM_COND_PARABOLIC:
@@ -3202,10 +3358,10 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
     // FIXME redundant tangent check, refactor to switch
     if (tc->cycle_time > nexttc->cycle_time && tc->term_cond == TC_TERM_COND_TANGENT) {
         //Majority of time spent in current segment
-        tpToggleDIOs(tc);
+        tpToggleDIOs(tp, tc);
         tpUpdateMovementStatus(tp, tc);
     } else {
-        tpToggleDIOs(nexttc);
+        tpToggleDIOs(tp, nexttc);
         tpUpdateMovementStatus(tp, nexttc);
     }
 
@@ -3243,7 +3399,7 @@ STATIC int tpHandleRegularCycle(TP_STRUCT * const tp,
         tpDoParabolicBlending(tp, tc, nexttc);
     } else {
         //Update status for a normal step
-        tpToggleDIOs(tc);
+        tpToggleDIOs(tp, tc);
         tpUpdateMovementStatus(tp, tc);
     }
     return TP_ERR_OK;
@@ -19,7 +19,8 @@
 #include "tp_types.h"
 #include "tcq.h"
 
-int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace);
+int tpCreate(TP_STRUCT * const tp, int _queueSize, TC_STRUCT * const tcSpace,
+        syncdio_t * const syncdioSpace);
 int tpClear(TP_STRUCT * const tp);
 int tpInit(TP_STRUCT * const tp);
 int tpClearDIOs(TP_STRUCT * const tp);
@@ -50,7 +51,7 @@ int tpQueueDepth(TP_STRUCT * const tp);
 int tpActiveDepth(TP_STRUCT * const tp);
 int tpGetMotionType(TP_STRUCT * const tp);
 int tpSetSpindleSync(TP_STRUCT * const tp, int spindle, double sync, int wait);
-void tpToggleDIOs(TC_STRUCT * const tc); //gets called when a new tc is taken from the queue. it checks and toggles all needed DIO's
+void tpToggleDIOs(TP_STRUCT * const tp, TC_STRUCT * const tc); //gets called when a new tc is taken from the queue. it checks and toggles all needed DIO's
 
 int tpSetAout(TP_STRUCT * const tp, unsigned char index, double start, double end);
 int tpSetDout(TP_STRUCT * const tp, int index, unsigned char start, unsigned char end); //gets called to place DIO toggles on the TC queue
@@ -133,6 +133,9 @@ typedef struct {
 
 
     syncdio_t syncdio; //record tpSetDout's here
+    syncdio_t *syncdio_pool;    /* synched DIO's of queued moves, kept out of
+                                   TC_STRUCT since few moves carry any */
+    int syncdio_next;           /* next pool slot to hand out */
 
 } TP_STRUCT;
 
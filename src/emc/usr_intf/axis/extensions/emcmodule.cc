@@ -285,9 +285,30 @@ static bool check_stat(RCS_STAT_CHANNEL *emcStatusBuffer) {
 
 static PyObject *poll(pyStatChannel *s, PyObject *o) {
     if(!check_stat(s->c)) return NULL;
-    if(s->c->peek() == EMC_STAT_TYPE) {
+    // Copy the status straight out of shared memory when the buffer allows
+    // it, rather than having peek() copy it once more on the way.  A copy
+    // that a writer overlapped is simply taken again.
+    bool use_peek = false, torn = false;
+    for(int tries = 0; tries < 10; tries++) {
+        CMS_VIEW view;
+        const NMLmsg *msg = s->c->view_begin(&view);
+        if(!view.data) {
+            use_peek = s->c->cms->status == CMS_NO_IMPLEMENTATION_ERROR;
+            break;
+        }
+        if(msg->type != EMC_STAT_TYPE || view.size < (long)sizeof(EMC_STAT)) {
+            s->c->view_end(&view);
+            break;
+        }
+        memcpy((void *) &s->status, (const void *) msg, sizeof(EMC_STAT));
+        torn = !s->c->view_end(&view);
+        if(!torn) break;
+    }
+    // peek() copies under the buffer lock, so it also settles a status
+    // that was still torn after the last try.
+    if((use_peek || torn) && s->c->peek() == EMC_STAT_TYPE) {
         EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_address());
-        memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+        memcpy((void *) &s->status, (void *) emcStatus, sizeof(EMC_STAT));
     }
     Py_INCREF(Py_None);
     return Py_None;
@@ -19,6 +19,7 @@
 
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <linux/sockios.h>
 #include <net/if_arp.h>
@@ -325,6 +326,7 @@ static char *hm2_7i97_pin_names[] = {
 #define SEND_TIMEOUT_US 10
 #define RECV_TIMEOUT_US 10
 #define READ_PCK_DELAY_NS 10000
+#define RECV_BATCH 4
 
 static hm2_eth_t boards[MAX_ETH_BOARDS];
 
@@ -332,6 +334,7 @@ static hm2_eth_t boards[MAX_ETH_BOARDS];
 
 static int eth_socket_send(int sockfd, const void *buffer, int len, int flags);
 static int eth_socket_recv(int sockfd, void *buffer, int len, int flags);
+static int hm2_eth_flush_write(hm2_eth_t *board);
 
 #define IPTABLES "/sbin/iptables"
 #define CHAIN "hm2-eth-rules-output"
@@ -639,6 +642,56 @@ static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
     return recv(sockfd, buffer, len, flags);
 }
 
+// Sleep until a packet is waiting on the socket or the deadline (in
+// rtapi_get_time units) passes.  Returns nonzero if a packet is waiting.
+static int eth_socket_wait(int sockfd, long long deadline) {
+    struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+    struct timespec ts = { 0, 0 };
+    long long remaining = deadline - rtapi_get_time();
+    if(remaining > 0) {
+        ts.tv_sec = remaining / 1000000000;
+        ts.tv_nsec = remaining % 1000000000;
+    }
+    return ppoll(&pfd, 1, &ts, NULL) > 0;
+}
+
+// Wait for the reply to a queued read, either by sleeping in the kernel
+// or, if the packet-read-busy-wait parameter is set, by polling the socket.
+// Replies which arrived after an earlier cycle timed out are still queued
+// ahead of the current one, so take up to RECV_BATCH packets at once and
+// keep the newest one with the expected length.
+static int eth_socket_recv_latest(hm2_eth_t *board, rtapi_u8 *buffer, int len, long long deadline) {
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+    rtapi_u8 extra[RECV_BATCH-1][len];
+    int i, n;
+
+    memset(msgs, 0, sizeof(msgs));
+    for(i = 0; i < RECV_BATCH; i++) {
+        iov[i].iov_base = i ? extra[i-1] : buffer;
+        iov[i].iov_len = len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if(board->hal && board->hal->read_busy_wait) {
+        n = recvmmsg(board->sockfd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+        if(n <= 0) rtapi_delay(READ_PCK_DELAY_NS);
+    } else {
+        n = -1;
+        errno = EAGAIN;
+        if(eth_socket_wait(board->sockfd, deadline))
+            n = recvmmsg(board->sockfd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+    }
+    if(n <= 0) return -1;
+
+    for(i = n-1; i > 0; i--) {
+        if((int)msgs[i].msg_len == len) break;
+    }
+    if(i > 0) memcpy(buffer, extra[i-1], len);
+    return msgs[i].msg_len;
+}
+
 static int eth_socket_recv_loop(int sockfd, void *buffer, int len, int flags, long timeout) {
     long long end = rtapi_get_clocks() + timeout;
     int result;
@@ -658,6 +711,7 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, i
 
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
+    hm2_eth_flush_write(board);
     board->read_cnt++;
 
     if(rtapi_task_self() >= 0) {
@@ -681,8 +735,9 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, i
     t1 = rtapi_get_time();
     do {
         errno = 0;
-        recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, size, 0);
-        if(recv < 0) rtapi_delay(READ_PCK_DELAY_NS);
+        recv = -1;
+        if(eth_socket_wait(board->sockfd, t1 + 200*1000*1000))
+            recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, size, MSG_DONTWAIT);
         t2 = rtapi_get_time();
         i++;
     } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
@@ -698,9 +753,26 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, i
     return 1;  // success
 }
 
+// Send a write packet which hm2_eth_send_queued_writes held back, if any.
+static int hm2_eth_flush_write(hm2_eth_t *board) {
+    int send;
+
+    if(!board->write_pending) return 1;
+    board->write_pending = false;
+
+    send = eth_socket_send(board->sockfd, (void*) &board->write_packet, board->write_packet_size, 0);
+    board->write_packet_ptr = board->write_packet;
+    board->write_packet_size = 0;
+    if(send < 0) {
+        LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
 static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
     hm2_eth_t *board = this->private;
-    int send;
+    int send, read_size;
 
     // read (low 16 bits of) last write number from space 4 address 0010
     LBP16_INIT_PACKET4(*(lbp16_cmd_addr*)(board->read_packet_ptr), CMD_READ_COMM_CTRL_ADDR16(1), 0x8);
@@ -726,11 +798,28 @@ static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
     board->queue_reads_count++;
     board->queue_buff_size += 8;
 
-    send = eth_socket_send(board->sockfd, (void*) &board->read_packet, board->read_packet_ptr - board->read_packet, 0);
+    read_size = board->read_packet_ptr - board->read_packet;
+    if(board->write_pending && board->write_packet_size + read_size <= (int)sizeof(board->read_packet)) {
+        // the board executes the commands in order, so the writes from
+        // .write and the read request can share one datagram
+        struct iovec iov[2] = {
+            { .iov_base = board->write_packet, .iov_len = board->write_packet_size },
+            { .iov_base = board->read_packet, .iov_len = read_size },
+        };
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+        board->write_pending = false;
+        board->write_packet_ptr = board->write_packet;
+        board->write_packet_size = 0;
+        send = sendmsg(board->sockfd, &msg, 0);
+    } else {
+        if(!hm2_eth_flush_write(board)) return 0;
+        send = eth_socket_send(board->sockfd, (void*) &board->read_packet, read_size, 0);
+    }
     if(send < 0) {
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
         return 0;
     }
+    board->read_sent_time = rtapi_get_time();
     return 1;
 }
 
@@ -761,6 +850,16 @@ static void decrement_soft_error(hm2_eth_t *board) {
     *board->hal->packet_error_exceeded = 0;
 }
 
+static void record_rtt(hm2_eth_t *board, long long rtt) {
+    int i;
+    if(!board->hal) return; // still early in hm2_eth_probe
+    *board->hal->packet_rtt = rtt;
+    if(rtt > *board->hal->packet_rtt_max) *board->hal->packet_rtt_max = rtt;
+    for(i = 0; i < HM2_ETH_RTT_BUCKETS - 1; i++)
+        if(rtt < (long long)HM2_ETH_RTT_BUCKET_NS << i) break;
+    (*board->hal->packet_rtt_hist[i])++;
+}
+
 static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
     hm2_eth_t *board = this->private;
     int recv, i = 0;
@@ -789,8 +888,7 @@ static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
     do {
 do_recv_packet:
         errno = 0;
-        recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, board->queue_buff_size, MSG_DONTWAIT);
-        if(recv < 0) rtapi_delay(READ_PCK_DELAY_NS);
+        recv = eth_socket_recv_latest(board, tmp_buffer, board->queue_buff_size, read_deadline);
         t2 = rtapi_get_time();
         i++;
     } while (recv != board->queue_buff_size && t2 < read_deadline);
@@ -815,6 +913,9 @@ do_recv_packet:
     board->queue_reads_count = 0;
     board->queue_buff_size = 0;
 
+    if(board->confirm_read_cnt == board->read_cnt)
+        record_rtt(board, t2 - board->read_sent_time);
+
     int result = 1;
     // (this means that one in 2^32 lost writes will not be diagnosed,
     // each time board->write_cnt overflows)
@@ -856,6 +957,7 @@ static int hm2_eth_write(hm2_lowlevel_io_t *this, rtapi_u32 addr, const void *bu
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
     hm2_eth_t *board = this->private;
+    hm2_eth_flush_write(board);
     board->write_cnt++;
 
     memcpy(packet.tmp_buffer, buffer, size);
@@ -875,6 +977,7 @@ static int hm2_eth_send_queued_writes(hm2_lowlevel_io_t *this) {
     long long t0, t1;
     hm2_eth_t *board = this->private;
 
+    if(!hm2_eth_flush_write(board)) return 0;
     board->write_cnt++;
     // XXX this is missing a check for exceeding the maximum packet size!
     lbp16_cmd_addr *packet = (lbp16_cmd_addr *) board->write_packet_ptr;
@@ -883,7 +986,14 @@ static int hm2_eth_send_queued_writes(hm2_lowlevel_io_t *this) {
     memcpy(board->write_packet_ptr, &board->write_cnt, 4);
     board->write_packet_ptr += 4;
     board->write_packet_size += (sizeof(*packet) + 4);
-    
+
+    // with read-request-early, .write ends by queueing the next read
+    // request; hold the writes back so both go out in one packet
+    if(this->read_request_early && *this->read_request_early && !*this->io_error) {
+        board->write_pending = true;
+        return 1;
+    }
+
     t0 = rtapi_get_time();
     send = eth_socket_send(board->sockfd, (void*) &board->write_packet, board->write_packet_size, 0);
     if(send < 0) {
@@ -901,6 +1011,9 @@ static int hm2_eth_enqueue_write(hm2_lowlevel_io_t *this, rtapi_u32 addr, const
     hm2_eth_t *board = this->private;
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
+    // a held-back packet whose read request was skipped (e.g. by an io
+    // error) goes out on its own before new writes are queued
+    hm2_eth_flush_write(board);
     lbp16_cmd_addr *packet = (lbp16_cmd_addr *) board->write_packet_ptr;
 
     // XXX this is missing a check for exceeding the maximum packet size!
@@ -1245,6 +1358,41 @@ static int hm2_eth_items(hm2_eth_t *board) {
         return r;
     *board->hal->packet_error_exceeded = 0;
 
+    if((r = hal_param_bit_newf(HAL_RW,
+            &board->hal->read_busy_wait,
+            board->llio.comp_id,
+            "%s.packet-read-busy-wait",
+            board->llio.name)) < 0)
+        return r;
+    board->hal->read_busy_wait = 0;
+
+    if((r = hal_pin_s32_newf(HAL_OUT,
+            &board->hal->packet_rtt,
+            board->llio.comp_id,
+            "%s.packet-rtt",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->packet_rtt = 0;
+
+    if((r = hal_pin_s32_newf(HAL_IO,
+            &board->hal->packet_rtt_max,
+            board->llio.comp_id,
+            "%s.packet-rtt-max",
+            board->llio.name)) < 0)
+        return r;
+    *board->hal->packet_rtt_max = 0;
+
+    int i;
+    for(i = 0; i < HM2_ETH_RTT_BUCKETS; i++) {
+        if((r = hal_pin_u32_newf(HAL_IO,
+                &board->hal->packet_rtt_hist[i],
+                board->llio.comp_id,
+                "%s.packet-rtt-hist.%02d",
+                board->llio.name, i)) < 0)
+            return r;
+        *board->hal->packet_rtt_hist[i] = 0;
+    }
+
     return 0;
 }
 
@@ -1287,6 +1435,15 @@ int rtapi_app_main(void) {
             goto error;
     }
 
+    {
+        hm2_lowlevel_io_t *llio[MAX_ETH_BOARDS];
+        for(i = 0; i<num_boards; i++)
+            llio[i] = &boards[i].llio;
+        ret = hm2_export_group_functs(HM2_LLIO_NAME, llio, num_boards, comp_id);
+        if (ret < 0)
+            goto error;
+    }
+
     for(i = 0; i<num_boards; i++) {
         char ifbuf[64]; // more than enough for eth0
         char *ifptr = fetch_ifname(boards[i].sockfd, ifbuf, sizeof(ifbuf));
@@ -29,6 +29,11 @@
 
 #define MAX_ETH_READS 64
 
+// round trip times are counted in buckets of <25us, <50us, ... doubling up
+// to a last bucket for everything slower
+#define HM2_ETH_RTT_BUCKETS 10
+#define HM2_ETH_RTT_BUCKET_NS 25000
+
 typedef struct {
     void *buffer;
     int size;
@@ -51,6 +56,8 @@ typedef struct {
     rtapi_u8 write_packet[1400];
     rtapi_u8 *write_packet_ptr;
     int write_packet_size;
+    // the finished write packet is held back to go out with the read request
+    bool write_pending;
     uint32_t read_cnt, write_cnt;
     // these two fields must be kept together, they're read by a single
     // read-request
@@ -58,16 +65,21 @@ typedef struct {
 
     int comm_error_counter;
     uint16_t old_rxudpcount, rxudpcount;
+    long long read_sent_time;
     struct arpreq req;
 
     struct {
         hal_s32_t read_timeout;
+        hal_bit_t read_busy_wait;
         hal_s32_t packet_error_limit;
         hal_s32_t packet_error_increment;
         hal_s32_t packet_error_decrement;
         hal_bit_t *packet_error;
         hal_s32_t *packet_error_level;
         hal_bit_t *packet_error_exceeded;
+        hal_s32_t *packet_rtt;
+        hal_s32_t *packet_rtt_max;
+        hal_u32_t *packet_rtt_hist[HM2_ETH_RTT_BUCKETS];
     } *hal;
 } hm2_eth_t;
 
@@ -129,6 +129,11 @@ struct hm2_lowlevel_io_struct {
     // TRUE if it is useful to split reads into a request and response part
     bool split_read;
 
+    // This is a HAL parameter allocated and added to HAL by hostmot2 when
+    // split_read is set.  If TRUE, .write sends the read request for the
+    // next cycle, so the reply is already waiting when .read runs.
+    hal_bit_t *read_request_early;
+
     // this gets set to TRUE when the llio driver detects an io_error, and
     // by the hm2 watchdog (if present) when it detects a watchdog bite
     // needs_soft_reset is like needs_reset except that no message is logged
@@ -171,6 +176,11 @@ struct hm2_lowlevel_io_struct {
 int hm2_register(hm2_lowlevel_io_t *llio, char *config);
 void hm2_unregister(hm2_lowlevel_io_t *llio);
 
+// export <prefix>.read-request, .read and .write functions (owned by
+// comp_id) covering all the given split_read boards, for drivers which
+// talk to several boards from one thread
+int hm2_export_group_functs(const char *prefix, hm2_lowlevel_io_t *llio[], int num_llios, int comp_id);
+
 
 #endif //  HOSTMOT2_LOWLEVEL_H
 
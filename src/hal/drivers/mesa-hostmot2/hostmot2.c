@@ -76,6 +76,9 @@ static int comp_id;
 
 static void hm2_read_request(void *void_hm2, long period) {
     hostmot2_t *hm2 = void_hm2;
+
+    // already sent by .write at the end of the last cycle
+    if (hm2->llio->read_requested) return;
     hm2->llio->period = period;
 
     // if there are comm problems, wait for the user to fix it
@@ -94,7 +97,12 @@ static void hm2_read_request(void *void_hm2, long period) {
 static void hm2_read(void *void_hm2, long period) {
     hostmot2_t *hm2 = void_hm2;
 
-    if(!hm2->llio->read_requested) hm2_read_request(void_hm2, period);
+    if(!hm2->llio->read_requested) {
+        hm2_read_request(void_hm2, period);
+    } else if(hm2->llio->read_request_early && *hm2->llio->read_request_early) {
+        // the request went out last cycle; time out relative to now
+        hm2->llio->read_time = rtapi_get_time();
+    }
     hm2->llio->read_requested = false;
 
     // if there are comm problems, wait for the user to fix it
@@ -159,6 +167,47 @@ static void hm2_write(void *void_hm2, long period) {
 
     hm2_raw_write(hm2);
     hm2_finish_write(hm2);
+
+    if(hm2->llio->read_request_early && *hm2->llio->read_request_early)
+        hm2_read_request(void_hm2, period);
+}
+
+
+// a set of boards read and written by one function, see
+// hm2_export_group_functs()
+typedef struct {
+    int num_instances;
+    hostmot2_t *instance[];
+} hm2_group_t;
+
+static void hm2_read_request_group(void *void_group, long period) {
+    hm2_group_t *group = void_group;
+    int i;
+
+    for (i = 0; i < group->num_instances; i ++) {
+        hm2_read_request(group->instance[i], period);
+    }
+}
+
+static void hm2_read_group(void *void_group, long period) {
+    hm2_group_t *group = void_group;
+    int i;
+
+    // every request is on the wire before waiting for the first reply,
+    // so the round trips overlap instead of adding up
+    hm2_read_request_group(void_group, period);
+    for (i = 0; i < group->num_instances; i ++) {
+        hm2_read(group->instance[i], period);
+    }
+}
+
+static void hm2_write_group(void *void_group, long period) {
+    hm2_group_t *group = void_group;
+    int i;
+
+    for (i = 0; i < group->num_instances; i ++) {
+        hm2_write(group->instance[i], period);
+    }
 }
 
 
@@ -1389,6 +1438,25 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
             r = -EINVAL;
             goto fail0;
         }
+
+        if (llio->split_read) {
+            llio->read_request_early = (hal_bit_t *)hal_malloc(sizeof(hal_bit_t));
+            if (llio->read_request_early == NULL) {
+                HM2_ERR("out of memory!\n");
+                r = -ENOMEM;
+                goto fail0;
+            }
+
+            (*llio->read_request_early) = 0;
+
+            rtapi_snprintf(name, sizeof(name), "%s.read-request-early", llio->name);
+            r = hal_param_bit_new(name, HAL_RW, llio->read_request_early, llio->comp_id);
+            if (r < 0) {
+                HM2_ERR("error adding param '%s', aborting\n", name);
+                r = -EINVAL;
+                goto fail0;
+            }
+        }
     }
 
     HM2_PRINT("Low Level init %s\n", HM2_VERSION);
@@ -1694,6 +1762,68 @@ fail0:
 
 
 
+EXPORT_SYMBOL_GPL(hm2_export_group_functs);
+int hm2_export_group_functs(const char *prefix, hm2_lowlevel_io_t *llio[], int num_llios, int comp_id) {
+    char name[HAL_NAME_LEN + 1];
+    hm2_group_t *group;
+    int i, r;
+
+    if (num_llios < 1) return 0;
+
+    group = hal_malloc(sizeof(hm2_group_t) + num_llios * sizeof(hostmot2_t *));
+    if (group == NULL) {
+        HM2_ERR_NO_LL("%s: out of memory!\n", prefix);
+        return -ENOMEM;
+    }
+    group->num_instances = 0;
+
+    for (i = 0; i < num_llios; i ++) {
+        struct rtapi_list_head *ptr;
+
+        if (!llio[i]->split_read) {
+            HM2_ERR_NO_LL("%s: %s can't be read as part of a group\n", prefix, llio[i]->name);
+            return -EINVAL;
+        }
+        rtapi_list_for_each(ptr, &hm2_list) {
+            hostmot2_t *hm2 = rtapi_list_entry(ptr, hostmot2_t, list);
+            if (hm2->llio == llio[i]) {
+                group->instance[group->num_instances++] = hm2;
+                break;
+            }
+        }
+    }
+    if (group->num_instances != num_llios) {
+        HM2_ERR_NO_LL("%s: board not registered\n", prefix);
+        return -ENODEV;
+    }
+
+    rtapi_snprintf(name, sizeof(name), "%s.read-request", prefix);
+    r = hal_export_funct(name, hm2_read_request_group, group, 1, 0, comp_id);
+    if (r != 0) {
+        HM2_ERR_NO_LL("error %d exporting read function %s\n", r, name);
+        return -EINVAL;
+    }
+
+    rtapi_snprintf(name, sizeof(name), "%s.read", prefix);
+    r = hal_export_funct(name, hm2_read_group, group, 1, 0, comp_id);
+    if (r != 0) {
+        HM2_ERR_NO_LL("error %d exporting read function %s\n", r, name);
+        return -EINVAL;
+    }
+
+    rtapi_snprintf(name, sizeof(name), "%s.write", prefix);
+    r = hal_export_funct(name, hm2_write_group, group, 1, 0, comp_id);
+    if (r != 0) {
+        HM2_ERR_NO_LL("error %d exporting write function %s\n", r, name);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+
+
+
 EXPORT_SYMBOL_GPL(hm2_unregister);
 void hm2_unregister(hm2_lowlevel_io_t *llio) {
     struct rtapi_list_head *ptr;
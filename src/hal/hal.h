@@ -697,6 +697,19 @@ extern int hal_thread_delete(const char *name);
 extern int hal_add_funct_to_thread(const char *funct_name, const char *thread_name,
     int position);
 
+/** hal_add_funct_to_thread_group() is like hal_add_funct_to_thread(),
+    but also puts the function in parallel group 'group'.  When the
+    thread runs, consecutive functions with the same non-zero group
+    number may be executed at the same time on different CPUs (if the
+    RTAPI implementation supports it, see rtapi_task_parallel()), and
+    the thread waits for all of them to finish before it calls the
+    next function.  Functions in one group must not depend on each
+    other's outputs.  A 'group' of 0 is the same as calling
+    hal_add_funct_to_thread().
+*/
+extern int hal_add_funct_to_thread_group(const char *funct_name,
+    const char *thread_name, int position, int group);
+
 /** hal_del_funct_from_thread() removes a function from a thread.
     'funct_name' is the name of the function, as specified in
     a call to hal_export_funct().
@@ -66,6 +66,9 @@
 MODULE_AUTHOR("John Kasunich");
 MODULE_DESCRIPTION("Hardware Abstraction Layer for EMC");
 MODULE_LICENSE("GPL");
+
+static int hal_size = HAL_SIZE;	/* requested size of HAL shmem block */
+RTAPI_MP_INT(hal_size, "size of HAL shared memory in bytes");
 #endif /* RTAPI */
 
 #if defined(ULAPI)
@@ -74,6 +77,15 @@ MODULE_LICENSE("GPL");
 #include <time.h>
 #endif
 
+#if !defined(__KERNEL__) && defined(__linux__)
+#include <limits.h>		/* INT_MAX */
+#include <unistd.h>		/* syscall() */
+#include <sys/syscall.h>	/* SYS_futex */
+#include <linux/futex.h>	/* FUTEX_WAIT, FUTEX_WAKE */
+#include <time.h>		/* struct timespec */
+#define HAL_USE_FUTEX
+#endif
+
 char *hal_shmem_base = 0;
 hal_data_t *hal_data = 0;
 static int lib_module_id = -1;	/* RTAPI module ID for library module */
@@ -90,7 +102,7 @@ static int lib_mem_id = 0;	/* RTAPI shmem ID for library module */
     if the structure has not already been initialized.  (The init
     is done by the first HAL component to be loaded.
 */
-static int init_hal_data(void);
+static int init_hal_data(long size);
 
 /** The 'shmalloc_xx()' functions allocate blocks of shared memory.
     Each function allocates a block that is 'size' bytes long.
@@ -115,6 +127,18 @@ static int init_hal_data(void);
 static void *shmalloc_up(long int size);
 static void *shmalloc_dn(long int size);
 
+/** 'alloc_sig_data()' allocates the data block for a new signal,
+    re-using a block put back by 'free_sig_data()' when possible.
+    'free_port()' likewise puts back a port buffer when its signal is
+    deleted, and 'hal_port_alloc()' re-uses one of exactly the same
+    size before allocating a new one.  Without this, every delsig or
+    unload/reload cycle would permanently consume shmalloc_up() space.
+    The free blocks are chained through their first word.
+*/
+static hal_data_u *alloc_sig_data(void);
+static void free_sig_data(hal_data_u * data);
+static void free_port(hal_port_t port);
+
 /** The alloc_xxx_struct() functions allocate a structure of the
     appropriate type and return a pointer to it, or 0 if they fail.
     They attempt to re-use freed structs first, if none are
@@ -151,7 +175,31 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry);
 static void free_thread_struct(hal_thread_t * thread);
 #endif /* RTAPI */
 
+/** The index_xxx() functions maintain the name index (see hal_index_t).
+    'index_reserve()' makes sure that 'n' index structs can be allocated
+    later without failing, so callers can check for memory before they
+    start changing the lists.  'index_add()' adds an entry for 'object'
+    under 'name', which must be the object's name or old name string in
+    shared memory, and 'index_remove()' removes that entry again.
+    'index_find()' returns the object of type 'type' called 'name', or
+    NULL.  Like the functions above, these assume the caller has
+    already grabbed the hal_data mutex.
+*/
+static int index_reserve(int n);
+static void index_add(int type, void *object, char *name);
+static void index_remove(int type, void *object, char *name);
+static void *index_find(int type, const char *name);
+
 #ifdef RTAPI
+/** 'init_timing()' clears a histogram, 'export_timing()' creates its
+    pin and params with names starting with 'prefix', and
+    'update_timing()' adds one run of 'runtime' CPU cycles to it.
+*/
+static void init_timing(hal_timing_t * timing);
+static int export_timing(hal_timing_t * timing, const char *prefix,
+    int comp_id);
+static inline void update_timing(hal_timing_t * timing, hal_s32_t runtime);
+
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
@@ -217,13 +265,32 @@ int hal_init(const char *name)
         hal_shmem_base = (char *) mem;
         hal_data = (hal_data_t *) mem;
 	/* perform a global init if needed */
-	retval = init_hal_data();
+	retval = init_hal_data(HAL_SIZE);
 	if ( retval ) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: could not init shared memory\n");
 	    rtapi_exit(lib_module_id);
 	    return -EINVAL;
 	}
+	/* hal_lib may have created a larger block, if so map all of it */
+	if (hal_data->shmem_size > HAL_SIZE) {
+	    long size = hal_data->shmem_size;
+	    rtapi_shmem_delete(lib_mem_id, lib_module_id);
+	    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, size);
+	    if (lib_mem_id < 0
+		    || rtapi_shmem_getptr(lib_mem_id, &mem) < 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+		    "HAL: ERROR: could not map %ld bytes of shared memory\n",
+		    size);
+		hal_shmem_base = 0;
+		hal_data = 0;
+		lib_mem_id = 0;
+		rtapi_exit(lib_module_id);
+		return -EINVAL;
+	    }
+	    hal_shmem_base = (char *) mem;
+	    hal_data = (hal_data_t *) mem;
+	}
     }
 #endif
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: initializing component '%s'\n",
@@ -693,8 +760,8 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    "HAL: ERROR: pin_new called after hal_ready\n");
 	return -EINVAL;
     }
-    /* allocate a new variable structure */
-    new = alloc_pin_struct();
+    /* allocate a new variable structure (and room to index it) */
+    new = index_reserve(1) == 0 ? alloc_pin_struct() : 0;
     if (new == 0) {
 	/* alloc failed */
 	rtapi_mutex_give(&(hal_data->mutex));
@@ -712,14 +779,24 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* make 'data_ptr' point to dummy signal */
     *data_ptr_addr = comp->shmem_base + SHMOFF(&(new->dummysig));
-    /* search list for 'name' and insert new structure */
+    /* search list for 'name' and insert new structure.  Pins tend to be
+       created in name order, so start after the last pin inserted if
+       that one sorts before 'name'. */
     prev = &(hal_data->pin_list_ptr);
+    if (hal_data->pin_hint_ptr != 0) {
+	ptr = SHMPTR(hal_data->pin_hint_ptr);
+	if (strcmp(ptr->name, new->name) < 0) {
+	    prev = &(ptr->next_ptr);
+	}
+    }
     next = *prev;
     while (1) {
 	if (next == 0) {
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->pin_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_PIN, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -729,6 +806,8 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->pin_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_PIN, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -788,7 +867,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
        if we actually need the struct later, the next alloc is guaranteed
        to succeed since at least one struct is on the free list. */
     oldname = halpr_alloc_oldname_struct();
-    if ( oldname == NULL ) {
+    if ( oldname == NULL || index_reserve(1) != 0 ) {
 	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for pin_alias\n");
@@ -824,6 +903,12 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	prev = &(pin->next_ptr);
 	next = *prev;
     }
+    /* the names are about to change, drop them from the index */
+    index_remove(HAL_INDEX_PIN, pin, pin->name);
+    if ( pin->oldname != 0 ) {
+	oldname = SHMPTR(pin->oldname);
+	index_remove(HAL_INDEX_PIN, pin, oldname->name);
+    }
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( pin->oldname == 0 ) {
@@ -844,6 +929,12 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    /* and index it under its new name(s) */
+    index_add(HAL_INDEX_PIN, pin, pin->name);
+    if ( pin->oldname != 0 ) {
+	oldname = SHMPTR(pin->oldname);
+	index_add(HAL_INDEX_PIN, pin, oldname->name);
+    }
     /* insert pin back into list in proper place */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -926,7 +1017,7 @@ with the C standard.
     case HAL_U32:
     case HAL_FLOAT:
     case HAL_PORT:
-        data_addr = shmalloc_up(sizeof(hal_data_u));
+        data_addr = alloc_sig_data();
     break;
     default:
 	rtapi_mutex_give(&(hal_data->mutex));
@@ -935,10 +1026,17 @@ with the C standard.
 	return -EINVAL;
 	break;
     }
-    /* allocate a new signal structure */
-    new = alloc_sig_struct();
+    /* allocate a new signal structure (and room to index it) */
+    new = index_reserve(1) == 0 ? alloc_sig_struct() : 0;
     if ((new == 0) || (data_addr == 0)) {
-	/* alloc failed */
+	/* alloc failed, put back whatever we did get */
+	if (new != 0) {
+	    new->next_ptr = hal_data->sig_free_ptr;
+	    hal_data->sig_free_ptr = SHMOFF(new);
+	}
+	if (data_addr != 0) {
+	    free_sig_data(data_addr);
+	}
 	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
@@ -971,14 +1069,23 @@ with the C standard.
     new->writers = 0;
     new->bidirs = 0;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
-    /* search list for 'name' and insert new structure */
+    /* search list for 'name' and insert new structure, starting after
+       the last signal inserted if that one sorts before 'name' */
     prev = &(hal_data->sig_list_ptr);
+    if (hal_data->sig_hint_ptr != 0) {
+	ptr = SHMPTR(hal_data->sig_hint_ptr);
+	if (strcmp(ptr->name, new->name) < 0) {
+	    prev = &(ptr->next_ptr);
+	}
+    }
     next = *prev;
     while (1) {
 	if (next == 0) {
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->sig_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_SIG, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -988,6 +1095,8 @@ with the C standard.
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->sig_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_SIG, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1401,8 +1510,8 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    "HAL: ERROR: param_new called after hal_ready\n");
 	return -EINVAL;
     }
-    /* allocate a new parameter structure */
-    new = alloc_param_struct();
+    /* allocate a new parameter structure (and room to index it) */
+    new = index_reserve(1) == 0 ? alloc_param_struct() : 0;
     if (new == 0) {
 	/* alloc failed */
 	rtapi_mutex_give(&(hal_data->mutex));
@@ -1416,14 +1525,23 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
     new->type = type;
     new->dir = dir;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
-    /* search list for 'name' and insert new structure */
+    /* search list for 'name' and insert new structure, starting after
+       the last parameter inserted if that one sorts before 'name' */
     prev = &(hal_data->param_list_ptr);
+    if (hal_data->param_hint_ptr != 0) {
+	ptr = SHMPTR(hal_data->param_hint_ptr);
+	if (strcmp(ptr->name, new->name) < 0) {
+	    prev = &(ptr->next_ptr);
+	}
+    }
     next = *prev;
     while (1) {
 	if (next == 0) {
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->param_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_PARAM, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1433,6 +1551,8 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    hal_data->param_hint_ptr = SHMOFF(new);
+	    index_add(HAL_INDEX_PARAM, new, new->name);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1590,7 +1710,7 @@ int hal_param_alias(const char *param_name, const char *alias)
        if we actually need the struct later, the next alloc is guaranteed
        to succeed since at least one struct is on the free list. */
     oldname = halpr_alloc_oldname_struct();
-    if ( oldname == NULL ) {
+    if ( oldname == NULL || index_reserve(1) != 0 ) {
 	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for param_alias\n");
@@ -1626,6 +1746,12 @@ int hal_param_alias(const char *param_name, const char *alias)
 	prev = &(param->next_ptr);
 	next = *prev;
     }
+    /* the names are about to change, drop them from the index */
+    index_remove(HAL_INDEX_PARAM, param, param->name);
+    if ( param->oldname != 0 ) {
+	oldname = SHMPTR(param->oldname);
+	index_remove(HAL_INDEX_PARAM, param, oldname->name);
+    }
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( param->oldname == 0 ) {
@@ -1646,6 +1772,12 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    /* and index it under its new name(s) */
+    index_add(HAL_INDEX_PARAM, param, param->name);
+    if ( param->oldname != 0 ) {
+	oldname = SHMPTR(param->oldname);
+	index_add(HAL_INDEX_PARAM, param, oldname->name);
+    }
     /* insert param back into list in proper place */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1745,6 +1877,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     new->users = 0;
     new->arg = arg;
     new->funct = funct;
+    init_timing(&(new->timing));
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* search list for 'name' and insert new structure */
     prev = &(hal_data->funct_list_ptr);
@@ -1802,6 +1935,9 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     new->maxtime_increased = 0;
     hal_param_bit_new(buf, HAL_RO, &(new->maxtime_increased), comp_id);
 
+    /* create the pin and params for the function's run time histogram */
+    export_timing(&(new->timing), name, comp_id);
+
     return 0;
 }
 
@@ -1865,6 +2001,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     }
     /* initialize the structure */
     new->uses_fp = uses_fp;
+    init_timing(&(new->timing));
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* have to create and start a task to run the thread */
     if (hal_data->thread_list_ptr == 0) {
@@ -1970,6 +2107,13 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
         return -EINVAL;
     }
     *(new->runtime) = 0;
+
+    if (export_timing(&(new->timing), new->name, new->comp_id)) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+           "HAL: ERROR: fail to create timing pins for thread '%s'\n",
+           new->name);
+        return -EINVAL;
+    }
     hal_ready(new->comp_id);
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: thread created\n");
@@ -2028,6 +2172,12 @@ extern int hal_thread_delete(const char *name)
 #endif /* RTAPI */
 
 int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int position)
+{
+    return hal_add_funct_to_thread_group(funct_name, thread_name, position, 0);
+}
+
+int hal_add_funct_to_thread_group(const char *funct_name,
+    const char *thread_name, int position, int group)
 {
     hal_thread_t *thread;
     hal_funct_t *funct;
@@ -2059,6 +2209,11 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
 	return -EINVAL;
     }
+    if (group < 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad group: %d\n", group);
+	return -EINVAL;
+    }
     /* make sure we were given a function name */
     if (funct_name == 0) {
 	/* no name supplied */
@@ -2151,6 +2306,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry->funct_ptr = SHMOFF(funct);
     funct_entry->arg = funct->arg;
     funct_entry->funct = funct->funct;
+    funct_entry->group = group;
     /* add the entry to the list */
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
@@ -2388,78 +2544,19 @@ hal_comp_t *halpr_find_comp_by_name(const char *name)
 
 hal_pin_t *halpr_find_pin_by_name(const char *name)
 {
-    int next;
-    hal_pin_t *pin;
-    hal_oldname_t *oldname;
-
-    /* search pin list for 'name' */
-    next = hal_data->pin_list_ptr;
-    while (next != 0) {
-	pin = SHMPTR(next);
-	if (strcmp(pin->name, name) == 0) {
-	    /* found a match */
-	    return pin;
-	}
-	if (pin->oldname != 0 ) {
-	    oldname = SHMPTR(pin->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return pin;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	next = pin->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* matches either the pin's name or, if aliased, its old name */
+    return index_find(HAL_INDEX_PIN, name);
 }
 
 hal_sig_t *halpr_find_sig_by_name(const char *name)
 {
-    int next;
-    hal_sig_t *sig;
-
-    /* search signal list for 'name' */
-    next = hal_data->sig_list_ptr;
-    while (next != 0) {
-	sig = SHMPTR(next);
-	if (strcmp(sig->name, name) == 0) {
-	    /* found a match */
-	    return sig;
-	}
-	/* didn't find it yet, look at next one */
-	next = sig->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    return index_find(HAL_INDEX_SIG, name);
 }
 
 hal_param_t *halpr_find_param_by_name(const char *name)
 {
-    int next;
-    hal_param_t *param;
-    hal_oldname_t *oldname;
-
-    /* search parameter list for 'name' */
-    next = hal_data->param_list_ptr;
-    while (next != 0) {
-	param = SHMPTR(next);
-	if (strcmp(param->name, name) == 0) {
-	    /* found a match */
-	    return param;
-	}
-	if (param->oldname != 0 ) {
-	    oldname = SHMPTR(param->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return param;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	next = param->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* matches either the param's name or, if aliased, its old name */
+    return index_find(HAL_INDEX_PARAM, name);
 }
 
 hal_thread_t *halpr_find_thread_by_name(const char *name)
@@ -2701,8 +2798,20 @@ int rtapi_app_main(void)
 	rtapi_print_msg(RTAPI_MSG_ERR, "HAL_LIB: ERROR: rtapi init failed\n");
 	return -EINVAL;
     }
+    /* round the requested size up to whole pages, never below default */
+    if (hal_size < HAL_SIZE) {
+	hal_size = HAL_SIZE;
+    }
+    if (hal_size > HAL_SIZE_MAX) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL_LIB: ERROR: hal_size %d is larger than %d\n",
+	    hal_size, HAL_SIZE_MAX);
+	rtapi_exit(lib_module_id);
+	return -EINVAL;
+    }
+    hal_size = (hal_size + 4095) & ~4095;
     /* get HAL shared memory block from RTAPI */
-    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, HAL_SIZE);
+    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, hal_size);
     if (lib_mem_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not open shared memory\n");
@@ -2721,7 +2830,7 @@ int rtapi_app_main(void)
     hal_shmem_base = (char *) mem;
     hal_data = (hal_data_t *) mem;
     /* perform a global init if needed */
-    retval = init_hal_data();
+    retval = init_hal_data(hal_size);
     if ( retval ) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not init shared memory\n");
@@ -2770,13 +2879,128 @@ void rtapi_app_exit(void)
 
 /* this is the task function that implements threads in realtime */
 
+static void init_timing(hal_timing_t * timing)
+{
+    int n;
+
+    timing->bin_width = 0;
+    timing->limit = 0;
+    timing->reset = 0;
+    timing->period = 0;
+    timing->overrun_pin = &(timing->overruns);
+    timing->overruns = 0;
+    timing->samples = 0;
+    for (n = 0; n < HAL_TIMING_BINS; n++) {
+	timing->bins[n] = 0;
+    }
+}
+
+static int export_timing(hal_timing_t * timing, const char *prefix,
+    int comp_id)
+{
+    int retval;
+
+    retval = hal_pin_u32_newf(HAL_OUT, &(timing->overrun_pin), comp_id,
+	"%s.overruns", prefix);
+    if (retval != 0) {
+	return retval;
+    }
+    *(timing->overrun_pin) = 0;
+    retval = hal_param_s32_newf(HAL_RW, &(timing->bin_width), comp_id,
+	"%s.hist-bin-width", prefix);
+    if (retval != 0) {
+	return retval;
+    }
+    retval = hal_param_s32_newf(HAL_RW, &(timing->limit), comp_id,
+	"%s.overrun-limit", prefix);
+    if (retval != 0) {
+	return retval;
+    }
+    return hal_param_bit_newf(HAL_RW, &(timing->reset), comp_id,
+	"%s.hist-reset", prefix);
+}
+
+static inline void update_timing(hal_timing_t * timing, hal_s32_t runtime)
+{
+    hal_s32_t limit;
+    int n;
+
+    if (timing->reset) {
+	for (n = 0; n < HAL_TIMING_BINS; n++) {
+	    timing->bins[n] = 0;
+	}
+	timing->samples = 0;
+	timing->overruns = 0;
+	*(timing->overrun_pin) = 0;
+	timing->reset = 0;
+    }
+    if (runtime <= 0) {
+	n = 0;
+    } else if (timing->bin_width > 0) {
+	n = runtime / timing->bin_width;
+	if (n >= HAL_TIMING_BINS) {
+	    n = HAL_TIMING_BINS - 1;
+	}
+    } else {
+	/* index of the highest set bit, always < 31 */
+	n = 31 - __builtin_clz((unsigned int) runtime);
+    }
+    timing->bins[n]++;
+    timing->samples++;
+    limit = (timing->limit > 0) ? timing->limit : timing->period;
+    if ((limit > 0) && (runtime > limit)) {
+	*(timing->overrun_pin) = ++timing->overruns;
+    }
+}
+
+/* calls one function of a thread and updates its execution time data,
+   'start_time' is when the call started, returns when it ended */
+static long long int call_funct(hal_funct_entry_t * funct_entry, long period,
+    long long int start_time)
+{
+    hal_funct_t *funct;
+    long long int end_time;
+
+    /* call the function */
+    funct_entry->funct(funct_entry->arg, period);
+    /* capture execution time */
+    end_time = rtapi_get_clocks();
+    /* point to function structure */
+    funct = SHMPTR(funct_entry->funct_ptr);
+    /* update execution time data */
+    *(funct->runtime) = (hal_s32_t)(end_time - start_time);
+    if ( *(funct->runtime) > funct->maxtime) {
+	funct->maxtime = *(funct->runtime);
+	funct->maxtime_increased = 1;
+    } else {
+	funct->maxtime_increased = 0;
+    }
+    update_timing(&(funct->timing), *(funct->runtime));
+    return end_time;
+}
+
+/* one parallel group of functions, see hal_add_funct_to_thread_group() */
+typedef struct {
+    hal_funct_entry_t *entry[HAL_PARALLEL_MAX];
+    long period;
+} parallel_group_t;
+
+static void call_parallel_funct(void *arg, int n)
+{
+    parallel_group_t *group = arg;
+
+    call_funct(group->entry[n], group->period, rtapi_get_clocks());
+}
+
 static void thread_task(void *arg)
 {
     hal_thread_t *thread;
-    hal_funct_t *funct;
     hal_funct_entry_t *funct_root, *funct_entry;
     long long int start_time, end_time;
     long long int thread_start_time;
+    long long int prev_start_time = 0;
+    parallel_group_t group;
+    int count;
 
     thread = arg;
     while (1) {
@@ -2788,24 +3012,39 @@ static void thread_task(void *arg)
 	    start_time = rtapi_get_clocks();
 	    end_time = start_time;
 	    thread_start_time = start_time;
+	    /* measure one period between the starts of two consecutive
+	       runs, used as the overrun limit when none is set */
+	    if ((thread->timing.period == 0) && (prev_start_time != 0)) {
+		thread->timing.period =
+		    (hal_s32_t)(thread_start_time - prev_start_time);
+	    }
+	    prev_start_time = thread_start_time;
 	    /* run thru function list */
 	    while (funct_entry != funct_root) {
-		/* call the function */
-		funct_entry->funct(funct_entry->arg, thread->period);
-		/* capture execution time */
-		end_time = rtapi_get_clocks();
-		/* point to function structure */
-		funct = SHMPTR(funct_entry->funct_ptr);
-		/* update execution time data */
-		*(funct->runtime) = (hal_s32_t)(end_time - start_time);
-		if ( *(funct->runtime) > funct->maxtime) {
-		    funct->maxtime = *(funct->runtime);
-		    funct->maxtime_increased = 1;
+		if (funct_entry->group == 0) {
+		    /* call the function */
+		    end_time = call_funct(funct_entry, thread->period,
+			start_time);
+		    /* point to next next entry in list */
+		    funct_entry = SHMPTR(funct_entry->links.next);
 		} else {
-		    funct->maxtime_increased = 0;
+		    /* gather the rest of the group and run it in parallel */
+		    group.period = thread->period;
+		    count = 0;
+		    do {
+			group.entry[count++] = funct_entry;
+			funct_entry = SHMPTR(funct_entry->links.next);
+		    } while ((funct_entry != funct_root)
+			&& (funct_entry->group == group.entry[0]->group)
+			&& (count < HAL_PARALLEL_MAX));
+		    if (count == 1) {
+			end_time = call_funct(group.entry[0], thread->period,
+			    start_time);
+		    } else {
+			rtapi_task_parallel(call_parallel_funct, &group, count);
+			end_time = rtapi_get_clocks();
+		    }
 		}
-		/* point to next next entry in list */
-		funct_entry = SHMPTR(funct_entry->links.next);
 		/* prepare to measure time for next funct */
 		start_time = end_time;
 	    }
@@ -2814,6 +3053,9 @@ static void thread_task(void *arg)
 	    if ( *(thread->runtime) > thread->maxtime) {
 	        thread->maxtime = *(thread->runtime);
 	    }
+	    update_timing(&(thread->timing), *(thread->runtime));
+	} else {
+	    prev_start_time = 0;
 	}
 	/* wait until next period */
 	rtapi_wait();
@@ -2825,8 +3067,10 @@ static void thread_task(void *arg)
    a description of what they do.
 */
 
-static int init_hal_data(void)
+static int init_hal_data(long size)
 {
+    int n;
+
     /* has the block already been initialized? */
     if (hal_data->version != 0) {
 	/* yes, verify version code */
@@ -2862,9 +3106,19 @@ static int init_hal_data(void)
     list_init_entry(&(hal_data->funct_entry_free));
     hal_data->thread_free_ptr = 0;
     hal_data->exact_base_period = 0;
+    hal_data->index_free_ptr = 0;
+    hal_data->pin_hint_ptr = 0;
+    hal_data->sig_hint_ptr = 0;
+    hal_data->param_hint_ptr = 0;
+    for (n = 0; n < HAL_NAME_INDEX_SIZE; n++) {
+	hal_data->name_index[n] = 0;
+    }
+    hal_data->sig_data_free_ptr = 0;
+    hal_data->port_free_ptr = 0;
     /* set up for shmalloc_xx() */
+    hal_data->shmem_size = size;
     hal_data->shmem_bot = sizeof(hal_data_t);
-    hal_data->shmem_top = HAL_SIZE;
+    hal_data->shmem_top = size;
     hal_data->lock = HAL_LOCK_NONE;
     /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
@@ -2930,6 +3184,44 @@ static void *shmalloc_dn(long int size)
     return retval;
 }
 
+static hal_data_u *alloc_sig_data(void)
+{
+    hal_data_u *p;
+
+    /* check the free list */
+    if (hal_data->sig_data_free_ptr != 0) {
+	/* found a free block, point to it */
+	p = SHMPTR(hal_data->sig_data_free_ptr);
+	/* unlink it from the free list */
+	hal_data->sig_data_free_ptr = *((rtapi_intptr_t *) p);
+    } else {
+	/* nothing on free list, allocate a brand new one */
+	p = shmalloc_up(sizeof(hal_data_u));
+    }
+    return p;
+}
+
+static void free_sig_data(hal_data_u * data)
+{
+    /* add it to free list */
+    *((rtapi_intptr_t *) data) = hal_data->sig_data_free_ptr;
+    hal_data->sig_data_free_ptr = SHMOFF(data);
+}
+
+static void free_port(hal_port_t port)
+{
+    hal_port_shm_t *port_shm;
+
+    if (port == 0) {
+	return;
+    }
+    port_shm = SHMPTR(port);
+    /* add it to free list */
+    port_shm->read = hal_data->port_free_ptr;
+    port_shm->write = 0;
+    hal_data->port_free_ptr = port;
+}
+
 hal_comp_t *halpr_alloc_comp_struct(void)
 {
     hal_comp_t *p;
@@ -3116,6 +3408,7 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 	/* make sure it's empty */
 	p->funct_ptr = 0;
 	p->arg = 0;
+	p->group = 0;
 	p->funct = 0;
     }
     return p;
@@ -3285,10 +3578,18 @@ static void unlink_pin(hal_pin_t * pin)
 
 static void free_pin_struct(hal_pin_t * pin)
 {
+    hal_oldname_t *oldname;
 
     unlink_pin(pin);
+    /* take it out of the name index */
+    index_remove(HAL_INDEX_PIN, pin, pin->name);
+    if ( hal_data->pin_hint_ptr == SHMOFF(pin) ) hal_data->pin_hint_ptr = 0;
     /* clear contents of struct */
-    if ( pin->oldname != 0 ) free_oldname_struct(SHMPTR(pin->oldname));
+    if ( pin->oldname != 0 ) {
+	oldname = SHMPTR(pin->oldname);
+	index_remove(HAL_INDEX_PIN, pin, oldname->name);
+	free_oldname_struct(oldname);
+    }
     pin->data_ptr_addr = 0;
     pin->owner_ptr = 0;
     pin->type = 0;
@@ -3313,6 +3614,17 @@ static void free_sig_struct(hal_sig_t * sig)
 	/* check for another pin linked to the signal */
 	pin = halpr_find_pin_by_sig(sig, pin);
     }
+    /* take it out of the name index */
+    index_remove(HAL_INDEX_SIG, sig, sig->name);
+    if ( hal_data->sig_hint_ptr == SHMOFF(sig) ) hal_data->sig_hint_ptr = 0;
+    /* recycle the signal's data, and its port buffer if it has one */
+    if (sig->data_ptr != 0) {
+	hal_data_u *data = SHMPTR(sig->data_ptr);
+	if (sig->type == HAL_PORT) {
+	    free_port(data->p);
+	}
+	free_sig_data(data);
+    }
     /* clear contents of struct */
     sig->data_ptr = 0;
     sig->type = 0;
@@ -3327,8 +3639,17 @@ static void free_sig_struct(hal_sig_t * sig)
 
 static void free_param_struct(hal_param_t * p)
 {
+    hal_oldname_t *oldname;
+
+    /* take it out of the name index */
+    index_remove(HAL_INDEX_PARAM, p, p->name);
+    if ( hal_data->param_hint_ptr == SHMOFF(p) ) hal_data->param_hint_ptr = 0;
     /* clear contents of struct */
-    if ( p->oldname != 0 ) free_oldname_struct(SHMPTR(p->oldname));
+    if ( p->oldname != 0 ) {
+	oldname = SHMPTR(p->oldname);
+	index_remove(HAL_INDEX_PARAM, p, oldname->name);
+	free_oldname_struct(oldname);
+    }
     p->data_ptr = 0;
     p->owner_ptr = 0;
     p->type = 0;
@@ -3347,6 +3668,106 @@ static void free_oldname_struct(hal_oldname_t * oldname)
     hal_data->oldname_free_ptr = SHMOFF(oldname);
 }
 
+/* FNV-1a, cheap and spreads the long common prefixes of HAL names well */
+static unsigned int index_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name != '\0') {
+	hash ^= (unsigned char) *name++;
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int index_reserve(int n)
+{
+    rtapi_intptr_t next;
+    hal_index_t *p;
+
+    /* count what's already on the free list */
+    next = hal_data->index_free_ptr;
+    while (next != 0 && n > 0) {
+	p = SHMPTR(next);
+	next = p->next_ptr;
+	n--;
+    }
+    /* and allocate the rest */
+    while (n > 0) {
+	p = shmalloc_dn(sizeof(hal_index_t));
+	if (p == 0) {
+	    return -ENOMEM;
+	}
+	p->next_ptr = hal_data->index_free_ptr;
+	hal_data->index_free_ptr = SHMOFF(p);
+	n--;
+    }
+    return 0;
+}
+
+static void index_add(int type, void *object, char *name)
+{
+    hal_index_t *p;
+    rtapi_intptr_t *bucket;
+
+    /* the caller has reserved this with index_reserve() */
+    if (hal_data->index_free_ptr == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: BUG: no name index struct reserved for '%s'\n", name);
+	return;
+    }
+    p = SHMPTR(hal_data->index_free_ptr);
+    hal_data->index_free_ptr = p->next_ptr;
+    p->object_ptr = SHMOFF(object);
+    p->name_ptr = SHMOFF(name);
+    p->hash = index_hash(name);
+    p->type = type;
+    bucket = &(hal_data->name_index[p->hash & (HAL_NAME_INDEX_SIZE - 1)]);
+    p->next_ptr = *bucket;
+    *bucket = SHMOFF(p);
+}
+
+static void index_remove(int type, void *object, char *name)
+{
+    hal_index_t *p;
+    rtapi_intptr_t *prev, next;
+
+    prev = &(hal_data->name_index[index_hash(name) & (HAL_NAME_INDEX_SIZE - 1)]);
+    next = *prev;
+    while (next != 0) {
+	p = SHMPTR(next);
+	if (p->type == type && p->object_ptr == SHMOFF(object)
+	    && p->name_ptr == SHMOFF(name)) {
+	    /* unlink it and put it on the free list */
+	    *prev = p->next_ptr;
+	    p->next_ptr = hal_data->index_free_ptr;
+	    hal_data->index_free_ptr = SHMOFF(p);
+	    return;
+	}
+	prev = &(p->next_ptr);
+	next = *prev;
+    }
+}
+
+static void *index_find(int type, const char *name)
+{
+    hal_index_t *p;
+    rtapi_intptr_t next;
+    unsigned int hash;
+
+    hash = index_hash(name);
+    next = hal_data->name_index[hash & (HAL_NAME_INDEX_SIZE - 1)];
+    while (next != 0) {
+	p = SHMPTR(next);
+	if (p->hash == hash && p->type == type
+	    && strcmp(SHMPTR(p->name_ptr), name) == 0) {
+	    return SHMPTR(p->object_ptr);
+	}
+	next = p->next_ptr;
+    }
+    return 0;
+}
+
 #ifdef RTAPI
 static void free_funct_struct(hal_funct_t * funct)
 {
@@ -3528,6 +3949,43 @@ static void hal_port_atomic_store_write(hal_port_shm_t* port_shm, unsigned write
 }
 
 
+/* Non-realtime users of ports and streams that have to wait for the
+   other side sleep on the shared memory word the other side changes
+   next (the write offset when waiting for data, the read offset when
+   waiting for room).  After changing such a word, hal_wake() makes a
+   non-blocking FUTEX_WAKE call, but only if somebody is waiting.  The
+   sleep times out after 10ms, so waiters still make progress when the
+   other side can't make system calls (e.g. kernel realtime). */
+static void hal_wake(volatile unsigned int *word, volatile unsigned int *waiters)
+{
+#ifdef HAL_USE_FUTEX
+    /* order the caller's store before the load of 'waiters', pairs
+       with the increment in hal_wait() */
+    __sync_synchronize();
+    if (*waiters) {
+        syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+#endif
+}
+
+#ifdef ULAPI
+static void hal_wait(volatile unsigned int *word, unsigned int value,
+    volatile unsigned int *waiters)
+{
+#ifdef HAL_USE_FUTEX
+    struct timespec timeout = { 0, 10000000 };
+
+    __sync_fetch_and_add(waiters, 1);
+    /* FUTEX_WAIT returns at once if 'word' no longer holds 'value' */
+    syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);
+    __sync_fetch_and_sub(waiters, 1);
+#else
+    rtapi_delay(10000000);
+#endif
+}
+#endif
+
+
 static unsigned hal_port_bytes_readable(unsigned read, unsigned write, unsigned size) {
     if(size == 0) {
         return 0;
@@ -3592,7 +4050,31 @@ static bool hal_port_compute_copy(unsigned read,
 
 
 hal_port_t hal_port_alloc(unsigned size) {
-    hal_port_shm_t* new_port = shmalloc_up(sizeof(hal_port_shm_t) + size);
+    hal_port_shm_t *new_port = 0, *port, *prev = 0;
+    rtapi_intptr_t next = hal_data->port_free_ptr;
+
+    /* look for a freed buffer of the same size first, free buffers
+       are chained through their 'read' field */
+    while (next != 0) {
+        port = SHMPTR(next);
+        if (port->size == size) {
+            if (prev) {
+                prev->read = port->read;
+            } else {
+                hal_data->port_free_ptr = port->read;
+            }
+            new_port = port;
+            break;
+        }
+        prev = port;
+        next = port->read;
+    }
+    if (new_port == 0) {
+        new_port = shmalloc_up(sizeof(hal_port_shm_t) + size);
+    }
+    if (new_port == 0) {
+        return 0;
+    }
 
     memset(new_port, 0, sizeof(hal_port_shm_t));
 
@@ -3627,6 +4109,7 @@ bool hal_port_read(hal_port_t port, char* dest, unsigned count) {
             memcpy(dest, port_shm->buff + read, end_bytes_to_read);
             memcpy(dest+end_bytes_to_read, port_shm->buff, beg_bytes_to_read);
             hal_port_atomic_store_read(port_shm, final_pos);
+            hal_wake(&port_shm->read, &port_shm->waiters);
             return true;
         } else {
             return false;
@@ -3688,6 +4171,7 @@ bool hal_port_peek_commit(hal_port_t port, unsigned count) {
                                  &final_pos)) {
 
             hal_port_atomic_store_read(port_shm, final_pos);
+            hal_wake(&port_shm->read, &port_shm->waiters);
             return true;
         } else {
             return false;
@@ -3743,6 +4227,7 @@ bool hal_port_write(hal_port_t port, const char* src, unsigned count) {
             memcpy(port_shm->buff, src+end_bytes_to_write, beg_bytes_to_write);
 
             hal_port_atomic_store_write(port_shm, final_pos);
+            hal_wake(&port_shm->write, &port_shm->waiters);
             return true;
         }
     }
@@ -3787,21 +4272,47 @@ void hal_port_clear(hal_port_t port) {
     if(port) {
         hal_port_atomic_load(port_shm, &read, &write);
         hal_port_atomic_store_read(port_shm, write);
+        hal_wake(&port_shm->read, &port_shm->waiters);
     }
 }
 
 
 #ifdef ULAPI
 void hal_port_wait_readable(hal_port_t** port, unsigned count, sig_atomic_t* stop) {
-    while((hal_port_readable(**port) < count) && (!stop || !*stop)) {
-        rtapi_delay(10000000);
+    while(!stop || !*stop) {
+        /* the pin may be relinked to another port while we wait */
+        hal_port_t p = **port;
+        hal_port_shm_t* port_shm = SHMPTR(p);
+        unsigned write;
+
+        if(!p) {
+            rtapi_delay(10000000);
+            continue;
+        }
+        write = atomic_load_explicit(&port_shm->write, memory_order_acquire);
+        if(hal_port_readable(p) >= count) {
+            break;
+        }
+        hal_wait(&port_shm->write, write, &port_shm->waiters);
     }
 }
 
 
 void hal_port_wait_writable(hal_port_t** port, unsigned count, sig_atomic_t* stop) {
-    while((hal_port_writable(**port) < count) && (!stop || !*stop)) {
-        rtapi_delay(10000000);
+    while(!stop || !*stop) {
+        hal_port_t p = **port;
+        hal_port_shm_t* port_shm = SHMPTR(p);
+        unsigned read;
+
+        if(!p) {
+            rtapi_delay(10000000);
+            continue;
+        }
+        read = atomic_load_explicit(&port_shm->read, memory_order_acquire);
+        if(hal_port_writable(p) >= count) {
+            break;
+        }
+        hal_wait(&port_shm->read, read, &port_shm->waiters);
     }
 }
 #endif
@@ -3921,16 +4432,20 @@ int hal_stream_maxdepth(hal_stream_t *stream) {
 
 #ifdef ULAPI
 void hal_stream_wait_writable(hal_stream_t *stream, sig_atomic_t *stop) {
-    while(!hal_stream_writable(stream) && (!stop || !*stop)) {
-        /* fifo full, sleep for 10ms */
-        rtapi_delay(10000000);
+    while(!stop || !*stop) {
+        unsigned out = atomic_load_explicit(&stream->fifo->out, memory_order_acquire);
+        if(hal_stream_writable(stream)) break;
+        /* fifo full, sleep until the reader takes something */
+        hal_wait(&stream->fifo->out, out, &stream->fifo->waiters);
     }
 }
 
 void hal_stream_wait_readable(hal_stream_t *stream, sig_atomic_t *stop) {
-    while(!hal_stream_readable(stream) && (!stop || !*stop)) {
-        /* fifo full, sleep for 10ms */
-        rtapi_delay(10000000);
+    while(!stop || !*stop) {
+        unsigned in = atomic_load_explicit(&stream->fifo->in, memory_order_acquire);
+        if(hal_stream_readable(stream)) break;
+        /* fifo empty, sleep until the writer adds something */
+        hal_wait(&stream->fifo->in, in, &stream->fifo->waiters);
     }
 }
 #endif
@@ -3969,6 +4484,7 @@ int hal_stream_write(hal_stream_t *stream, union hal_stream_data *buf) {
     memcpy(dptr, buf, sizeof(union hal_stream_data) * num_pins);
     dptr[num_pins].s = ++stream->fifo->this_sample;
     hal_stream_atomic_store_in(stream, newin);
+    hal_wake(&stream->fifo->in, &stream->fifo->waiters);
     return 0;
 }
 
@@ -3985,6 +4501,7 @@ int hal_stream_read(hal_stream_t *stream, union hal_stream_data *buf, unsigned *
     memcpy(buf, dptr, sizeof(union hal_stream_data) * num_pins);
     if(this_sample) *this_sample = dptr[num_pins].s;
     hal_stream_atomic_store_out(stream, newout);
+    hal_wake(&stream->fifo->out, &stream->fifo->waiters);
     return 0;
 }
 
@@ -4127,6 +4644,7 @@ EXPORT_SYMBOL(hal_export_funct);
 EXPORT_SYMBOL(hal_create_thread);
 
 EXPORT_SYMBOL(hal_add_funct_to_thread);
+EXPORT_SYMBOL(hal_add_funct_to_thread_group);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
 
 EXPORT_SYMBOL(hal_start_threads);
@@ -108,7 +108,7 @@ RTAPI_BEGIN_DECLS
 /* offset 0 is reserved for a null-ish pointer, so SHMCHK(hal_shmem_base) is
    false by design */
 #define SHMCHK(ptr)  ( ((char *)(ptr)) > (hal_shmem_base) && \
-                       ((char *)(ptr)) < (hal_shmem_base + HAL_SIZE) )
+                       ((char *)(ptr)) < (hal_shmem_base + hal_data->shmem_size) )
 
 /** The good news is that none of this linked list complexity is
     visible to the components that use this API.  Complexity here
@@ -134,6 +134,7 @@ typedef struct {
     volatile unsigned int read;  //offset into buff that outgoing data gets read from
     volatile unsigned int write; //offset into buff that incoming data gets written to
     unsigned int size;           //size of allocated buffer
+    volatile unsigned int waiters; //number of processes in hal_port_wait_*
     char buff[];                 
 } hal_port_shm_t;
 
@@ -162,6 +163,27 @@ typedef struct {
     char name[HAL_NAME_LEN + 1];	/* the original name */
 } hal_oldname_t;
 
+/** HAL "name index" data structure.
+    Pins, signals and parameters are found by name through a hash
+    table whose buckets are singly linked lists of these structs.  An
+    aliased object has two entries, one for its name and one for its
+    old name.  'name_ptr' points at whichever of the two this entry is
+    for, so a lookup only needs one strcmp() per candidate.
+*/
+#define HAL_NAME_INDEX_SIZE 1024	/* number of buckets, power of 2 */
+
+#define HAL_INDEX_PIN   1
+#define HAL_INDEX_SIG   2
+#define HAL_INDEX_PARAM 3
+
+typedef struct {
+    rtapi_intptr_t next_ptr;		/* next entry in bucket (or free list) */
+    int object_ptr;		/* pin, signal or parameter */
+    int name_ptr;		/* the name this entry was hashed from */
+    unsigned int hash;		/* full hash of that name */
+    int type;			/* HAL_INDEX_PIN, _SIG or _PARAM */
+} hal_index_t;
+
 /* Master HAL data structure
    There is a single instance of this structure in the machine.
    It resides at the base of the HAL shared memory block, where it
@@ -201,6 +223,14 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    rtapi_intptr_t index_free_ptr;	/* list of free name index structs */
+    rtapi_intptr_t pin_hint_ptr;	/* last pin inserted in pin list */
+    rtapi_intptr_t sig_hint_ptr;	/* last signal inserted in signal list */
+    rtapi_intptr_t param_hint_ptr;	/* last param inserted in param list */
+    long shmem_size;		/* size of the whole shmem block */
+    rtapi_intptr_t sig_data_free_ptr;	/* list of free signal data blocks */
+    rtapi_intptr_t port_free_ptr;	/* list of free port buffers */
+    rtapi_intptr_t name_index[HAL_NAME_INDEX_SIZE];	/* name hash buckets */
 } hal_data_t;
 
 /** HAL 'component' data structure.
@@ -278,6 +308,30 @@ typedef struct {
     that identify the functions connected to that thread.
 */
 
+/** Execution time histogram, one per function and one per thread,
+    updated by the thread after every run.  If 'bin_width' is zero the
+    bins are powers of two: bin 'n' counts runs of 2^n to 2^(n+1)-1
+    CPU cycles.  Otherwise bin 'n' counts runs of 'n' to 'n+1' times
+    'bin_width' cycles, and the last bin also counts all longer runs.
+    Runs longer than 'limit' cycles count as overruns.  When 'limit' is
+    zero a thread uses 'period', its measured start-to-start time, and
+    a function does no overrun counting.  'period' is kept apart from
+    the 'limit' param so that saving the params stays repeatable.
+    Setting 'reset' clears the counts at the start of the next run.
+*/
+#define HAL_TIMING_BINS 32
+
+typedef struct {
+    hal_s32_t bin_width;	/* (param) bin width in CPU cycles, 0 = log2 */
+    hal_s32_t limit;		/* (param) overrun limit in CPU cycles */
+    hal_bit_t reset;		/* (param) set to clear the counts */
+    hal_s32_t period;		/* measured period, threads only */
+    hal_u32_t *overrun_pin;	/* (pin) copy of 'overruns' */
+    hal_u32_t overruns;		/* number of runs longer than limit */
+    hal_u32_t samples;		/* number of runs counted */
+    hal_u32_t bins[HAL_TIMING_BINS];	/* number of runs per bin */
+} hal_timing_t;
+
 typedef struct {
     rtapi_intptr_t next_ptr;		/* next function in linked list */
     int uses_fp;		/* floating point flag */
@@ -289,6 +343,7 @@ typedef struct {
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
     hal_bit_t maxtime_increased;	/* on last call, maxtime increased */
+    hal_timing_t timing;	/* histogram of run times */
     char name[HAL_NAME_LEN + 1];	/* function name */
 } hal_funct_t;
 
@@ -297,8 +352,14 @@ typedef struct {
     void *arg;			/* argument for function */
     void (*funct) (void *, long);	/* ptr to function code */
     int funct_ptr;		/* pointer to function */
+    int group;			/* parallel group, 0 if none */
 } hal_funct_entry_t;
 
+/* Consecutive entries of a thread with the same non-zero group number
+   are handed to rtapi_task_parallel() together, at most this many at
+   a time, and the thread waits for all of them before going on. */
+#define HAL_PARALLEL_MAX 16
+
 #define HAL_STACKSIZE 16384	/* realtime task stacksize */
 
 typedef struct {
@@ -310,6 +371,7 @@ typedef struct {
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
     hal_list_t funct_list;	/* list of functions to run */
+    hal_timing_t timing;	/* histogram of run times */
     char name[HAL_NAME_LEN + 1];	/* thread name */
     int comp_id;
 } hal_thread_t;
@@ -337,8 +399,17 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000F	/* version code */
+#define HAL_VER   0x00000014	/* version code */
+
+/* HAL_SIZE is the default and minimum size of the shmem block.  A
+   larger block can be requested with the 'hal_size' parameter of
+   hal_lib (set from the HAL_SIZE environment variable by rtapi_app and
+   the realtime script, and from [HAL]HAL_SIZE by linuxcnc).  The size
+   actually in use is recorded in hal_data->shmem_size; non-realtime
+   processes map the default size first and then remap to that size.
+*/
 #define HAL_SIZE  (85*4096)
+#define HAL_SIZE_MAX  (256*1024*1024)
 #define HAL_PSEUDO_COMP_PREFIX "__" /* prefix to identify a pseudo component */
 
 /* These pointers are set by hal_init() to point to the shmem block
@@ -395,7 +466,8 @@ hal_list_t *list_remove_entry(hal_list_t * entry);
 
 /** The 'find_xxx_by_name()' functions search the appropriate list for
     an object that matches 'name'.  They return a pointer to the object,
-    or NULL if no matching object is found.
+    or NULL if no matching object is found.  Pins, signals and parameters
+    are looked up through the name index, so these don't walk the lists.
 */
 extern hal_comp_t *halpr_find_comp_by_name(const char *name);
 extern hal_pin_t *halpr_find_pin_by_name(const char *name);
@@ -444,7 +516,7 @@ extern hal_port_t hal_port_alloc(unsigned size);
 
 
 
-#define HAL_STREAM_MAGIC_NUM		0x4649464F
+#define HAL_STREAM_MAGIC_NUM		0x46494650
 struct hal_stream_shm {
     unsigned int magic;
     volatile unsigned int in;
@@ -453,6 +525,7 @@ struct hal_stream_shm {
     int depth;
     int num_pins;
     unsigned long num_overruns, num_underruns;
+    volatile unsigned int waiters;  /* number of processes in hal_stream_wait_* */
     hal_type_t type[HAL_STREAM_MAX_PINS];
     union hal_stream_data data[];
 };
@@ -67,6 +67,7 @@ static void print_script_sig_info(int type, char **patterns);
 static void print_param_info(int type, char **patterns);
 static void print_funct_info(char **patterns);
 static void print_thread_info(char **patterns);
+static void print_timing_info(char **patterns);
 static void print_comp_names(char **patterns);
 static void print_pin_names(char **patterns);
 static void print_sig_names(char **patterns);
@@ -309,13 +310,18 @@ int do_unecho_cmd(void) {
     return 0;
 }
 int do_addf_cmd(char *func, char *thread, char **opt) {
-    char *position_str = opt ? opt[0] : NULL;
-    int position = -1;
-    int retval;
+    int position = -1, group = 0;
+    int retval, n;
 
-    if(position_str && *position_str) position = atoi(position_str);
+    for(n = 0; opt && opt[n] && *opt[n]; n++) {
+        if(strncmp(opt[n], "group=", 6) == 0) {
+            group = atoi(opt[n] + 6);
+        } else {
+            position = atoi(opt[n]);
+        }
+    }
 
-    retval = hal_add_funct_to_thread(func, thread, position);
+    retval = hal_add_funct_to_thread_group(func, thread, position, group);
     if(retval == 0) {
         halcmd_info("Function '%s' added to thread '%s'\n",
                     func, thread);
@@ -1006,6 +1012,8 @@ int do_show_cmd(char *type, char **patterns)
 	print_funct_info(patterns);
     } else if (strcmp(type, "thread") == 0) {
 	print_thread_info(patterns);
+    } else if (strcmp(type, "timing") == 0) {
+	print_timing_info(patterns);
     } else if (strcmp(type, "alias") == 0) {
 	print_pin_aliases(patterns);
 	print_param_aliases(patterns);
@@ -1966,7 +1974,12 @@ static void print_thread_info(char **patterns)
 		/* scriptmode only uses one line per thread, which contains: 
 		   thread period, FP flag, name, then all functs separated by spaces  */
 		if (scriptmode == 0) {
-		    halcmd_output("                 %2d %s\n", n, funct->name);
+		    if (fentry->group) {
+			halcmd_output("                 %2d %s (group %d)\n",
+			    n, funct->name, fentry->group);
+		    } else {
+			halcmd_output("                 %2d %s\n", n, funct->name);
+		    }
 		} else {
 		    halcmd_output(" %s", funct->name);
 		}
@@ -1983,6 +1996,101 @@ static void print_thread_info(char **patterns)
     halcmd_output("\n");
 }
 
+/* upper edge, in CPU cycles, of histogram bin 'n' */
+static long timing_bin_top(hal_timing_t *timing, int n)
+{
+    if (timing->bin_width > 0) {
+	return (long)timing->bin_width * (n + 1);
+    }
+    return (long)((2UL << n) - 1);
+}
+
+/* smallest bin edge below which at least 'fraction' of the runs fell */
+static long timing_percentile(hal_timing_t *timing, double fraction)
+{
+    unsigned long count = 0, need;
+    int n;
+
+    if (timing->samples == 0) {
+	return 0;
+    }
+    need = (unsigned long)(fraction * timing->samples + 0.5);
+    if (need == 0) need = 1;
+    for (n = 0; n < HAL_TIMING_BINS; n++) {
+	count += timing->bins[n];
+	if (count >= need) {
+	    return timing_bin_top(timing, n);
+	}
+    }
+    return timing_bin_top(timing, HAL_TIMING_BINS - 1);
+}
+
+static void print_timing_line(hal_timing_t *timing, const char *name,
+    long maxtime, int histogram)
+{
+    int n;
+
+    halcmd_output("  %-32s %10lu %8ld %8ld %8ld %8ld %8lu\n",
+	name, (unsigned long)timing->samples,
+	timing_percentile(timing, 0.5), timing_percentile(timing, 0.99),
+	timing_percentile(timing, 0.999), maxtime,
+	(unsigned long)timing->overruns);
+    if (!histogram) {
+	return;
+    }
+    for (n = 0; n < HAL_TIMING_BINS; n++) {
+	if (timing->bins[n] == 0) continue;
+	if (timing->bin_width > 0 && n == HAL_TIMING_BINS - 1) {
+	    halcmd_output("      %10ld -          : %lu\n",
+		(long)timing->bin_width * n, (unsigned long)timing->bins[n]);
+	} else {
+	    halcmd_output("      %10ld - %8ld : %lu\n",
+		n ? timing_bin_top(timing, n - 1) + 1 : 0L,
+		timing_bin_top(timing, n), (unsigned long)timing->bins[n]);
+	}
+    }
+}
+
+static void print_timing_info(char **patterns)
+{
+    int next_thread, histogram;
+    hal_thread_t *tptr;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *fentry;
+    hal_funct_t *funct;
+
+    /* with a pattern, also print the bins of the matching items */
+    histogram = patterns && patterns[0] && patterns[0][0];
+    halcmd_output("Execution Times (CPU cycles):\n");
+    halcmd_output("  %-32s %10s %8s %8s %8s %8s %8s\n", "Thread/Function",
+	"Runs", "50%", "99%", "99.9%", "Max", "Overruns");
+    rtapi_mutex_get(&(hal_data->mutex));
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0) {
+	tptr = SHMPTR(next_thread);
+	if (match(patterns, tptr->name)) {
+	    print_timing_line(&(tptr->timing), tptr->name, tptr->maxtime,
+		histogram);
+	}
+	list_root = &(tptr->funct_list);
+	list_entry = list_next(list_root);
+	while (list_entry != list_root) {
+	    fentry = (hal_funct_entry_t *) list_entry;
+	    funct = SHMPTR(fentry->funct_ptr);
+	    if (match(patterns, tptr->name) || match(patterns, funct->name)) {
+		char name[HAL_NAME_LEN + 3];
+		snprintf(name, sizeof(name), "  %s", funct->name);
+		print_timing_line(&(funct->timing), name, funct->maxtime,
+		    histogram);
+	    }
+	    list_entry = list_next(list_entry);
+	}
+	next_thread = tptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    halcmd_output("\n");
+}
+
 static void print_comp_names(char **patterns)
 {
     int next;
@@ -2134,7 +2242,7 @@ static void print_mem_status()
     hal_param_t *param;
 
     halcmd_output("HAL memory status\n");
-    halcmd_output("  used/total shared memory:   %ld/%d\n", (long)(HAL_SIZE - hal_data->shmem_avail), HAL_SIZE);
+    halcmd_output("  used/total shared memory:   %ld/%ld\n", (long)(hal_data->shmem_size - hal_data->shmem_avail), hal_data->shmem_size);
     // count components
     active = count_list(hal_data->comp_list_ptr);
     recycled = count_list(hal_data->comp_free_ptr);
@@ -2169,6 +2277,8 @@ static void print_mem_status()
     active = count_list(hal_data->sig_list_ptr);
     recycled = count_list(hal_data->sig_free_ptr);
     halcmd_output("  active/recycled signals:    %d/%d\n", active, recycled);
+    recycled = count_list(hal_data->sig_data_free_ptr);
+    halcmd_output("  recycled signal data:       %d\n", recycled);
     // count functions
     active = count_list(hal_data->funct_list_ptr);
     recycled = count_list(hal_data->funct_free_ptr);
@@ -2718,7 +2828,12 @@ static void save_threads(FILE *dst)
 	    /* print the function info */
 	    fentry = (hal_funct_entry_t *) list_entry;
 	    funct = SHMPTR(fentry->funct_ptr);
-	    fprintf(dst, "addf %s %s\n", funct->name, tptr->name);
+	    if (fentry->group) {
+		fprintf(dst, "addf %s %s group=%d\n", funct->name,
+		    tptr->name, fentry->group);
+	    } else {
+		fprintf(dst, "addf %s %s\n", funct->name, tptr->name);
+	    }
 	    list_entry = list_next(list_entry);
 	}
 	next_thread = tptr->next_ptr;
@@ -2877,13 +2992,15 @@ int do_help_cmd(char *command)
 	printf("stype signame\n");
 	printf("  Gets the type of signal 'signame'\n");
     } else if (strcmp(command, "addf") == 0) {
-	printf("addf functname threadname [position]\n");
+	printf("addf functname threadname [position] [group=N]\n");
 	printf("  Adds function 'functname' to thread 'threadname'.  If\n");
 	printf("  'position' is specified, adds the function to that spot\n");
 	printf("  in the thread, otherwise adds it to the end.  Negative\n");
 	printf("  'position' means position with respect to the end of the\n");
 	printf("  thread.  For example '1' is start of thread, '-1' is the\n");
 	printf("  end of the thread, '-3' is third from the end.\n");
+	printf("  Adjacent functions with the same 'group' number may run\n");
+	printf("  at the same time on the CPUs listed in RTAPI_WORKER_CPUS.\n");
     } else if (strcmp(command, "delf") == 0) {
 	printf("delf functname threadname\n");
 	printf("  Removes function 'functname' from thread 'threadname'.\n");
@@ -2891,10 +3008,13 @@ int do_help_cmd(char *command)
 	printf("show [type] [pattern]\n");
 	printf("  Prints info about HAL items of the specified type.\n");
 	printf("  'type' is 'comp', 'pin', 'sig', 'param', 'funct',\n");
-	printf("  'thread', or 'all'.  If 'type' is omitted, it assumes\n");
-	printf("  'all' with no pattern.  If 'pattern' is specified\n");
+	printf("  'thread', 'timing', or 'all'.  If 'type' is omitted, it\n");
+	printf("  assumes 'all' with no pattern.  If 'pattern' is specified\n");
 	printf("  it prints only those items whose names match the\n");
 	printf("  pattern, which may be a 'shell glob'.\n");
+	printf("  'timing' prints run time percentiles and overruns for\n");
+	printf("  each thread and function, and with a pattern the full\n");
+	printf("  histograms of the matching ones.\n");
     } else if (strcmp(command, "list") == 0) {
 	printf("list type [pattern]\n");
 	printf("  Prints the names of HAL items of the specified type.\n");
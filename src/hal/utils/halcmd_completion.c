@@ -66,7 +66,7 @@ static const char *alias_table[] = {
 };
 
 static const char *show_table[] = {
-    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread",
+    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread", "timing",
     NULL,
 };
 
@@ -686,6 +686,8 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
                 result = func(text, funct_generator);
             } else if (startswith(n, "thread")) {
                 result = func(text, thread_generator);
+            } else if (startswith(n, "timing")) {
+                result = func(text, thread_generator);
             }
         }
     } else if(startswith(buffer, "save ") && argno == 1) {
@@ -195,9 +195,16 @@ struct REMOTE_LOGIN_REPLY:public REMOTE_CMS_REPLY {
 enum CMS_REMOTE_SUBSCRIPTION_REQUEST_TYPE {
     CMS_POLLED_SUBSCRIPTION = 1,
     CMS_NO_SUBSCRIPTION,
-    CMS_VARIABLE_SUBSCRIPTION
+    CMS_VARIABLE_SUBSCRIPTION,
+    CMS_DELTA_SUBSCRIPTION	// like variable, but only changes are sent
 };
 
+/* Set in the was_read word of a CMS_DELTA_SUBSCRIPTION reply when the data
+   is a patch against the previous message instead of the message itself.
+   The patch is the size of the new message followed by any number of
+   (offset, length, bytes) runs, all numbers 32 bit big endian. */
+#define CMS_DELTA_REPLY 0x100
+
 struct REMOTE_SET_SUBSCRIPTION_REQUEST:public REMOTE_CMS_REQUEST {
     REMOTE_SET_SUBSCRIPTION_REQUEST():REMOTE_CMS_REQUEST
 	(REMOTE_CMS_SET_SUBSCRIPTION_REQUEST_TYPE) {
@@ -27,6 +27,7 @@ extern "C" {
 #include <errno.h>		// errno
 #include <string.h>		/* strchr(), memcpy(), memset() */
 #include <stdlib.h>		/* strtod */
+#include <sched.h>		/* sched_yield() */
 #include <physmem.hh>           /* PHYSMEM_HANDLE */
 
 #ifdef __cplusplus
@@ -67,6 +68,8 @@ SHMEM::SHMEM(const char *n, long s, int nt, key_t k, int m):CMS(s)
 {
     /* Set pointers to null so only properly opened pointers are closed. */
     shm = NULL;
+    view_seq = NULL;
+    view_header = NULL;
 //  sem = NULL;
 
     /* save constructor args */
@@ -83,6 +86,8 @@ SHMEM::SHMEM(const char *bufline, const char *procline, int set_to_server,
 {
     /* Set pointers to null so only properly opened pointers are closed. */
     shm = NULL;
+    view_seq = NULL;
+    view_header = NULL;
     sem = NULL;
     sem_delay = 0.00001;
     char *semdelay_equation;
@@ -176,6 +181,8 @@ int SHMEM::open()
     shm = NULL;
     bsem = NULL;
     shm_addr_offset = NULL;
+    view_seq = NULL;
+    view_header = NULL;
     second_read = 0;
     autokey_table_size = 0;
 /*! \todo Another #if 0 */
@@ -391,6 +398,15 @@ int SHMEM::open()
 
     fast_mode = !queuing_enabled && !split_buffer && !neutral &&
 	(mutex_type == NO_SWITCHING_MUTEX);
+    if ((min_compatible_version > 2.58 || min_compatible_version <= 0) &&
+	!queuing_enabled && !split_buffer && !neutral &&
+	!enable_diagnostics && total_subdivisions <= 1) {
+	view_seq = (unsigned int *) ((char *) shm->addr + ((size + 3) & ~3));
+	view_header = (char *) shm->addr + skip_area;
+	if (master) {
+	    __atomic_store_n(view_seq, 0, __ATOMIC_RELEASE);
+	}
+    }
     handle_to_global_data = dummy_handle = new PHYSMEM_HANDLE;
     handle_to_global_data->set_to_ptr(shm_addr_offset, size);
     if ((connection_number < 0 || connection_number >= total_connections)
@@ -542,9 +558,23 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	disable_diag_store = 1;
     }
 
+    int bump_view_seq = (NULL != view_seq &&
+	(internal_access_type == CMS_WRITE_ACCESS
+	    || internal_access_type == CMS_WRITE_IF_READ_ACCESS
+	    || internal_access_type == CMS_CLEAR_ACCESS));
+    if (bump_view_seq) {
+	/* Odd while the message is changing. */
+	__atomic_add_fetch(view_seq, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
     /* Perform access function. */
     internal_access(shm->addr, size, _local, serial_number);
 
+    if (bump_view_seq) {
+	__atomic_add_fetch(view_seq, 1, __ATOMIC_RELEASE);
+    }
+
     disable_diag_store = 0;
 
     if (NULL != bsem &&
@@ -616,3 +646,59 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
     second_read = 0;
     return (status);
 }
+
+/* Look at the message in place. No semaphore is taken, a writer could be
+   changing the message the whole time, so view_end() checks afterwards
+   that view_seq has not moved. The was_read flag is left alone, as with
+   peek(). */
+CMS_STATUS SHMEM::view_begin(CMS_VIEW * view)
+{
+    CMS_HEADER view_hdr;
+    int tries = 0;
+
+    view->data = NULL;
+    view->size = 0;
+    if (NULL == view_seq || NULL == shm) {
+	return (status = CMS_NO_IMPLEMENTATION_ERROR);
+    }
+
+    while ((view->seq = __atomic_load_n(view_seq, __ATOMIC_ACQUIRE)) & 1) {
+	if (++tries > 100) {
+	    return (status = CMS_TIMED_OUT);
+	}
+	sched_yield();
+    }
+
+    memcpy(&view_hdr, view_header, sizeof(CMS_HEADER));
+    view->write_id = view_hdr.write_id;
+    view->last_id = in_buffer_id;
+    status = CMS_STATUS_NOT_SET;
+    if (check_id(view_hdr.write_id) != CMS_READ_OK) {
+	return (status);
+    }
+    if (view_hdr.in_buffer_size < 0
+	|| view_hdr.in_buffer_size > max_message_size) {
+	/* Probably caught a writer mid-way, try again later. */
+	in_buffer_id = view->last_id;
+	status = CMS_READ_OLD;
+	return (status);
+    }
+    view->size = view_hdr.in_buffer_size;
+    view->data = view_header + sizeof(CMS_HEADER);
+    return (status);
+}
+
+/* Returns 1 if nothing was written since view_begin(), otherwise 0, in
+   which case the message is treated as not read yet. */
+int SHMEM::view_end(CMS_VIEW * view)
+{
+    if (NULL == view_seq) {
+	return 0;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(view_seq, __ATOMIC_RELAXED) == view->seq) {
+	return 1;
+    }
+    in_buffer_id = view->last_id;
+    return 0;
+}
@@ -42,6 +42,8 @@ class SHMEM:public CMS {
     virtual ~ SHMEM();
 
     CMS_STATUS main_access(void *_local, int *serial_number);
+    CMS_STATUS view_begin(CMS_VIEW * view);
+    int view_end(CMS_VIEW * view);
 
   private:
 
@@ -78,6 +80,13 @@ class SHMEM:public CMS {
     RCS_SEMAPHORE *bsem;	// blocking semaphore
     int autokey_table_size;
 
+    /* Writer sequence number for view_begin()/view_end(), odd while a
+       write is in progress. Kept in the 32 bytes at the end of the shared
+       memory segment that open() takes off size. NULL if views can not be
+       used with this buffer. */
+    unsigned int *view_seq;
+    char *view_header;		/* CMS_HEADER of the message */
+
 };
 
 #endif /* !SHMEM_HH */
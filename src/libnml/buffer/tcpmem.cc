@@ -68,6 +68,7 @@ TCPMEM::TCPMEM(const char *_bufline, const char *_procline):CMS(_bufline, _procl
     old_handler = (void (*)(int)) SIG_ERR;
     sigpipe_count = 0;
     subscription_count = 0;
+    delta_base = NULL;
     read_serial_number = 0;
     write_serial_number = 0;
     read_socket_fd = 0;
@@ -91,6 +92,14 @@ TCPMEM::TCPMEM(const char *_bufline, const char *_procline):CMS(_bufline, _procl
 	    subscription_type = CMS_NO_SUBSCRIPTION;
 	} else if (!strncmp(sub_info_string + 4, "var", 3)) {
 	    subscription_type = CMS_VARIABLE_SUBSCRIPTION;
+	} else if (!strncmp(sub_info_string + 4, "delta", 5)) {
+	    /* the server checks the buffer for changes this often */
+	    poll_interval_millis = 10;
+	    if (sub_info_string[9] == ':') {
+		poll_interval_millis =
+		    ((int) (atof(sub_info_string + 10) * 1000.0));
+	    }
+	    subscription_type = CMS_DELTA_SUBSCRIPTION;
 	} else {
 	    poll_interval_millis =
 		((int) (atof(sub_info_string + 4) * 1000.0));
@@ -631,6 +640,40 @@ void TCPMEM::reconnect()
 TCPMEM::~TCPMEM()
 {
     disconnect();
+    if (NULL != delta_base) {
+	free(delta_base);
+	delta_base = NULL;
+    }
+}
+
+/* Apply the CMS_DELTA_REPLY patch in encoded_data to the previous message
+   and leave the result in encoded_data. Returns the size of the message or
+   -1 if the patch does not fit it. */
+long TCPMEM::apply_delta(long patch_size)
+{
+    char *patch = (char *) encoded_data;
+    long message_size, offset, length;
+    long i = 4;
+
+    if (NULL == delta_base || patch_size < 4) {
+	return -1;
+    }
+    message_size = getbe32(patch);
+    if (message_size > max_encoded_message_size) {
+	return -1;
+    }
+    while (i + 8 <= patch_size) {
+	offset = getbe32(patch + i);
+	length = getbe32(patch + i + 4);
+	i += 8;
+	if (offset + length > message_size || i + length > patch_size) {
+	    return -1;
+	}
+	memcpy(delta_base + offset, patch + i, length);
+	i += length;
+    }
+    memcpy(encoded_data, delta_base, message_size);
+    return message_size;
 }
 
 void TCPMEM::disconnect()
@@ -763,6 +806,28 @@ CMS_STATUS TCPMEM::handle_old_replies()
 	    if (waiting_for_message) {
 		timedout_request_writeid = waiting_message_id;
 	    }
+	    if (subscription_type == CMS_DELTA_SUBSCRIPTION) {
+		if (header.was_read & CMS_DELTA_REPLY) {
+		    header.was_read &= ~CMS_DELTA_REPLY;
+		    message_size = apply_delta(message_size);
+		    if (message_size < 0) {
+			rcs_print_error
+			    ("TCPMEM: Received a bad delta for %s.\n",
+			    BufferName);
+			fatal_error_occurred = 1;
+			reconnect_needed = 1;
+			return (status = CMS_MISC_ERROR);
+		    }
+		} else {
+		    if (NULL == delta_base) {
+			delta_base = (char *) malloc(max_encoded_message_size);
+		    }
+		    if (NULL != delta_base) {
+			memcpy(delta_base, encoded_data, message_size);
+		    }
+		}
+		header.in_buffer_size = message_size;
+	    }
 	}
 	break;
 
@@ -81,6 +81,8 @@ class TCPMEM:public CMS {
     void reenable_sigpipe();
     void verify_bufname();
     int subscription_count;
+    long apply_delta(long patch_size);
+    char *delta_base;		/* last whole message of a delta subscription */
 };
 
 #endif
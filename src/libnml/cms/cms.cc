@@ -37,6 +37,7 @@ extern "C" {
 #include "cms_xup.hh"		/* class CMS_XDR_UPDATER */
 #include "cms_aup.hh"		/* class CMS_ASCII_UPDATER */
 #include "cms_dup.hh"		/* class CMS_DISPLAY_ASCII_UPDATER */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
 #include "rcs_print.hh"		/* rcs_print_error(), separate_words() */
 				/* rcs_print_debug() */
 #include "cmsdiag.hh"
@@ -379,6 +380,10 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	    neutral_encoding_method = CMS_XDR_ENCODING;
 	    continue;
 	}
+	if (!strcmp(word[i], "PACKED")) {
+	    neutral_encoding_method = CMS_PACKED_ENCODING;
+	    continue;
+	}
 
 	char *port_string;
 	if (NULL != (port_string = strstr(word[i], "STCP="))) {
@@ -679,6 +684,10 @@ void CMS::open(void)
 	    updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    updater = new CMS_PACKED_UPDATER(this);
+	    break;
+
 	default:
 	    updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
@@ -901,6 +910,17 @@ CMS_STATUS CMS::main_access(void *_local, int *serial_number)
     return (CMS_MISC_ERROR);
 }
 
+CMS_STATUS CMS::view_begin(CMS_VIEW * view)
+{
+    view->data = NULL;
+    return (status = CMS_NO_IMPLEMENTATION_ERROR);
+}
+
+int CMS::view_end(CMS_VIEW * view)
+{
+    return 0;
+}
+
 /* General Utility Functions. */
 
 /* Check the buffer id against in_buffer_id to see if it is new. */
@@ -1123,6 +1143,10 @@ void CMS::set_temp_updater(CMS_NEUTRAL_ENCODING_METHOD temp_encoding_method)
 	    temp_updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    temp_updater = new CMS_PACKED_UPDATER(this);
+	    break;
+
 	default:
 	    temp_updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
@@ -1271,6 +1295,17 @@ int CMS::get_encoded_msg_size()
     return (header.in_buffer_size = updater->get_encoded_msg_size());
 }
 
+int CMS::check_decoded_msg()
+{
+    if (force_raw) {
+	return 0;
+    }
+    if (NULL == updater) {
+	return (-1);
+    }
+    return (updater->check_decoded_msg());
+}
+
 int CMS::check_pointer(char *ptr, long bytes)
 {
     if (force_raw) {
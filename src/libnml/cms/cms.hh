@@ -163,7 +163,18 @@ enum CMS_NEUTRAL_ENCODING_METHOD {
     CMS_NO_ENCODING,
     CMS_XDR_ENCODING,
     CMS_ASCII_ENCODING,
-    CMS_DISPLAY_ASCII_ENCODING
+    CMS_DISPLAY_ASCII_ENCODING,
+    CMS_PACKED_ENCODING
+};
+
+/* A message looked at in place in a shared memory buffer, see
+   CMS::view_begin(). */
+struct CMS_VIEW {
+    const void *data;		/* the message, or NULL if there is no new one */
+    long size;
+    CMSID write_id;
+    CMSID last_id;		/* in_buffer_id before the view was taken */
+    unsigned int seq;		/* writer sequence number when taken */
 };
 
 /* CMS class declaration. */
@@ -201,12 +212,21 @@ class CMS {
     virtual int get_queue_length();
     virtual int get_space_available();
 
+    /* Zero-copy reads. view_begin() points view->data at the message in
+       the buffer instead of copying it out. The message may be
+       overwritten while it is looked at, so anything taken from it is only
+       good if view_end() then returns 1. Only raw, unqueued SHMEM buffers
+       support this; others return CMS_NO_IMPLEMENTATION_ERROR. */
+    virtual CMS_STATUS view_begin(CMS_VIEW * view);
+    virtual int view_end(CMS_VIEW * view);
+
     /* Protocol Defined Virtual Function Stubs. */
     virtual CMS_STATUS main_access(void *_local, int *serial_number = NULL);
 
     /* Neutrally Encoded Buffer positioning functions. */
     void rewind();		/* positions at beginning */
     int get_encoded_msg_size();	/* Store last position in header.size */
+    int check_decoded_msg();	/* -1 if the message did not decode cleanly */
 
     /* Buffer access control functions. */
     void set_mode(CMSMODE im);	/* Determine read/write mode.(check neutral) */
@@ -0,0 +1,657 @@
+/********************************************************************
+* Description: cms_pup.cc
+*   Provides the interface to CMS used by NML update functions
+*   including a CMS update function for all the basic C data types
+*   to convert NMLmsgs to the PACKED encoding.
+*   NOTES: Every field is written little-endian at a fixed size with no
+*   padding: 1 byte for bool and char, 2 for short, 4 for int and float,
+*   8 for long and double. long double is sent as a double. On a
+*   little-endian host arrays are moved with a single memcpy().
+*   The first 4 bytes of each message hold a hash of the sequence of
+*   update() calls that produced it, which the reader checks against its
+*   own in check_decoded_msg().
+*
+*   Derived from a work by Fred Proctor & Will Shackleford
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>		/* memcpy() */
+#include <stdlib.h>		/* malloc(), free() */
+#include <stdint.h>		/* uint32_t, int64_t */
+#include <endian.h>		/* htole32(), le32toh(), __BYTE_ORDER */
+
+#ifdef __cplusplus
+}
+#endif
+#include "cms.hh"		/* class CMS */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
+#include "rcs_print.hh"		/* rcs_print_error() */
+
+/* Size of the layout hash at the start of each message. */
+#define PACKED_HASH_SIZE 4
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+/* Type tags hashed into the message layout. */
+enum {
+    PACKED_BOOL = 1,
+    PACKED_CHAR,
+    PACKED_UCHAR,
+    PACKED_SHORT,
+    PACKED_USHORT,
+    PACKED_INT,
+    PACKED_UINT,
+    PACKED_LONG,
+    PACKED_ULONG,
+    PACKED_FLOAT,
+    PACKED_DOUBLE,
+    PACKED_LDOUBLE,
+    PACKED_ARRAY = 0x80
+};
+
+/* Member functions for CMS_PACKED_UPDATER Class */
+
+CMS_PACKED_UPDATER::CMS_PACKED_UPDATER(CMS * _cms_parent):CMS_UPDATER
+(_cms_parent, 1, 2)
+{
+    /* Set pointers to NULL. */
+    begin_current_buffer = (unsigned char *) NULL;
+    end_current_buffer = (unsigned char *) NULL;
+    max_length_current_buffer = 0;
+    length_current_buffer = 0;
+    hashing = 0;
+    schema_hash = FNV_OFFSET_BASIS;
+    expected_schema_hash = FNV_OFFSET_BASIS;
+
+    /* Store and validate constructors arguments. */
+    cms_parent = _cms_parent;
+    if (NULL == cms_parent) {
+	rcs_print_error("CMS parent for updater is NULL.\n");
+	return;
+    }
+
+    /* Every header field is a long, so twice the native size is always
+       enough. */
+    encoded_header = malloc(neutral_size_factor * sizeof(CMS_HEADER));
+    if (encoded_header == NULL) {
+	rcs_print_error("CMS:can't malloc encoded_header");
+	status = CMS_CREATE_ERROR;
+	return;
+    }
+
+    if (cms_parent->queuing_enabled) {
+	encoded_queuing_header =
+	    malloc(neutral_size_factor * sizeof(CMS_QUEUING_HEADER));
+	if (encoded_queuing_header == NULL) {
+	    rcs_print_error("CMS:can't malloc encoded_queuing_header");
+	    status = CMS_CREATE_ERROR;
+	    return;
+	}
+    }
+}
+
+CMS_PACKED_UPDATER::~CMS_PACKED_UPDATER()
+{
+    if (NULL != encoded_data && !using_external_encoded_data) {
+	free(encoded_data);
+	encoded_data = NULL;
+    }
+    if (NULL != encoded_header) {
+	free(encoded_header);
+	encoded_header = NULL;
+    }
+    if (NULL != encoded_queuing_header) {
+	free(encoded_queuing_header);
+	encoded_queuing_header = NULL;
+    }
+}
+
+int CMS_PACKED_UPDATER::set_mode(CMS_UPDATER_MODE _mode)
+{
+    CMS_UPDATER::set_mode(_mode);
+    mode = _mode;
+    hashing = 0;
+    switch (mode) {
+    case CMS_NO_UPDATE:
+	begin_current_buffer = (unsigned char *) NULL;
+	max_length_current_buffer = 0;
+	break;
+
+    case CMS_ENCODE_DATA:
+    case CMS_DECODE_DATA:
+	begin_current_buffer = (unsigned char *) encoded_data;
+	max_length_current_buffer = neutral_size_factor * size;
+	if (max_length_current_buffer > cms_parent->max_encoded_message_size) {
+	    max_length_current_buffer = cms_parent->max_encoded_message_size;
+	}
+	if (max_length_current_buffer > encoded_data_size) {
+	    max_length_current_buffer = encoded_data_size;
+	}
+	hashing = 1;
+	break;
+
+    case CMS_ENCODE_HEADER:
+    case CMS_DECODE_HEADER:
+	begin_current_buffer = (unsigned char *) encoded_header;
+	max_length_current_buffer = neutral_size_factor * sizeof(CMS_HEADER);
+	break;
+
+    case CMS_ENCODE_QUEUING_HEADER:
+    case CMS_DECODE_QUEUING_HEADER:
+	begin_current_buffer = (unsigned char *) encoded_queuing_header;
+	max_length_current_buffer =
+	    neutral_size_factor * sizeof(CMS_QUEUING_HEADER);
+	break;
+
+    default:
+	rcs_print_error("CMS updater in invalid mode.\n");
+	return (-1);
+    }
+    /* Leave room for the hash but do not touch it here: the mode is
+       switched back and forth around header accesses while a message is
+       sitting in the buffer. */
+    end_current_buffer = begin_current_buffer;
+    length_current_buffer = 0;
+    if (hashing && NULL != begin_current_buffer) {
+	end_current_buffer += PACKED_HASH_SIZE;
+	length_current_buffer = PACKED_HASH_SIZE;
+    }
+    schema_hash = FNV_OFFSET_BASIS;
+    return (0);
+}
+
+int CMS_PACKED_UPDATER::check_pointer(char *_pointer, long _bytes)
+{
+    if (NULL == cms_parent || NULL == begin_current_buffer
+	|| NULL == end_current_buffer) {
+	rcs_print_error("CMS_PACKED_UPDATER: Required pointer is NULL.\n");
+	return (-1);
+    }
+    return (cms_parent->check_pointer(_pointer, _bytes));
+}
+
+/* Repositions the data buffer to the very beginning */
+void CMS_PACKED_UPDATER::rewind()
+{
+    CMS_UPDATER::rewind();
+    end_current_buffer = begin_current_buffer;
+    length_current_buffer = 0;
+    schema_hash = FNV_OFFSET_BASIS;
+    if (hashing && NULL != begin_current_buffer) {
+	if (!encoding) {
+	    uint32_t le;
+	    memcpy(&le, begin_current_buffer, sizeof(le));
+	    expected_schema_hash = le32toh(le);
+	}
+	end_current_buffer += PACKED_HASH_SIZE;
+	length_current_buffer = PACKED_HASH_SIZE;
+    }
+    if (NULL != cms_parent) {
+	cms_parent->format_size = 0;
+    }
+}
+
+int CMS_PACKED_UPDATER::get_encoded_msg_size()
+{
+    return (length_current_buffer);
+}
+
+/* Called once a whole message has been decoded. */
+int CMS_PACKED_UPDATER::check_decoded_msg()
+{
+    if (mode != CMS_DECODE_DATA || !hashing) {
+	return 0;
+    }
+    if (schema_hash != expected_schema_hash) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: message layout hash 0x%08X does not match 0x%08X from the writer.\n",
+	    schema_hash, expected_schema_hash);
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: Check that both ends use the same message definitions.\n");
+	status = CMS_UPDATE_ERROR;
+	return (-1);
+    }
+    return 0;
+}
+
+/* Mix one update() call into the layout hash, and when encoding keep the
+   hash at the start of the message current. */
+void CMS_PACKED_UPDATER::add_to_schema(int tag, unsigned int len)
+{
+    unsigned char bytes[5];
+    int i;
+
+    if (!hashing) {
+	return;
+    }
+    bytes[0] = (unsigned char) tag;
+    bytes[1] = (unsigned char) len;
+    bytes[2] = (unsigned char) (len >> 8);
+    bytes[3] = (unsigned char) (len >> 16);
+    bytes[4] = (unsigned char) (len >> 24);
+    for (i = 0; i < 5; i++) {
+	schema_hash = (schema_hash ^ bytes[i]) * FNV_PRIME;
+    }
+    if (encoding) {
+	uint32_t le = htole32(schema_hash);
+	memcpy(begin_current_buffer, &le, sizeof(le));
+    }
+}
+
+/* Move len items of 1, 2, 4 or 8 bytes between x and the encoded buffer.
+   The caller has already checked x. */
+
+CMS_STATUS CMS_PACKED_UPDATER::update_bytes(void *x, unsigned int len)
+{
+    if (length_current_buffer + (long) len > max_length_current_buffer) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: length of current buffer(%ld) + bytes to add of(%u) exceeds maximum of %ld.\n",
+	    length_current_buffer, len, max_length_current_buffer);
+	return (status = CMS_UPDATE_ERROR);
+    }
+    if (encoding) {
+	memcpy(end_current_buffer, x, len);
+    } else {
+	memcpy(x, end_current_buffer, len);
+    }
+    end_current_buffer += len;
+    length_current_buffer += len;
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update_u16(void *x, unsigned int len)
+{
+    long bytes = 2 * (long) len;
+    if (length_current_buffer + bytes > max_length_current_buffer) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: length of current buffer(%ld) + bytes to add of(%ld) exceeds maximum of %ld.\n",
+	    length_current_buffer, bytes, max_length_current_buffer);
+	return (status = CMS_UPDATE_ERROR);
+    }
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    if (encoding) {
+	memcpy(end_current_buffer, x, bytes);
+    } else {
+	memcpy(x, end_current_buffer, bytes);
+    }
+#else
+    uint16_t *p = (uint16_t *) x;
+    for (unsigned int i = 0; i < len; i++) {
+	uint16_t le;
+	if (encoding) {
+	    le = htole16(p[i]);
+	    memcpy(end_current_buffer + 2 * i, &le, 2);
+	} else {
+	    memcpy(&le, end_current_buffer + 2 * i, 2);
+	    p[i] = le16toh(le);
+	}
+    }
+#endif
+    end_current_buffer += bytes;
+    length_current_buffer += bytes;
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update_u32(void *x, unsigned int len)
+{
+    long bytes = 4 * (long) len;
+    if (length_current_buffer + bytes > max_length_current_buffer) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: length of current buffer(%ld) + bytes to add of(%ld) exceeds maximum of %ld.\n",
+	    length_current_buffer, bytes, max_length_current_buffer);
+	return (status = CMS_UPDATE_ERROR);
+    }
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    if (encoding) {
+	memcpy(end_current_buffer, x, bytes);
+    } else {
+	memcpy(x, end_current_buffer, bytes);
+    }
+#else
+    uint32_t *p = (uint32_t *) x;
+    for (unsigned int i = 0; i < len; i++) {
+	uint32_t le;
+	if (encoding) {
+	    le = htole32(p[i]);
+	    memcpy(end_current_buffer + 4 * i, &le, 4);
+	} else {
+	    memcpy(&le, end_current_buffer + 4 * i, 4);
+	    p[i] = le32toh(le);
+	}
+    }
+#endif
+    end_current_buffer += bytes;
+    length_current_buffer += bytes;
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update_u64(void *x, unsigned int len)
+{
+    long bytes = 8 * (long) len;
+    if (length_current_buffer + bytes > max_length_current_buffer) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: length of current buffer(%ld) + bytes to add of(%ld) exceeds maximum of %ld.\n",
+	    length_current_buffer, bytes, max_length_current_buffer);
+	return (status = CMS_UPDATE_ERROR);
+    }
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    if (encoding) {
+	memcpy(end_current_buffer, x, bytes);
+    } else {
+	memcpy(x, end_current_buffer, bytes);
+    }
+#else
+    uint64_t *p = (uint64_t *) x;
+    for (unsigned int i = 0; i < len; i++) {
+	uint64_t le;
+	if (encoding) {
+	    le = htole64(p[i]);
+	    memcpy(end_current_buffer + 8 * i, &le, 8);
+	} else {
+	    memcpy(&le, end_current_buffer + 8 * i, 8);
+	    p[i] = le64toh(le);
+	}
+    }
+#endif
+    end_current_buffer += bytes;
+    length_current_buffer += bytes;
+    return (status);
+}
+
+/* bool functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(bool &x)
+{
+    unsigned char c;
+
+    /* Check to see if the pointers are in the proper range. */
+    if (-1 == check_pointer((char *) &x, sizeof(bool))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_BOOL, 1);
+    c = x;
+    update_bytes(&c, 1);
+    if (!encoding) {
+	x = (c != 0);
+    }
+    return (status);
+}
+
+/* Char functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(char))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_CHAR, 1);
+    return (update_bytes(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(char) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_CHAR | PACKED_ARRAY, len);
+    return (update_bytes(x, len));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(unsigned char))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_UCHAR, 1);
+    return (update_bytes(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(unsigned char) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_UCHAR | PACKED_ARRAY, len);
+    return (update_bytes(x, len));
+}
+
+/* Short functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(short))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_SHORT, 1);
+    return (update_u16(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(short) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_SHORT | PACKED_ARRAY, len);
+    return (update_u16(x, len));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(unsigned short))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_USHORT, 1);
+    return (update_u16(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(unsigned short) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_USHORT | PACKED_ARRAY, len);
+    return (update_u16(x, len));
+}
+
+/* Int functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(int))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_INT, 1);
+    return (update_u32(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(int) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_INT | PACKED_ARRAY, len);
+    return (update_u32(x, len));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(unsigned int))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_UINT, 1);
+    return (update_u32(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(unsigned int) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_UINT | PACKED_ARRAY, len);
+    return (update_u32(x, len));
+}
+
+/* Long functions: always 8 bytes on the wire so 32 and 64 bit hosts can
+   talk to each other. */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(long))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_LONG, 1);
+    if (sizeof(long) == 8) {
+	return (update_u64(&x, 1));
+    }
+    int64_t l = x;
+    update_u64(&l, 1);
+    if (!encoding) {
+	x = (long) l;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(long) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_LONG | PACKED_ARRAY, len);
+    if (sizeof(long) == 8) {
+	return (update_u64(x, len));
+    }
+    for (unsigned int i = 0; i < len; i++) {
+	int64_t l = x[i];
+	if (update_u64(&l, 1) == CMS_UPDATE_ERROR) {
+	    break;
+	}
+	if (!encoding) {
+	    x[i] = (long) l;
+	}
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long int &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(unsigned long))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_ULONG, 1);
+    if (sizeof(unsigned long) == 8) {
+	return (update_u64(&x, 1));
+    }
+    uint64_t l = x;
+    update_u64(&l, 1);
+    if (!encoding) {
+	x = (unsigned long) l;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(unsigned long) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_ULONG | PACKED_ARRAY, len);
+    if (sizeof(unsigned long) == 8) {
+	return (update_u64(x, len));
+    }
+    for (unsigned int i = 0; i < len; i++) {
+	uint64_t l = x[i];
+	if (update_u64(&l, 1) == CMS_UPDATE_ERROR) {
+	    break;
+	}
+	if (!encoding) {
+	    x[i] = (unsigned long) l;
+	}
+    }
+    return (status);
+}
+
+/* Float functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(float &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(float))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_FLOAT, 1);
+    return (update_u32(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(float *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(float) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_FLOAT | PACKED_ARRAY, len);
+    return (update_u32(x, len));
+}
+
+/* Double functions */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(double))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_DOUBLE, 1);
+    return (update_u64(&x, 1));
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(double) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_DOUBLE | PACKED_ARRAY, len);
+    return (update_u64(x, len));
+}
+
+/* Long double functions: sent as doubles. */
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long double &x)
+{
+    if (-1 == check_pointer((char *) &x, sizeof(long double))) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_LDOUBLE, 1);
+    double d = (double) x;
+    update_u64(&d, 1);
+    if (!encoding) {
+	x = d;
+    }
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long double *x, unsigned int len)
+{
+    if (-1 == check_pointer((char *) x, sizeof(long double) * len)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    add_to_schema(PACKED_LDOUBLE | PACKED_ARRAY, len);
+    for (unsigned int i = 0; i < len; i++) {
+	double d = (double) x[i];
+	if (update_u64(&d, 1) == CMS_UPDATE_ERROR) {
+	    break;
+	}
+	if (!encoding) {
+	    x[i] = d;
+	}
+    }
+    return (status);
+}
@@ -0,0 +1,72 @@
+/********************************************************************
+* Description: cms_pup.hh
+*   Updater for the PACKED neutral encoding: fixed size little-endian
+*   fields with no padding, arrays copied in bulk and a hash of the
+*   message layout to catch mismatched message definitions.
+*
+*   Derived from a work by Fred Proctor & Will Shackleford
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifndef CMS_PUP_HH
+#define CMS_PUP_HH
+
+#include "cms_up.hh"		/* class CMS_UPDATER */
+
+class CMS_PACKED_UPDATER:public CMS_UPDATER {
+  public:
+    CMS_STATUS update(bool &x);
+    CMS_STATUS update(char &x);
+    CMS_STATUS update(unsigned char &x);
+    CMS_STATUS update(short int &x);
+    CMS_STATUS update(unsigned short int &x);
+    CMS_STATUS update(int &x);
+    CMS_STATUS update(unsigned int &x);
+    CMS_STATUS update(long int &x);
+    CMS_STATUS update(unsigned long int &x);
+    CMS_STATUS update(float &x);
+    CMS_STATUS update(double &x);
+    CMS_STATUS update(long double &x);
+    CMS_STATUS update(char *x, unsigned int len);
+    CMS_STATUS update(unsigned char *x, unsigned int len);
+    CMS_STATUS update(short *x, unsigned int len);
+    CMS_STATUS update(unsigned short *x, unsigned int len);
+    CMS_STATUS update(int *x, unsigned int len);
+    CMS_STATUS update(unsigned int *x, unsigned int len);
+    CMS_STATUS update(long *x, unsigned int len);
+    CMS_STATUS update(unsigned long *x, unsigned int len);
+    CMS_STATUS update(float *x, unsigned int len);
+    CMS_STATUS update(double *x, unsigned int len);
+    CMS_STATUS update(long double *x, unsigned int len);
+    int set_mode(CMS_UPDATER_MODE);
+    void rewind();
+    int get_encoded_msg_size();
+    int check_decoded_msg();
+  protected:
+    int check_pointer(char *, long);
+    void add_to_schema(int tag, unsigned int len);
+    CMS_STATUS update_bytes(void *x, unsigned int len);
+    CMS_STATUS update_u16(void *x, unsigned int len);
+    CMS_STATUS update_u32(void *x, unsigned int len);
+    CMS_STATUS update_u64(void *x, unsigned int len);
+      CMS_PACKED_UPDATER(CMS *);
+      virtual ~ CMS_PACKED_UPDATER();
+    friend class CMS;
+    unsigned char *begin_current_buffer;
+    unsigned char *end_current_buffer;
+    long max_length_current_buffer;
+    long length_current_buffer;
+    int hashing;		/* data modes only, headers have no hash */
+    unsigned int schema_hash;
+    unsigned int expected_schema_hash;
+};
+
+#endif
+// !defined(CMS_PUP_HH)
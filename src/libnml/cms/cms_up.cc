@@ -70,6 +70,11 @@ void CMS_UPDATER::rewind()
 {
 }
 
+int CMS_UPDATER::check_decoded_msg()
+{
+    return 0;
+}
+
 int CMS_UPDATER::set_mode(CMS_UPDATER_MODE _mode)
 {
     mode = _mode;
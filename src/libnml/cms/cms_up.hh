@@ -65,6 +65,8 @@ class CMS_UPDATER {
     virtual void rewind();	/* positions at beginning */
     virtual int get_encoded_msg_size() = 0;	/* Store last position in
 						   header.size */
+    virtual int check_decoded_msg();	/* Called after the last update()
+					   of a decoded message. */
     virtual int set_mode(CMS_UPDATER_MODE);
     virtual CMS_UPDATER_MODE get_mode();
     virtual void set_encoded_data(void *, long _encoded_data_size);
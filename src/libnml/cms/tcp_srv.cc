@@ -31,6 +31,7 @@ extern "C" {
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>		/* epoll_create1(), epoll_wait() */
 #include <errno.h>		/* errno */
 #include <signal.h>		// SIGPIPE, signal()
 
@@ -39,7 +40,6 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
-#include <sys/wait.h>		// waitpid
 
 #include <arpa/inet.h>		/* inet_ntoa */
 #include "cms.hh"		/* class CMS */
@@ -51,17 +51,8 @@ extern "C" {
 #include "timer.hh"		// esleep()
 #include "_timer.h"
 #include "cmsdiag.hh"		// class CMS_DIAGNOSTICS_INFO
-extern "C" {
-#include "recvn.h"		/* recvn() */
-#include "sendn.h"		/* sendn() */
-}
 #include "physmem.hh"           // PHYSMEM_HANDLE
 
-int tcpsvr_threads_created = 0;
-int tcpsvr_threads_killed = 0;
-int tcpsvr_threads_exited = 0;
-int tcpsvr_threads_returned_early = 0;
-
 TCPSVR_BLOCKING_READ_REQUEST::TCPSVR_BLOCKING_READ_REQUEST()
 {
     access_type = CMS_READ_ACCESS;	/* read or just peek */
@@ -133,7 +124,7 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     client_ports = (LinkedList *) NULL;
     connection_socket = 0;
     connection_port = 0;
-    maxfdpl = 0;
+    epoll_fd = -1;
     dtimeout = 20.0;
 
     memset(&server_socket_address, 0, sizeof(server_socket_address));
@@ -146,14 +137,12 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
 	rcs_print_error("Can not create linked list for client ports.\n");
 	return;
     }
+    blocking_ports = new LinkedList;
+    delta_buffer = NULL;
+    delta_buffer_size = 0;
     polling_enabled = 0;
-    memset(&select_timeout, 0, sizeof(select_timeout));
-    select_timeout.tv_sec = 30;
-    select_timeout.tv_usec = 30;
     subscription_buffers = NULL;
     current_poll_interval_millis = 30000;
-    memset(&read_fd_set, 0, sizeof(read_fd_set));
-    memset(&write_fd_set, 0, sizeof(write_fd_set));
 }
 
 CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
@@ -164,23 +153,14 @@ CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
 	delete client_ports;
 	client_ports = (LinkedList *) NULL;
     }
-}
-
-void blocking_thread_kill(long int id)
-{
-
-    if (id <= 0) {
-	return;
+    if (NULL != blocking_ports) {
+	delete blocking_ports;
+	blocking_ports = (LinkedList *) NULL;
+    }
+    if (NULL != delta_buffer) {
+	free(delta_buffer);
+	delta_buffer = NULL;
     }
-#ifdef POSIX_THREADS
-    pthread_kill(id, SIGINT);
-    pthread_join(id, NULL);
-#endif
-#ifdef NO_THREADS
-    kill(id, SIGINT);
-    waitpid(id, NULL, 0);
-#endif
-    tcpsvr_threads_killed++;
 }
 
 void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
@@ -195,6 +175,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 	client = (CLIENT_TCP_PORT *) client_ports->get_next();
 	number_of_connected_clients++;
     }
+    blocking_ports->flush_list();
     client = (CLIENT_TCP_PORT *) client_ports->get_head();
     while (NULL != client) {
 	delete client;
@@ -219,6 +200,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 	close(connection_socket);
 	connection_socket = 0;
     }
+    if (epoll_fd >= 0) {
+	close(epoll_fd);
+	epoll_fd = -1;
+    }
 }
 
 int CMS_SERVER_REMOTE_TCP_PORT::accept_local_port_cms(CMS * _cms)
@@ -301,361 +286,739 @@ static void handle_pipe_error(int signum)
     rcs_print_error("SIGPIPE intercepted.\n");
 }
 
+static void putbe32(char *addr, uint32_t val) {
+    val = htonl(val);
+    memcpy(addr, &val, sizeof(val));
+}
+
+static uint32_t getbe32(char *addr) {
+    uint32_t val;
+    memcpy(&val, addr, sizeof(val));
+    return ntohl(val);
+}
+
 void CMS_SERVER_REMOTE_TCP_PORT::run()
 {
-    int bytes_ready;
     int ready_descriptors;
+    int timeout_millis;
+    struct epoll_event ev;
+    struct epoll_event events[TCPSVR_MAX_EVENTS];
     if (NULL == client_ports) {
 	rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
 	return;
     }
-    CLIENT_TCP_PORT *new_client_port, *client_port_to_check;
-    FD_ZERO(&read_fd_set);
-    FD_ZERO(&write_fd_set);
-    FD_SET(connection_socket, &read_fd_set);
-    maxfdpl = connection_socket + 1;
+    CLIENT_TCP_PORT *client_port_to_check;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	rcs_print_error("epoll_create1 error: %d -- %s\n", errno,
+	    strerror(errno));
+	return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;		/* NULL marks the connection socket */
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection_socket, &ev) < 0) {
+	rcs_print_error("epoll_ctl error: %d -- %s\n", errno,
+	    strerror(errno));
+	return;
+    }
     signal(SIGPIPE, handle_pipe_error);
     rcs_print_debug(PRINT_CMS_CONFIG_INFO,
 	"running server for TCP port %d (connection_socket = %d).\n",
 	ntohs(server_socket_address.sin_port), connection_socket);
 
     cms_server_count++;
-    fd_set read_fd_set_copy, write_fd_set_copy;
-    FD_ZERO(&read_fd_set_copy);
-    FD_ZERO(&write_fd_set_copy);
-    FD_SET(connection_socket, &read_fd_set_copy);
 
     while (1) {
+	timeout_millis = -1;
 	if (polling_enabled) {
-	    memcpy(&read_fd_set_copy, &read_fd_set, sizeof(fd_set));
-	    memcpy(&write_fd_set_copy, &write_fd_set, sizeof(fd_set));
-	    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-	    select_timeout.tv_usec =
-		(current_poll_interval_millis % 1000) * 1000;
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) & select_timeout);
-	    if (ready_descriptors == 0) {
-		update_subscriptions();
-		memcpy(&read_fd_set, &read_fd_set_copy, sizeof(fd_set));
-		memcpy(&write_fd_set, &write_fd_set_copy, sizeof(fd_set));
-		continue;
-	    }
-	} else {
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) NULL);
-
+	    timeout_millis = current_poll_interval_millis;
 	}
-	if (ready_descriptors < 0) {
-	    rcs_print_error("server: select error.(errno = %d | %s)\n",
-		errno, strerror(errno));
+	if (blocking_ports->list_size > 0 &&
+	    (timeout_millis < 0
+		|| timeout_millis > TCPSVR_BLOCKING_READ_POLL_MILLIS)) {
+	    timeout_millis = TCPSVR_BLOCKING_READ_POLL_MILLIS;
 	}
-	if (NULL == client_ports) {
-	    rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
-	    return;
+	ready_descriptors =
+	    epoll_wait(epoll_fd, events, TCPSVR_MAX_EVENTS, timeout_millis);
+	if (ready_descriptors < 0) {
+	    if (errno != EINTR) {
+		rcs_print_error
+		    ("server: epoll_wait error.(errno = %d | %s)\n", errno,
+		    strerror(errno));
+	    }
+	    ready_descriptors = 0;
 	}
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (FD_ISSET(client_port_to_check->socket_fd, &read_fd_set)) {
-		ioctl(client_port_to_check->socket_fd, FIONREAD,
-		    (caddr_t) & bytes_ready);
-		if (bytes_ready <= 0) {
+	for (int i = 0; i < ready_descriptors; i++) {
+	    client_port_to_check = (CLIENT_TCP_PORT *) events[i].data.ptr;
+	    if (NULL == client_port_to_check) {
+		accept_client();
+		continue;
+	    }
+	    if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+		rcs_print_debug(PRINT_SOCKET_CONNECT,
+		    "Socket closed by host with IP address %s.\n",
+		    inet_ntoa(client_port_to_check->address.sin_addr));
+		close_client(client_port_to_check);
+		continue;
+	    }
+	    if (events[i].events & EPOLLOUT) {
+		flush_replies(client_port_to_check);
+	    }
+	    if ((events[i].events & EPOLLIN)
+		&& !client_port_to_check->closing) {
+		if (receive_requests(client_port_to_check) < 0) {
 		    rcs_print_debug(PRINT_SOCKET_CONNECT,
 			"Socket closed by host with IP address %s.\n",
 			inet_ntoa(client_port_to_check->address.sin_addr));
-		    if (NULL != client_port_to_check->subscriptions) {
-			TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
-			    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-			    client_port_to_check->subscriptions->get_head();
-			while (NULL != clnt_sub_info) {
-			    if (NULL != clnt_sub_info->sub_buf_info &&
-				clnt_sub_info->subscription_list_id >= 0) {
-				if (NULL !=
-				    clnt_sub_info->sub_buf_info->
-				    sub_clnt_info) {
-				    clnt_sub_info->sub_buf_info->
-					sub_clnt_info->
-					delete_node(clnt_sub_info->
-					subscription_list_id);
-				    if (clnt_sub_info->sub_buf_info->
-					sub_clnt_info->list_size < 1) {
-					delete clnt_sub_info->sub_buf_info->
-					    sub_clnt_info;
-					clnt_sub_info->sub_buf_info->
-					    sub_clnt_info = NULL;
-					if (NULL != subscription_buffers
-					    && clnt_sub_info->sub_buf_info->
-					    list_id >= 0) {
-					    subscription_buffers->
-						delete_node(clnt_sub_info->
-						sub_buf_info->list_id);
-					    delete clnt_sub_info->
-						sub_buf_info;
-					    clnt_sub_info->sub_buf_info =
-						NULL;
-					}
-				    }
-				    clnt_sub_info->sub_buf_info = NULL;
-				}
-				delete clnt_sub_info;
-				clnt_sub_info =
-				    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-				    client_port_to_check->subscriptions->
-				    get_next();
-			    }
-			    delete client_port_to_check->subscriptions;
-			    client_port_to_check->subscriptions = NULL;
-			    recalculate_polling_interval();
-			}
-		    }
-		    if (client_port_to_check->threadId > 0
-			&& client_port_to_check->blocking) {
-			blocking_thread_kill(client_port_to_check->threadId);
-		    }
-		    close(client_port_to_check->socket_fd);
-		    FD_CLR(client_port_to_check->socket_fd, &read_fd_set);
-		    client_port_to_check->socket_fd = -1;
-		    delete client_port_to_check;
-		    client_ports->delete_current_node();
-		} else {
-		    if (client_port_to_check->blocking) {
-			if (client_port_to_check->threadId > 0) {
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Data received from %s:%d when it should be blocking (bytes_ready=%d).\n",
-				inet_ntoa
-				(client_port_to_check->address.
-				    sin_addr),
-				client_port_to_check->socket_fd, bytes_ready);
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Killing handler %d.\n",
-				client_port_to_check->threadId);
-
-			    blocking_thread_kill
-				(client_port_to_check->threadId);
-#if 0
-			    *((uint32_t *) temp_buffer) =
-				htonl(client_port_to_check->serial_number);
-			    *((uint32_t *) temp_buffer + 1) =
-				htonl((unsigned long)
-				CMS_SERVER_SIDE_ERROR);
-			    putbe32(temp_buffer + 8, 0);	/* size
-									 */
-			    putbe32(temp_buffer + 12, 0);	/* write_id
-									 */
-			    putbe32(temp_buffer + 16, 0);	/* was_read
-									 */
-			    sendn(client_port_to_check->socket_fd,
-				temp_buffer, 20, 0, dtimeout);
-#endif
-			    client_port_to_check->threadId = 0;
-			    client_port_to_check->blocking = 0;
-			}
-		    }
-		    handle_request(client_port_to_check);
+		    close_client(client_port_to_check);
+		    continue;
 		}
-		ready_descriptors--;
-	    } else {
-		FD_SET(client_port_to_check->socket_fd, &read_fd_set);
+		handle_requests(client_port_to_check);
 	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	if (FD_ISSET(connection_socket, &read_fd_set)
-	    && ready_descriptors > 0) {
-	    ready_descriptors--;
-	    socklen_t client_address_length;
-	    new_client_port = new CLIENT_TCP_PORT();
-	    client_address_length = sizeof(new_client_port->address);
-	    new_client_port->socket_fd = accept(connection_socket,
-		(struct sockaddr *)
-		&new_client_port->address, &client_address_length);
-	    current_clients++;
-	    if (current_clients > max_clients) {
-		max_clients = current_clients;
+	    if (client_port_to_check->closing) {
+		close_client(client_port_to_check);
 	    }
-	    if (new_client_port->socket_fd < 0) {
-		rcs_print_error("server: accept error -- %d %s \n", errno,
-		    strerror(errno));
-		continue;
+	}
+	check_blocking_reads();
+	update_subscriptions();
+    }
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::accept_client()
+{
+    struct epoll_event ev;
+    socklen_t client_address_length;
+    CLIENT_TCP_PORT *new_client_port = new CLIENT_TCP_PORT();
+    client_address_length = sizeof(new_client_port->address);
+    new_client_port->socket_fd = accept(connection_socket,
+	(struct sockaddr *) &new_client_port->address,
+	&client_address_length);
+    if (new_client_port->socket_fd < 0) {
+	rcs_print_error("server: accept error -- %d %s \n", errno,
+	    strerror(errno));
+	delete new_client_port;
+	return;
+    }
+    rcs_print_debug(PRINT_SOCKET_CONNECT,
+	"Socket opened by host with IP address %s.\n",
+	inet_ntoa(new_client_port->address.sin_addr));
+    new_client_port->serial_number = 0;
+    new_client_port->blocking = 0;
+    new_client_port->epoll_events = EPOLLIN;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = new_client_port->epoll_events;
+    ev.data.ptr = new_client_port;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, new_client_port->socket_fd,
+	    &ev) < 0) {
+	rcs_print_error("epoll_ctl error: %d -- %s\n", errno,
+	    strerror(errno));
+	delete new_client_port;
+	return;
+    }
+    current_clients++;
+    if (current_clients > max_clients) {
+	max_clients = current_clients;
+    }
+    new_client_port->list_id =
+	client_ports->store_at_tail(new_client_port,
+	sizeof(new_client_port), 0);
+}
+
+/* Forget everything about a client: its subscriptions, any blocking read
+   it is waiting in, and its socket. */
+void CMS_SERVER_REMOTE_TCP_PORT::close_client(CLIENT_TCP_PORT * clnt)
+{
+    if (clnt->blocking) {
+	cancel_blocking_read(clnt);
+    }
+    remove_all_subscriptions(clnt);
+    if (clnt->socket_fd >= 0) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, clnt->socket_fd, NULL);
+	close(clnt->socket_fd);
+	clnt->socket_fd = -1;
+	current_clients--;
+    }
+    client_ports->delete_node(clnt->list_id);
+    delete clnt;
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::remove_all_subscriptions(CLIENT_TCP_PORT *
+    clnt)
+{
+    if (NULL == clnt->subscriptions) {
+	return;
+    }
+    TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
+	(TCP_CLIENT_SUBSCRIPTION_INFO *) clnt->subscriptions->get_head();
+    while (NULL != clnt_sub_info) {
+	TCP_BUFFER_SUBSCRIPTION_INFO *buf_info = clnt_sub_info->sub_buf_info;
+	if (NULL != buf_info && NULL != buf_info->sub_clnt_info) {
+	    /* the client is stored in sub_clnt_info under a different
+	       id than subscription_list_id, so look for the pointer */
+	    void *node = buf_info->sub_clnt_info->get_head();
+	    while (NULL != node) {
+		if (node == clnt_sub_info) {
+		    buf_info->sub_clnt_info->delete_current_node();
+		}
+		node = buf_info->sub_clnt_info->get_next();
 	    }
-	    rcs_print_debug(PRINT_SOCKET_CONNECT,
-		"Socket opened by host with IP address %s.\n",
-		inet_ntoa(new_client_port->address.sin_addr));
-	    new_client_port->serial_number = 0;
-	    new_client_port->blocking = 0;
-	    if (NULL != client_ports) {
-		client_ports->store_at_tail(new_client_port,
-		    sizeof(new_client_port), 0);
+	    if (buf_info->sub_clnt_info->list_size < 1) {
+		if (NULL != subscription_buffers && buf_info->list_id >= 0) {
+		    subscription_buffers->delete_node(buf_info->list_id);
+		}
+		delete buf_info;
 	    }
-	    if (maxfdpl < new_client_port->socket_fd + 1) {
-		maxfdpl = new_client_port->socket_fd + 1;
+	}
+	clnt_sub_info->sub_buf_info = NULL;
+	delete clnt_sub_info;
+	clnt_sub_info =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *) clnt->subscriptions->get_next();
+    }
+    delete clnt->subscriptions;
+    clnt->subscriptions = NULL;
+    if (NULL != subscription_buffers) {
+	recalculate_polling_interval();
+    }
+}
+
+/* Register for EPOLLOUT only while replies are queued, so an idle client
+   costs nothing. */
+void CMS_SERVER_REMOTE_TCP_PORT::watch_client(CLIENT_TCP_PORT * clnt)
+{
+    struct epoll_event ev;
+    unsigned int events = EPOLLIN;
+    if (clnt->write_queue_end > clnt->write_queue_start) {
+	events |= EPOLLOUT;
+    }
+    if (events == clnt->epoll_events || clnt->socket_fd < 0) {
+	return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = clnt;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, clnt->socket_fd, &ev) < 0) {
+	rcs_print_error("epoll_ctl error: %d -- %s\n", errno,
+	    strerror(errno));
+	clnt->closing = 1;
+	shutdown(clnt->socket_fd, SHUT_RDWR);
+	return;
+    }
+    clnt->epoll_events = events;
+}
+
+/* Send as much of a reply as the socket takes without blocking and keep
+   the rest for flush_replies(), so one slow client can not stall the
+   others. Returns -1 if the client should be dropped. */
+int CMS_SERVER_REMOTE_TCP_PORT::queue_reply(CLIENT_TCP_PORT * clnt,
+    const char *data, long size)
+{
+    if (clnt->socket_fd < 0 || clnt->closing) {
+	return -1;
+    }
+    if (clnt->write_queue_end == clnt->write_queue_start) {
+	ssize_t sent = send(clnt->socket_fd, data, size,
+	    MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (sent < 0) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		rcs_print_error("Send error: %d = %s\n", errno,
+		    strerror(errno));
+		clnt->closing = 1;
+		shutdown(clnt->socket_fd, SHUT_RDWR);
+		return -1;
 	    }
-	    FD_SET(new_client_port->socket_fd, &read_fd_set);
-	} else {
-	    FD_SET(connection_socket, &read_fd_set);
+	    sent = 0;
 	}
-	if (0 != ready_descriptors) {
-	    rcs_print_error("%d descriptors ready but not serviced.\n",
-		ready_descriptors);
+	data += sent;
+	size -= sent;
+	if (size == 0) {
+	    return 0;
 	}
-	update_subscriptions();
     }
+    long queued = clnt->write_queue_end - clnt->write_queue_start;
+    if (queued + size > TCPSVR_MAX_WRITE_QUEUE) {
+	rcs_print_error
+	    ("Client %s is not reading its replies -- closing connection(%d)\n",
+	    inet_ntoa(clnt->address.sin_addr), clnt->socket_fd);
+	clnt->closing = 1;
+	shutdown(clnt->socket_fd, SHUT_RDWR);
+	return -1;
+    }
+    if (clnt->write_queue_end + size > clnt->write_queue_size) {
+	if (clnt->write_queue_start > 0) {
+	    memmove(clnt->write_queue,
+		clnt->write_queue + clnt->write_queue_start, queued);
+	    clnt->write_queue_start = 0;
+	    clnt->write_queue_end = queued;
+	}
+	if (queued + size > clnt->write_queue_size) {
+	    long new_size = clnt->write_queue_size * 2;
+	    if (new_size < queued + size) {
+		new_size = queued + size;
+	    }
+	    char *new_queue = (char *) realloc(clnt->write_queue, new_size);
+	    if (NULL == new_queue) {
+		rcs_print_error("Out of memory queuing reply.\n");
+		clnt->closing = 1;
+		shutdown(clnt->socket_fd, SHUT_RDWR);
+		return -1;
+	    }
+	    clnt->write_queue = new_queue;
+	    clnt->write_queue_size = new_size;
+	}
+    }
+    memcpy(clnt->write_queue + clnt->write_queue_end, data, size);
+    clnt->write_queue_end += size;
+    watch_client(clnt);
+    return 0;
 }
 
-static int tcpsvr_handle_blocking_request_sigint_count = 0;
-static int tcpsvr_last_sig = 0;
-
-void tcpsvr_handle_blocking_request_sigint_handler(int sig)
+void CMS_SERVER_REMOTE_TCP_PORT::flush_replies(CLIENT_TCP_PORT * clnt)
 {
-    tcpsvr_last_sig = sig;
-    tcpsvr_handle_blocking_request_sigint_count++;
+    while (clnt->write_queue_end > clnt->write_queue_start) {
+	ssize_t sent = send(clnt->socket_fd,
+	    clnt->write_queue + clnt->write_queue_start,
+	    clnt->write_queue_end - clnt->write_queue_start,
+	    MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (sent < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+		rcs_print_error("Send error: %d = %s\n", errno,
+		    strerror(errno));
+		clnt->closing = 1;
+		shutdown(clnt->socket_fd, SHUT_RDWR);
+	    }
+	    return;
+	}
+	clnt->write_queue_start += sent;
+    }
+    clnt->write_queue_start = 0;
+    clnt->write_queue_end = 0;
+    watch_client(clnt);
 }
 
-static void putbe32(char *addr, uint32_t val) {
-    val = htonl(val);
-    memcpy(addr, &val, sizeof(val));
+/* Queue the 20 byte read reply header and the data, in one send if they
+   fit in temp_buffer. */
+int CMS_SERVER_REMOTE_TCP_PORT::queue_read_reply(CLIENT_TCP_PORT * clnt,
+    REMOTE_READ_REPLY * reply)
+{
+    putbe32(temp_buffer, clnt->serial_number);
+    putbe32(temp_buffer + 4, reply->status);
+    putbe32(temp_buffer + 8, reply->size);
+    putbe32(temp_buffer + 12, reply->write_id);
+    putbe32(temp_buffer + 16, reply->was_read);
+    if (reply->size < (0x2000 - 20) && reply->size > 0) {
+	memcpy(temp_buffer + 20, reply->data, reply->size);
+	return queue_reply(clnt, temp_buffer, 20 + reply->size);
+    }
+    if (queue_reply(clnt, temp_buffer, 20) < 0) {
+	return -1;
+    }
+    if (reply->size > 0) {
+	return queue_reply(clnt, (char *) reply->data, reply->size);
+    }
+    return 0;
 }
 
-static uint32_t getbe32(char *addr) {
-    uint32_t val;
-    memcpy(&val, addr, sizeof(val));
-    return ntohl(val);
+/* Encode cur as runs of the bytes that differ from old, in the
+   CMS_DELTA_REPLY format. Returns the size of the patch, or -1 if it would
+   not be smaller than cur itself. */
+static long make_delta(const char *old, long old_size, const char *cur,
+    long cur_size, char *out)
+{
+    long common = old_size < cur_size ? old_size : cur_size;
+    long out_size = 4;
+    long i = 0;
+
+    putbe32(out, cur_size);
+    while (i < cur_size) {
+	if (i < common && old[i] == cur[i]) {
+	    i++;
+	    continue;
+	}
+	/* a run ends after 8 unchanged bytes, the cost of a new run header */
+	long last_diff = i;
+	long j = i + 1;
+	while (j < cur_size && j - last_diff <= 8) {
+	    if (j >= common || old[j] != cur[j]) {
+		last_diff = j;
+	    }
+	    j++;
+	}
+	long len = last_diff + 1 - i;
+	if (out_size + 8 + len >= cur_size) {
+	    return -1;
+	}
+	putbe32(out + out_size, i);
+	putbe32(out + out_size + 4, len);
+	memcpy(out + out_size + 8, cur + i, len);
+	out_size += 8 + len;
+	i = last_diff + 1;
+    }
+    return out_size;
 }
 
-#if defined(POSIX_THREADS) || defined(NO_THREADS)
-void *tcpsvr_handle_blocking_request(void *_req)
+/* Send a CMS_DELTA_SUBSCRIPTION client the changes since the last message
+   it was sent, or the whole message if it has none yet or the patch would
+   not be smaller. */
+int CMS_SERVER_REMOTE_TCP_PORT::queue_delta_reply(TCP_CLIENT_SUBSCRIPTION_INFO
+    * sub_info, REMOTE_READ_REPLY * reply)
 {
-    signal(SIGINT, tcpsvr_handle_blocking_request_sigint_handler);
-    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
-	(TCPSVR_BLOCKING_READ_REQUEST *) _req;
-    char temp_buffer[0x2000];
-    if (_req == NULL) {
-	tcpsvr_threads_returned_early++;
-	return 0;
+    CLIENT_TCP_PORT *clnt = sub_info->clnt_port;
+    long patch_size = -1;
+
+    if (NULL != sub_info->last_data) {
+	if (delta_buffer_size < reply->size + 4) {
+	    char *new_buffer = (char *) realloc(delta_buffer, reply->size + 4);
+	    if (NULL != new_buffer) {
+		delta_buffer = new_buffer;
+		delta_buffer_size = reply->size + 4;
+	    }
+	}
+	if (delta_buffer_size >= reply->size + 4) {
+	    patch_size = make_delta(sub_info->last_data, sub_info->last_size,
+		(char *) reply->data, reply->size, delta_buffer);
+	}
     }
-    double dtimeout =
-	((double) (blocking_read_req->timeout_millis + 10)) / 1000.0;
-    if (dtimeout < 0) {
-	dtimeout = 600.0;
+    if (sub_info->last_data_max < reply->size) {
+	char *new_data = (char *) realloc(sub_info->last_data, reply->size);
+	if (NULL == new_data) {
+	    free(sub_info->last_data);
+	    sub_info->last_data = NULL;
+	    sub_info->last_data_max = 0;
+	    return queue_read_reply(clnt, reply);
+	}
+	sub_info->last_data = new_data;
+	sub_info->last_data_max = reply->size;
     }
-    if (dtimeout < 0.5) {
-	dtimeout = 0.5;
+    memcpy(sub_info->last_data, reply->data, reply->size);
+    sub_info->last_size = reply->size;
+    if (patch_size < 0) {
+	return queue_read_reply(clnt, reply);
+    }
+
+    putbe32(temp_buffer, clnt->serial_number);
+    putbe32(temp_buffer + 4, reply->status);
+    putbe32(temp_buffer + 8, patch_size);
+    putbe32(temp_buffer + 12, reply->write_id);
+    putbe32(temp_buffer + 16, reply->was_read | CMS_DELTA_REPLY);
+    if (patch_size < (0x2000 - 20)) {
+	memcpy(temp_buffer + 20, delta_buffer, patch_size);
+	return queue_reply(clnt, temp_buffer, 20 + patch_size);
     }
-    if (dtimeout > 600.0) {
-	dtimeout = 600.0;
+    if (queue_reply(clnt, temp_buffer, 20) < 0) {
+	return -1;
     }
-    CLIENT_TCP_PORT *_client_tcp_port = blocking_read_req->_client_tcp_port;
-    CMS_SERVER *server = blocking_read_req->server;
+    return queue_reply(clnt, delta_buffer, patch_size);
+}
 
-    if (NULL == server || NULL == _client_tcp_port) {
-	tcpsvr_threads_returned_early++;
-	return 0;
+/* A blocking read is answered at once if the buffer already holds a
+   message the client has not seen; otherwise the client is parked on
+   blocking_ports and the buffer is polled from check_blocking_reads()
+   until new data shows up or the timeout passes. */
+void CMS_SERVER_REMOTE_TCP_PORT::start_blocking_read(CLIENT_TCP_PORT * clnt,
+    CMS_SERVER * server)
+{
+    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req = clnt->blocking_read_req;
+    if (blocking_read_req->timeout_millis < 0) {
+	clnt->blocking_deadline = -1.0;
+    } else {
+	clnt->blocking_deadline =
+	    etime() + blocking_read_req->timeout_millis / 1000.0;
     }
-    memset(temp_buffer, 0, 0x2000);
-    REMOTE_BLOCKING_READ_REPLY *read_reply;
+    clnt->blocking = 1;
+    if (poll_blocking_read(clnt, server)) {
+	clnt->blocking = 0;
+	return;
+    }
+    clnt->blocking_list_id =
+	blocking_ports->store_at_tail(clnt, sizeof(clnt), 0);
+}
 
-    if (NULL != _client_tcp_port->diag_info) {
-	_client_tcp_port->diag_info->buffer_number =
-	    blocking_read_req->buffer_number;
-	server->set_diag_info(_client_tcp_port->diag_info);
+/* Returns 1 once the client has been answered. */
+int CMS_SERVER_REMOTE_TCP_PORT::poll_blocking_read(CLIENT_TCP_PORT * clnt,
+    CMS_SERVER * server)
+{
+    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req = clnt->blocking_read_req;
+
+    if (NULL != clnt->diag_info) {
+	clnt->diag_info->buffer_number = blocking_read_req->buffer_number;
+	server->set_diag_info(clnt->diag_info);
     } else if (server->diag_enabled) {
 	server->reset_diag_info(blocking_read_req->buffer_number);
     }
 
-    read_reply = (REMOTE_BLOCKING_READ_REPLY *)
-	server->process_request(blocking_read_req);
-    blocking_read_req->read_reply = read_reply;
-    if (NULL == read_reply) {
-	_client_tcp_port->blocking = 0;
+    server->read_req.buffer_number = blocking_read_req->buffer_number;
+    server->read_req.access_type = blocking_read_req->access_type;
+    server->read_req.last_id_read = blocking_read_req->last_id_read;
+    server->read_req.subdiv = blocking_read_req->subdiv;
+    server->read_reply =
+	(REMOTE_READ_REPLY *) server->process_request(&server->read_req);
+    if (NULL == server->read_reply) {
 	rcs_print_error("Server could not process request.\n");
-	putbe32(temp_buffer, _client_tcp_port->serial_number);
+	putbe32(temp_buffer, clnt->serial_number);
 	putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	putbe32(temp_buffer + 8, 0);	/* size */
-	putbe32(temp_buffer + 12, 0)	/* write_id */;
-	putbe32(temp_buffer + 16, 0)	/* was_read */;
-	sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
-	_client_tcp_port->errors++;
-	_client_tcp_port->blocking_read_req = NULL;
-	delete blocking_read_req;
-	_client_tcp_port->threadId = 0;
-	tcpsvr_threads_returned_early++;
-	return 0;
+	putbe32(temp_buffer + 12, 0);	/* write_id */
+	putbe32(temp_buffer + 16, 0);	/* was_read */
+	queue_reply(clnt, temp_buffer, 20);
+	clnt->errors++;
+	return 1;
     }
-    putbe32(temp_buffer, _client_tcp_port->serial_number);
-    putbe32(temp_buffer + 4, read_reply->status);
-    putbe32(temp_buffer + 8, read_reply->size);
-    putbe32(temp_buffer + 12, read_reply->write_id);
-    putbe32(temp_buffer + 16, read_reply->was_read);
-    if (read_reply->size < (0x2000 - 20) && read_reply->size > 0) {
-	memcpy(temp_buffer + 20, read_reply->data, read_reply->size);
-	_client_tcp_port->blocking = 0;
-	if (sendn
-	    (_client_tcp_port->socket_fd, temp_buffer, 20 + read_reply->size,
-		0, dtimeout) < 0) {
-	    _client_tcp_port->blocking = 0;
-	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
+    if (server->read_reply->status == CMS_READ_OLD) {
+	if (clnt->blocking_deadline < 0 || etime() < clnt->blocking_deadline) {
 	    return 0;
 	}
-    } else {
-	_client_tcp_port->blocking = 0;
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout) <
-	    0) {
-	    _client_tcp_port->blocking = 0;
-	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
-	    return 0;
+	putbe32(temp_buffer, clnt->serial_number);
+	putbe32(temp_buffer + 4, CMS_TIMED_OUT);
+	putbe32(temp_buffer + 8, 0);	/* size */
+	putbe32(temp_buffer + 12, blocking_read_req->last_id_read);
+	putbe32(temp_buffer + 16, 1);	/* was_read */
+	if (queue_reply(clnt, temp_buffer, 20) < 0) {
+	    clnt->errors++;
 	}
-	if (read_reply->size > 0) {
-	    if (sendn
-		(_client_tcp_port->socket_fd, read_reply->data,
-		    read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->blocking = 0;
-		_client_tcp_port->errors++;
-		_client_tcp_port->blocking_read_req = NULL;
-		delete blocking_read_req;
-		_client_tcp_port->threadId = 0;
-		tcpsvr_threads_returned_early++;
+	return 1;
+    }
+    if (queue_read_reply(clnt, server->read_reply) < 0) {
+	clnt->errors++;
+    }
+    return 1;
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::cancel_blocking_read(CLIENT_TCP_PORT * clnt)
+{
+    if (!clnt->blocking) {
+	return;
+    }
+    blocking_ports->delete_node(clnt->blocking_list_id);
+    clnt->blocking_list_id = -1;
+    clnt->blocking = 0;
+}
+
+/* Answer the clients waiting in a blocking read on buffer_number, or on
+   any buffer if it is negative, whose data has come in or whose timeout
+   has passed. */
+void CMS_SERVER_REMOTE_TCP_PORT::check_blocking_reads(long buffer_number)
+{
+    if (blocking_ports->list_size < 1) {
+	return;
+    }
+    pid_t pid = getpid();
+    pid_t tid = 0;
+    CMS_SERVER *server;
+    server = find_server(pid, tid);
+    if (NULL == server) {
+	rcs_print_error
+	    ("CMS_SERVER_REMOTE_TCP_PORT::check_blocking_reads Cannot find server object for pid = %d.\n",
+	    pid);
+	return;
+    }
+    CLIENT_TCP_PORT *clnt = (CLIENT_TCP_PORT *) blocking_ports->get_head();
+    while (NULL != clnt) {
+	if ((buffer_number < 0
+		|| clnt->blocking_read_req->buffer_number == buffer_number)
+	    && poll_blocking_read(clnt, server)) {
+	    blocking_ports->delete_current_node();
+	    clnt->blocking_list_id = -1;
+	    clnt->blocking = 0;
+	}
+	clnt = (CLIENT_TCP_PORT *) blocking_ports->get_next();
+    }
+}
+
+/* Read whatever the client has sent so far without blocking, so a client
+   which sends part of a request can not stall the others. The rest of the
+   request is waited for by epoll like any other input. Returns -1 once the
+   client has closed the connection or it failed. */
+int CMS_SERVER_REMOTE_TCP_PORT::receive_requests(CLIENT_TCP_PORT * clnt)
+{
+    long space = clnt->read_buffer_end - clnt->read_buffer_start + 1;
+    if (space < TCPSVR_READ_BUFFER_SIZE) {
+	space = TCPSVR_READ_BUFFER_SIZE;
+    }
+    if (reserve_request_space(clnt, space) < 0) {
+	return -1;
+    }
+    while (1) {
+	ssize_t received = recv(clnt->socket_fd,
+	    clnt->read_buffer + clnt->read_buffer_end,
+	    clnt->read_buffer_size - clnt->read_buffer_end, MSG_DONTWAIT);
+	if (received < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
 		return 0;
 	    }
+	    rcs_print_error("Can not read from client port (%d) from %s\n",
+		clnt->socket_fd, inet_ntoa(clnt->address.sin_addr));
+	    return -1;
 	}
+	if (received == 0) {
+	    return -1;
+	}
+	clnt->read_buffer_end += received;
+	return 0;
     }
-    _client_tcp_port->blocking_read_req = NULL;
-    delete blocking_read_req;
-    _client_tcp_port->threadId = 0;
-    tcpsvr_threads_exited++;
-#ifdef POSIX_THREADS
-    pthread_exit(0);
-#endif
-#ifdef NO_THREADS
-    exit(0);
-#endif
 }
 
-#endif
+/* Make room for size bytes from the start of the current request. */
+int CMS_SERVER_REMOTE_TCP_PORT::reserve_request_space(CLIENT_TCP_PORT *
+    clnt, long size)
+{
+    long buffered = clnt->read_buffer_end - clnt->read_buffer_start;
+    if (clnt->read_buffer_start + size <= clnt->read_buffer_size) {
+	return 0;
+    }
+    if (clnt->read_buffer_start > 0) {
+	memmove(clnt->read_buffer,
+	    clnt->read_buffer + clnt->read_buffer_start, buffered);
+	clnt->read_buffer_start = 0;
+	clnt->read_buffer_end = buffered;
+    }
+    if (size <= clnt->read_buffer_size) {
+	return 0;
+    }
+    char *new_buffer = (char *) realloc(clnt->read_buffer, size);
+    if (NULL == new_buffer) {
+	rcs_print_error("Out of memory reading request.\n");
+	return -1;
+    }
+    clnt->read_buffer = new_buffer;
+    clnt->read_buffer_size = size;
+    return 0;
+}
 
-void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
-    _client_tcp_port)
+/* The size of the request at the front of the client's read buffer with
+   its 20 byte header, or 0 if the header is not all there yet. What
+   follows the header depends on the request type and, for reads and
+   writes, on the buffer. Returns -1 for a write too large to take. */
+long CMS_SERVER_REMOTE_TCP_PORT::request_length(CLIENT_TCP_PORT * clnt,
+    CMS_SERVER * server)
+{
+    char *header = clnt->read_buffer + clnt->read_buffer_start;
+    long length = 20;
+    int total_subdivisions = 1;
+
+    if (clnt->read_buffer_end - clnt->read_buffer_start < 20) {
+	return 0;
+    }
+    long request_type = getbe32(header + 4);
+    long buffer_number = getbe32(header + 8);
+    switch (request_type) {
+    case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
+	length += 68;
+	break;
+
+    case REMOTE_CMS_BLOCKING_READ_REQUEST_TYPE:
+    case REMOTE_CMS_READ_REQUEST_TYPE:
+    case REMOTE_CMS_WRITE_REQUEST_TYPE:
+	if (max_total_subdivisions > 1) {
+	    total_subdivisions =
+		server->get_total_subdivisions(buffer_number);
+	}
+	if (request_type == REMOTE_CMS_BLOCKING_READ_REQUEST_TYPE) {
+	    length += (total_subdivisions > 1) ? 8 : 4;
+	} else if (total_subdivisions > 1) {
+	    length += 4;
+	}
+	if (request_type == REMOTE_CMS_WRITE_REQUEST_TYPE) {
+	    long size = (int32_t) getbe32(header + 16);
+	    if (size > server->maximum_cms_size) {
+		return -1;
+	    }
+	    if (size > 0) {
+		length += size;
+	    }
+	}
+	break;
+
+    case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
+	length += 16;
+	break;
+
+    case REMOTE_CMS_LOGIN_REQUEST_TYPE:
+	length += 32;
+	break;
+
+    default:
+	break;
+    }
+    return length;
+}
+
+/* Copy the next size bytes of the request being handled out of the read
+   buffer. */
+int CMS_SERVER_REMOTE_TCP_PORT::take_request(CLIENT_TCP_PORT * clnt,
+    char *data, long size)
+{
+    if (clnt->read_buffer_end - clnt->read_buffer_start < size) {
+	return -1;
+    }
+    memcpy(data, clnt->read_buffer + clnt->read_buffer_start, size);
+    clnt->read_buffer_start += size;
+    return 0;
+}
+
+/* Handle every request the client has sent in full. A write wakes the
+   clients waiting in a blocking read on the buffer written to, rather
+   than leaving them to the next check_blocking_reads(). */
+void CMS_SERVER_REMOTE_TCP_PORT::handle_requests(CLIENT_TCP_PORT * clnt)
 {
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     pid_t pid = getpid();
     pid_t tid = 0;
     CMS_SERVER *server;
     server = find_server(pid, tid);
     if (NULL == server) {
 	rcs_print_error
-	    ("CMS_SERVER_REMOTE_TCP_PORT::handle_request() Cannot find server object for pid = %d.\n",
+	    ("CMS_SERVER_REMOTE_TCP_PORT::handle_requests() Cannot find server object for pid = %d.\n",
 	    pid);
 	return;
     }
 
+    while (!clnt->closing) {
+	long length = request_length(clnt, server);
+	if (length < 0) {
+	    rcs_print_error
+		("Request from %s is too large -- closing connection(%d)\n",
+		inet_ntoa(clnt->address.sin_addr), clnt->socket_fd);
+	    clnt->closing = 1;
+	    break;
+	}
+	if (length == 0
+	    || length > clnt->read_buffer_end - clnt->read_buffer_start) {
+	    if (length > 0 && reserve_request_space(clnt, length) < 0) {
+		clnt->closing = 1;
+	    }
+	    break;
+	}
+	if (clnt->blocking) {
+	    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+		"Data received from %s:%d when it should be blocking.\n",
+		inet_ntoa(clnt->address.sin_addr), clnt->socket_fd);
+	    cancel_blocking_read(clnt);
+	}
+	long start = clnt->read_buffer_start;
+	long request_type = getbe32(clnt->read_buffer + start + 4);
+	long buffer_number = getbe32(clnt->read_buffer + start + 8);
+	handle_request(clnt, server);
+	/* the whole request is used up, even if handling it stopped early */
+	clnt->read_buffer_start = start + length;
+	if (request_type == REMOTE_CMS_WRITE_REQUEST_TYPE) {
+	    check_blocking_reads(buffer_number);
+	}
+    }
+    if (clnt->read_buffer_start == clnt->read_buffer_end) {
+	clnt->read_buffer_start = 0;
+	clnt->read_buffer_end = 0;
+    }
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
+    _client_tcp_port, CMS_SERVER * server)
+{
     if (server->using_passwd_file) {
 	current_user_info = get_connected_user(_client_tcp_port->socket_fd);
     }
@@ -663,23 +1026,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     if (_client_tcp_port->errors >= _client_tcp_port->max_errors) {
 	rcs_print_error("Too many errors - closing connection(%d)\n",
 	    _client_tcp_port->socket_fd);
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		delete client_port_to_check;
-		client_ports->delete_current_node();
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	_client_tcp_port->socket_fd = -1;
+	_client_tcp_port->closing = 1;
+	return;
     }
 
-    if (recvn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, -1, NULL) < 0) {
+    if (take_request(_client_tcp_port, temp_buffer, 20) < 0) {
 	rcs_print_error("Can not read from client port (%d) from %s\n",
 	    _client_tcp_port->socket_fd,
 	    inet_ntoa(_client_tcp_port->address.sin_addr));
@@ -733,7 +1084,6 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     long request_type, long buffer_number, long received_serial_number)
 {
     int total_subdivisions = 1;
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     switch (request_type) {
     case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
 	{
@@ -741,9 +1091,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		_client_tcp_port->diag_info =
 		    new REMOTE_SET_DIAG_INFO_REQUEST();
 	    }
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->set_diag_info_buf, 68,
-		    0, -1, NULL) < 0) {
+	    if (take_request(_client_tcp_port,
+		server->set_diag_info_buf, 68) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -784,9 +1133,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer+4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (queue_reply(_client_tcp_port, temp_buffer, 24) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -794,9 +1141,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply->cdi) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (queue_reply(_client_tcp_port, temp_buffer, 24) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -943,9 +1288,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    }
 	    *((uint32_t *) temp_buffer + 6) = htonl(dpi_count);
 	    *((uint32_t *) temp_buffer + 7) = htonl(dpi_offset);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, dpi_offset, 0,
-		    dtimeout) < 0) {
+	    if (queue_reply(_client_tcp_port, temp_buffer, dpi_offset) < 0) {
 		_client_tcp_port->errors++;
 		return;
 	    }
@@ -965,18 +1308,14 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, namereply->status);
 		strncpy(temp_buffer + 8, namereply->name, 31);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (queue_reply(_client_tcp_port, temp_buffer, 40) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
 	    } else {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (queue_reply(_client_tcp_port, temp_buffer, 40) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
@@ -988,16 +1327,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	{
 	    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
 
-#ifdef NO_THREADS
 	    if (NULL == _client_tcp_port->blocking_read_req) {
 		_client_tcp_port->blocking_read_req =
 		    new TCPSVR_BLOCKING_READ_REQUEST();
 	    }
 	    blocking_read_req = _client_tcp_port->blocking_read_req;
-#else
-	    blocking_read_req;
-	    = new TCPSVR_BLOCKING_READ_REQUEST();
-#endif
 	    blocking_read_req->buffer_number = buffer_number;
 	    blocking_read_req->access_type =
 		ntohl(*((uint32_t *) temp_buffer + 3));
@@ -1009,10 +1343,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		    server->get_total_subdivisions(buffer_number);
 	    }
 	    if (total_subdivisions > 1) {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((uint32_t *) temp_buffer) + 5), 8, 0, -1,
-			NULL) < 0) {
+		if (take_request(_client_tcp_port,
+			(char *) (((uint32_t *) temp_buffer) + 5), 8) < 0) {
 		    rcs_print_error
 			("Can not read from client port (%d) from %s\n",
 			_client_tcp_port->socket_fd,
@@ -1023,10 +1355,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		blocking_read_req->subdiv =
 		    ntohl(*((uint32_t *) temp_buffer + 6));
 	    } else {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-			NULL) < 0) {
+		blocking_read_req->subdiv = 0;
+		if (take_request(_client_tcp_port,
+			(char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		    rcs_print_error
 			("Can not read from client port (%d) from %s\n",
 			_client_tcp_port->socket_fd,
@@ -1036,77 +1367,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		}
 	    }
 	    blocking_read_req->timeout_millis =
-		ntohl(*((uint32_t *) temp_buffer + 5));
+		(int32_t) ntohl(*((uint32_t *) temp_buffer + 5));
 	    blocking_read_req->server = server;
 	    blocking_read_req->remport = this;
-	    _client_tcp_port->blocking = 1;
 	    blocking_read_req->_client_tcp_port = _client_tcp_port;
-#ifdef POSIX_THREADS
-	    int thr_retval = pthread_create(&(_client_tcp_port->threadId),	/* ptr to new-thread-id */
-		NULL,		// pthread_attr_t *, ptr to attributes
-		tcpsvr_handle_blocking_request,	// start_func
-		blocking_read_req	// arg for start_func
-		);
-	    if (thr_retval != 0) {
-		_client_tcp_port->blocking = 0;
-		rcs_print_error("pthread_create error: thr_retval = %d\n",
-		    thr_retval);
-		rcs_print_error("pthread_create error: %d %s\n", errno,
-		    strerror(errno));
-		*((uint32_t *) temp_buffer) =
-		    htonl(_client_tcp_port->serial_number);
-		*((uint32_t *) temp_buffer + 1) =
-		    htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);	/* size */
-		putbe32(temp_buffer + 12, 0);	/* write_id */
-		putbe32(temp_buffer + 16, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		return;
-	    }
-#else
-#ifdef NO_THREADS
-	    int fork_ret = fork();
-	    switch (fork_ret) {
-	    case 0:		// child
-		_client_tcp_port->threadId = getpid();
-		tcpsvr_handle_blocking_request(blocking_read_req);
-		exit(0);
-		break;
-
-	    case -1:		// Error
-		rcs_print_error("fork error: %d %s\n", errno,
-		    strerror(errno));
-		_client_tcp_port->blocking = 0;
-		putbe32(temp_buffer, _client_tcp_port->serial_number);
-		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);
-		putbe32(temp_buffer + 12, 0);
-		putbe32(temp_buffer + 16, 0);
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		break;
-
-	    default:		// parent;
-		_client_tcp_port->threadId = fork_ret;
-		break;
-	    }
-#else
-	    rcs_print_error
-		("Blocking read not supported on this platform.\n");
-	    *((uint32_t *) temp_buffer) =
-		htonl(_client_tcp_port->serial_number);
-	    *((uint32_t *) temp_buffer + 1) =
-		htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-	    putbe32(temp_buffer + 8, 0);	/* size */
-	    putbe32(temp_buffer + 12, 0);	/* write_id */
-	    putbe32(temp_buffer + 16, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
-	    return;
-
-#endif
-#endif
-	    tcpsvr_threads_created++;
+	    start_blocking_read(_client_tcp_port, server);
 	}
 	break;
 
@@ -1121,10 +1386,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
+	    if (take_request(_client_tcp_port,
+		(char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -1143,39 +1406,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer + 8, 0);
 	    putbe32(temp_buffer + 12, 0);
 	    putbe32(temp_buffer + 16, 0);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	}
-	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	putbe32(temp_buffer + 4, server->read_reply->status);
-	putbe32(temp_buffer + 8, server->read_reply->size);
-	putbe32(temp_buffer + 12, server->read_reply->write_id);
-	putbe32(temp_buffer + 16, server->read_reply->was_read);
-	if (server->read_reply->size < (0x2000 - 20)
-	    && server->read_reply->size > 0) {
-	    memcpy(temp_buffer + 20, server->read_reply->data,
-		server->read_reply->size);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer,
-		    20 + server->read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	} else {
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    if (server->read_reply->size > 0) {
-		if (sendn
-		    (_client_tcp_port->socket_fd, server->read_reply->data,
-			server->read_reply->size, 0, dtimeout) < 0) {
-		    _client_tcp_port->errors++;
-		    return;
-		}
-	    }
+	if (queue_read_reply(_client_tcp_port, server->read_reply) < 0) {
+	    _client_tcp_port->errors++;
+	    return;
 	}
 	break;
 
@@ -1189,10 +1425,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
+	    if (take_request(_client_tcp_port,
+		(char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -1205,9 +1439,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    server->write_req.subdiv = 0;
 	}
 	if (server->write_req.size > 0) {
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->write_req.data,
-		    server->write_req.size, 0, -1, NULL) < 0) {
+	    if (take_request(_client_tcp_port,
+		(char *) server->write_req.data, server->write_req.size) < 0) {
 		_client_tcp_port->errors++;
 		return;
 	    }
@@ -1222,16 +1455,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	        putbe32(temp_buffer, reply->write_id);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 		putbe32(temp_buffer + 8, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout);
+		queue_reply(_client_tcp_port, temp_buffer, 12);
 		return;
 	    }
 	    putbe32(temp_buffer, reply->write_id);
 	    putbe32(temp_buffer + 4, reply->status);
 	    putbe32(temp_buffer + 8, reply->was_read);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout) < 0) {
+	    if (queue_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 		_client_tcp_port->errors++;
 	    }
 	} else {
@@ -1253,7 +1483,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1261,7 +1491,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->check_if_read_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->check_if_read_reply->was_read);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	if (queue_reply(_client_tcp_port, temp_buffer, 12) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1279,7 +1509,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1287,7 +1517,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_msg_count_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_msg_count_reply->count);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	if (queue_reply(_client_tcp_port, temp_buffer, 12) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1305,7 +1535,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1313,7 +1543,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_queue_length_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_queue_length_reply->queue_length);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	if (queue_reply(_client_tcp_port, temp_buffer, 12) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1331,7 +1561,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1339,7 +1569,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_space_available_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_space_available_reply->space_available);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
+	if (queue_reply(_client_tcp_port, temp_buffer, 12) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1355,12 +1585,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
 	putbe32(temp_buffer + 4, server->clear_reply->status);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout) <
+	if (queue_reply(_client_tcp_port, temp_buffer, 8) <
 	    0) {
 	    _client_tcp_port->errors++;
 	}
@@ -1372,30 +1602,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	break;
 
     case REMOTE_CMS_CLOSE_CHANNEL_REQUEST_TYPE:
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		break;
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	if (NULL != _client_tcp_port->subscriptions) {
-	    remove_subscription_client(_client_tcp_port, buffer_number);
-	}
-	_client_tcp_port->socket_fd = -1;
-	delete _client_tcp_port;
-	client_ports->delete_current_node();
+	_client_tcp_port->closing = 1;
 	break;
 
     case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
 	server->get_keys_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->get_keys_req.name, 16, 0, -1, NULL) < 0) {
+	if (take_request(_client_tcp_port,
+		server->get_keys_req.name, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
@@ -1408,7 +1621,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    server->gen_random_key(((char *) temp_buffer) + 4, 2);
 	    server->gen_random_key(((char *) temp_buffer) + 12, 2);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1417,20 +1630,18 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    memcpy(((char *) temp_buffer) + 12, server->get_keys_reply->key2,
 		8);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	}
 	break;
 
     case REMOTE_CMS_LOGIN_REQUEST_TYPE:
 	server->login_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.name, 16, 0, -1, NULL) < 0) {
+	if (take_request(_client_tcp_port, server->login_req.name, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.passwd, 16, 0, -1, NULL) < 0) {
+	if (take_request(_client_tcp_port, server->login_req.passwd, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
@@ -1441,13 +1652,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, server->login_reply->success);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	break;
@@ -1465,14 +1676,16 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	} else {
 	    if (server->set_subscription_reply->success) {
 		if (server->set_subscription_req.subscription_type ==
 		    CMS_POLLED_SUBSCRIPTION
 		    || server->set_subscription_req.subscription_type ==
-		    CMS_VARIABLE_SUBSCRIPTION) {
+		    CMS_VARIABLE_SUBSCRIPTION
+		    || server->set_subscription_req.subscription_type ==
+		    CMS_DELTA_SUBSCRIPTION) {
 		    add_subscription_client(buffer_number,
 			server->set_subscription_req.
 			subscription_type,
@@ -1489,7 +1702,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    *((uint32_t *) temp_buffer + 1) =
 		htonl(server->set_subscription_reply->success);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    queue_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	break;
@@ -1607,8 +1820,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
 	while (temp_clnt_info != NULL) {
 	    if (temp_clnt_info->poll_interval_millis <
 		min_poll_interval_millis
-		&& temp_clnt_info->subscription_type ==
-		CMS_POLLED_SUBSCRIPTION) {
+		&& (temp_clnt_info->subscription_type ==
+		    CMS_POLLED_SUBSCRIPTION
+		    || temp_clnt_info->subscription_type ==
+		    CMS_DELTA_SUBSCRIPTION)) {
 		min_poll_interval_millis =
 		    temp_clnt_info->poll_interval_millis;
 		polling_enabled = 1;
@@ -1624,8 +1839,6 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
     } else {
 	current_poll_interval_millis = ((int) (clk_tck() * 1000.0));
     }
-    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-    select_timeout.tv_usec = (current_poll_interval_millis % 1000) * 1000;
     dtimeout = (current_poll_interval_millis + 10) * 1000.0;
     if (dtimeout < 0.5) {
 	dtimeout = 0.5;
@@ -1668,11 +1881,6 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 		subscription_buffers->get_next();
 	    continue;
 	}
-	putbe32(temp_buffer, 0);
-	putbe32(temp_buffer + 4, server->read_reply->status);
-	putbe32(temp_buffer + 8, server->read_reply->size);
-	putbe32(temp_buffer + 12, server->read_reply->write_id);
-	putbe32(temp_buffer + 16, server->read_reply->was_read);
 	TCP_CLIENT_SUBSCRIPTION_INFO *temp_clnt_info =
 	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
 	    get_head();
@@ -1686,37 +1894,23 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 			&& time_diff_millis + 10 >=
 			temp_clnt_info->poll_interval_millis)
 		    || temp_clnt_info->subscription_type ==
-		    CMS_VARIABLE_SUBSCRIPTION)
+		    CMS_VARIABLE_SUBSCRIPTION
+		    || temp_clnt_info->subscription_type ==
+		    CMS_DELTA_SUBSCRIPTION)
 		&& temp_clnt_info->last_id_read !=
 		server->read_reply->write_id) {
 		temp_clnt_info->last_id_read = server->read_reply->write_id;
 		temp_clnt_info->last_sub_sent_time = cur_time;
 		temp_clnt_info->clnt_port->serial_number++;
-		putbe32(temp_buffer, temp_clnt_info->clnt_port->serial_number);
-		if (server->read_reply->size < 0x2000 - 20
-		    && server->read_reply->size > 0) {
-		    memcpy(temp_buffer + 20, server->read_reply->data,
-			server->read_reply->size);
-		    if (sendn
-			(temp_clnt_info->clnt_port->socket_fd, temp_buffer,
-			    20 + server->read_reply->size, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		} else {
-		    if (sendn(temp_clnt_info->clnt_port->socket_fd,
-			    temp_buffer, 20, 0, dtimeout) < 0) {
+		if (temp_clnt_info->subscription_type ==
+		    CMS_DELTA_SUBSCRIPTION) {
+		    if (queue_delta_reply(temp_clnt_info,
+			    server->read_reply) < 0) {
 			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		    if (server->read_reply->size > 0) {
-			if (sendn(temp_clnt_info->clnt_port->socket_fd,
-				server->read_reply->data,
-				server->read_reply->size, 0, dtimeout) < 0) {
-			    temp_clnt_info->clnt_port->errors++;
-			    return;
-			}
 		    }
+		} else if (queue_read_reply(temp_clnt_info->clnt_port,
+			server->read_reply) < 0) {
+		    temp_clnt_info->clnt_port->errors++;
 		}
 	    }
 	    if (temp_clnt_info->last_id_read < buf_info->min_last_id) {
@@ -1760,10 +1954,17 @@ TCP_CLIENT_SUBSCRIPTION_INFO::TCP_CLIENT_SUBSCRIPTION_INFO()
     last_id_read = 0;
     sub_buf_info = NULL;
     clnt_port = NULL;
+    last_data = NULL;
+    last_size = 0;
+    last_data_max = 0;
 }
 
 TCP_CLIENT_SUBSCRIPTION_INFO::~TCP_CLIENT_SUBSCRIPTION_INFO()
 {
+    if (NULL != last_data) {
+	free(last_data);
+	last_data = NULL;
+    }
     subscription_type = CMS_NO_SUBSCRIPTION;
     poll_interval_millis = 30000;
     last_sub_sent_time = 0.0;
@@ -1787,8 +1988,21 @@ CLIENT_TCP_PORT::CLIENT_TCP_PORT()
     subscriptions = NULL;
     tid = -1;
     pid = -1;
+    list_id = -1;
+    closing = 0;
+    blocking = 0;
+    blocking_list_id = -1;
+    blocking_deadline = -1.0;
     blocking_read_req = NULL;
-    threadId = 0;
+    write_queue = NULL;
+    write_queue_size = 0;
+    write_queue_start = 0;
+    write_queue_end = 0;
+    read_buffer = NULL;
+    read_buffer_size = 0;
+    read_buffer_start = 0;
+    read_buffer_end = 0;
+    epoll_events = 0;
     diag_info = NULL;
 }
 
@@ -1809,12 +2023,18 @@ CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
 	delete subscriptions;
 	subscriptions = NULL;
     }
-#ifdef NO_THREADS
     if (NULL != blocking_read_req) {
 	delete blocking_read_req;
 	blocking_read_req = NULL;
     }
-#endif
+    if (NULL != write_queue) {
+	free(write_queue);
+	write_queue = NULL;
+    }
+    if (NULL != read_buffer) {
+	free(read_buffer);
+	read_buffer = NULL;
+    }
     if (NULL != diag_info) {
 	delete diag_info;
 	diag_info = NULL;
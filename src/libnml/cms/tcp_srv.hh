@@ -33,16 +33,24 @@ extern "C" {
 }
 #endif
 
-#ifndef NO_THREADS
-#define NO_THREADS
-
-#ifdef POSIX_THREADS
-#include <pthread.h>
-#endif
-#endif
-
 #define MAX_TCP_BUFFER_SIZE 16
+
+/* events taken from epoll_wait() at a time */
+#define TCPSVR_MAX_EVENTS 64
+/* how often buffers are checked for clients waiting in a blocking read.
+   A write that comes in through this server wakes the clients waiting on
+   that buffer at once, but one made by a local process goes straight to
+   shared memory and is only seen here on the next check, so such clients
+   get their data up to this much later. */
+#define TCPSVR_BLOCKING_READ_POLL_MILLIS 10
+/* initial size of a client's read buffer; it grows to the largest request
+   the client sends */
+#define TCPSVR_READ_BUFFER_SIZE 0x2000
+/* replies queued for a client which does not read them before it is
+   dropped */
+#define TCPSVR_MAX_WRITE_QUEUE (16 * 1024 * 1024)
 class CLIENT_TCP_PORT;
+class TCP_CLIENT_SUBSCRIPTION_INFO;
 
 class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
   public:
@@ -54,10 +62,10 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     void unregister_port();
     double dtimeout;
   protected:
-      fd_set read_fd_set, write_fd_set;
-    void handle_request(CLIENT_TCP_PORT *);
-    int maxfdpl;
+    void handle_request(CLIENT_TCP_PORT *, CMS_SERVER *);
+    int epoll_fd;
     LinkedList *client_ports;
+    LinkedList *blocking_ports;	/* clients waiting in a blocking read */
     LinkedList *subscription_buffers;
     int connection_socket;
     long connection_port;
@@ -66,7 +74,26 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     char temp_buffer[0x2000];
     int current_poll_interval_millis;
     int polling_enabled;
-    struct timeval select_timeout;
+    void accept_client();
+    void close_client(CLIENT_TCP_PORT * clnt);
+    void watch_client(CLIENT_TCP_PORT * clnt);
+    int queue_reply(CLIENT_TCP_PORT * clnt, const char *data, long size);
+    int queue_read_reply(CLIENT_TCP_PORT * clnt, REMOTE_READ_REPLY * reply);
+    int queue_delta_reply(TCP_CLIENT_SUBSCRIPTION_INFO * sub_info,
+	REMOTE_READ_REPLY * reply);
+    char *delta_buffer;
+    long delta_buffer_size;
+    void flush_replies(CLIENT_TCP_PORT * clnt);
+    int receive_requests(CLIENT_TCP_PORT * clnt);
+    int reserve_request_space(CLIENT_TCP_PORT * clnt, long size);
+    long request_length(CLIENT_TCP_PORT * clnt, CMS_SERVER * server);
+    int take_request(CLIENT_TCP_PORT * clnt, char *data, long size);
+    void handle_requests(CLIENT_TCP_PORT * clnt);
+    void start_blocking_read(CLIENT_TCP_PORT * clnt, CMS_SERVER * server);
+    int poll_blocking_read(CLIENT_TCP_PORT * clnt, CMS_SERVER * server);
+    void cancel_blocking_read(CLIENT_TCP_PORT * clnt);
+    void check_blocking_reads(long buffer_number = -1);
+    void remove_all_subscriptions(CLIENT_TCP_PORT * clnt);
     void update_subscriptions();
     void add_subscription_client(int buffer_number, int subscription_type,
 	int poll_interval_millis, CLIENT_TCP_PORT * clnt);
@@ -102,6 +129,10 @@ class TCP_CLIENT_SUBSCRIPTION_INFO {
     int last_id_read;
     TCP_BUFFER_SUBSCRIPTION_INFO *sub_buf_info;
     CLIENT_TCP_PORT *clnt_port;
+    /* last message sent to a CMS_DELTA_SUBSCRIPTION client */
+    char *last_data;
+    long last_size;
+    long last_data_max;
 };
 
 class TCPSVR_BLOCKING_READ_REQUEST;
@@ -117,13 +148,23 @@ class CLIENT_TCP_PORT {
     LinkedList *subscriptions;
     pid_t tid;
     pid_t pid;
-    int blocking;
-#ifdef POSIX_THREADS
-    pthread_t threadId;
-#else
-    int threadId;
-#endif
+    int list_id;		/* node in client_ports */
+    int closing;		/* close once the current request is done */
+    int blocking;		/* waiting in blocking_read_req */
+    int blocking_list_id;	/* node in blocking_ports */
+    double blocking_deadline;	/* etime() to give up at, < 0 for never */
     TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
+    /* replies the socket would not take yet, sent on EPOLLOUT */
+    char *write_queue;
+    long write_queue_size;
+    long write_queue_start;
+    long write_queue_end;
+    /* requests received so far, handled once all of one is here */
+    char *read_buffer;
+    long read_buffer_size;
+    long read_buffer_start;
+    long read_buffer_end;
+    unsigned int epoll_events;	/* events registered for socket_fd */
     REMOTE_SET_DIAG_INFO_REQUEST *diag_info;
 
 };
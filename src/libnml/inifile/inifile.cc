@@ -18,6 +18,10 @@
 #include <string.h>             /* strstr() */
 #include <ctype.h>              /* isspace() */
 #include <fcntl.h>
+#include <sys/stat.h>           /* fstat() */
+#include <map>
+#include <vector>
+#include <unordered_map>
 
 
 #include "config.h"
@@ -45,6 +49,218 @@ static bool check_line_endings(const char *s) {
     return false;
 }
 
+/* Everything Find() needs from a file, read in one pass. */
+struct IniFile::Index {
+    struct Entry {
+        std::string             value;
+        bool                    hasValue;       /* false if nothing after = */
+        unsigned int            lineNo;         /* last line of the entry */
+    };
+    typedef std::unordered_map<std::string, std::vector<Entry> > Tags;
+    struct Section {
+        Tags                    tags;
+        unsigned int            endLineNo;      /* next section, or EOF */
+    };
+    typedef std::unordered_map<std::string, Section> Sections;
+
+    Tags                        all;            /* for section == NULL */
+    Sections                    sections;       /* first [name] of each */
+    unsigned int                lineCount;
+    unsigned int                errorLineNo;    /* first bad line, or 0 */
+    ErrorCode                   errorCode;
+
+    Index() : lineCount(0), errorLineNo(0), errorCode(ERR_NONE) {}
+    void                        Read(FILE *fp);
+    void                        Add(Tags *tags, const char *line,
+                                    unsigned int lineNo);
+    void                        SetError(ErrorCode code, unsigned int lineNo);
+};
+
+void
+IniFile::Index::SetError(ErrorCode code, unsigned int lineNo)
+{
+    if(!errorLineNo) {
+        errorLineNo = lineNo;
+        errorCode = code;
+    }
+}
+
+/* A tag matches a line when the line starts with it and it is followed by
+   white space or '=', so a line is filed under every such prefix. */
+void
+IniFile::Index::Add(Tags *tags, const char *line, unsigned int lineNo)
+{
+    const char *end;
+    Entry entry;
+
+    entry.lineNo = lineNo;
+    entry.value.clear();
+    entry.hasValue = false;
+    const char *valueString = AfterEqual(line);
+    if(valueString) {
+        const char *endValueString = valueString + strlen(valueString);
+        while (endValueString > valueString &&
+               (endValueString[-1] == ' ' || endValueString[-1] == '\t'
+                || endValueString[-1] == '\r')) {
+            endValueString--;
+        }
+        entry.value.assign(valueString, endValueString - valueString);
+        entry.hasValue = true;
+    }
+
+    for(end = line; *end; end++) {
+        if(*end != ' ' && *end != '\t' && *end != '\r' && *end != '\n'
+           && *end != '=')
+            continue;
+        if(end > line && end[-1] != ' ' && end[-1] != '\t'
+           && end[-1] != '\r' && end[-1] != '\n') {
+            std::string tag(line, end - line);
+            all[tag].push_back(entry);
+            if(tags)
+                (*tags)[tag].push_back(entry);
+        }
+        if(*end == '=')
+            break;
+    }
+}
+
+void
+IniFile::Index::Read(FILE *fp)
+{
+    char *line = NULL;
+    size_t lineSize = 0;
+    ssize_t len;
+    std::string eline;
+    int extend_ct = 0;
+    Section *current = NULL;
+
+    rewind(fp);
+    while((len = getline(&line, &lineSize, fp)) >= 0) {
+        lineCount++;
+
+        if(check_line_endings(line))
+            SetError(ERR_CONVERSION, lineCount);
+
+        /* strip off newline */
+        if(len > 0 && line[len - 1] == '\n')
+            line[--len] = 0;
+
+        // honor backslash (\) as line-end escape
+        if(len > 0 && line[len - 1] == '\\') {
+            eline.append(line, len - 1);
+            extend_ct++;
+            if(extend_ct > MAX_EXTEND_LINES) {
+                fprintf(stderr,
+                   "INIFILE lineno=%d:Too many backslash line extends (limit=%d)\n",
+                   lineCount, MAX_EXTEND_LINES);
+                SetError(ERR_OVER_EXTENDED, lineCount);
+                eline.clear();
+                extend_ct = 0;
+            }
+            continue; // get next line to extend
+        }
+        const char *full = line;
+        if(extend_ct) {
+            eline.append(line, len);
+            full = eline.c_str();
+        }
+
+        const char *nonWhite = SkipWhite(full);
+        if(nonWhite == NULL) {
+            /* blank line or comment-- skip */
+        } else if(nonWhite[0] == '[') {
+            if(current)
+                current->endLineNo = lineCount;
+            current = NULL;
+            const char *close = strchr(nonWhite, ']');
+            if(close) {
+                std::string name(nonWhite + 1, close - nonWhite - 1);
+                if(sections.find(name) == sections.end()) {
+                    current = &sections[name];
+                    current->endLineNo = 0;
+                }
+            }
+        } else {
+            Add(current ? &current->tags : NULL, nonWhite, lineCount);
+        }
+        eline.clear();
+        extend_ct = 0;
+    }
+    if(current)
+        current->endLineNo = lineCount;
+    free(line);
+}
+
+/* Parsed files, shared between IniFile instances. A file that has been
+   changed gets parsed again. Like the rest of this class it is not
+   thread safe. */
+struct IniFile::CacheKey {
+    dev_t                       dev;
+    ino_t                       ino;
+    off_t                       size;
+    time_t                      mtime;
+    long                        mtime_nsec;
+
+    bool operator<(const CacheKey &o) const {
+        if(dev != o.dev) return dev < o.dev;
+        if(ino != o.ino) return ino < o.ino;
+        if(size != o.size) return size < o.size;
+        if(mtime != o.mtime) return mtime < o.mtime;
+        return mtime_nsec < o.mtime_nsec;
+    }
+};
+
+std::shared_ptr<IniFile::Index> IniFile::lastFound;
+
+IniFile::Cache &
+IniFile::IndexCache(void)
+{
+    static Cache                cache;
+    return cache;
+}
+
+void
+IniFile::ClearCache(void)
+{
+    IndexCache().clear();
+}
+
+/*! Reads the open file into index, or reuses the copy read by an earlier
+   IniFile. Files other than regular ones, such as pipes, have nothing to
+   key the cache on and are read for this IniFile only.
+
+   @return true on success, false on failure */
+bool
+IniFile::LoadIndex(void)
+{
+    struct stat st;
+    CacheKey key;
+
+    if(fp == NULL)
+        return(false);
+
+    if(fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode)) {
+        index = std::make_shared<Index>();
+        index->Read(fp);
+        return(true);
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.size = st.st_size;
+    key.mtime = st.st_mtim.tv_sec;
+    key.mtime_nsec = st.st_mtim.tv_nsec;
+
+    std::shared_ptr<Index> &cached = IndexCache()[key];
+    if(!cached) {
+        cached = std::make_shared<Index>();
+        cached->Read(fp);
+    }
+    index = cached;
+    return(true);
+}
+
 IniFile::IniFile(int _errMask, FILE *_fp)
 {
     fp = _fp;
@@ -77,7 +293,8 @@ IniFile::Open(const char *file)
     if(!LockFile())
         return(false);
 
-    return(true);
+    /* Parse the whole file now; every Find() after this is a lookup. */
+    return(LoadIndex());
 }
 
 
@@ -98,6 +315,7 @@ IniFile::Close()
 
         fp = NULL;
     }
+    index.reset();
 
     return(rVal == 0);
 }
@@ -191,22 +409,6 @@ IniFile::Find(double *result, StrDoublePair *pPair,
 const char *
 IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
 {
-    // WTF, return a pointer to the middle of a local buffer?
-    // FIX: this is totally non-reentrant.
-    static char                 line[LINELEN + 2] = "";        /* 1 for newline, 1 for NULL */
-    char                        bracketSection[LINELEN + 2] = "";
-    char                        *nonWhite;
-    int                         newLinePos;                /* position of newline to strip */
-    int                         len;
-    char                        tagEnd;
-    char                        *valueString;
-    char                        *endValueString;
-
-    char  eline [(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
-    char* elineptr;
-    char* elinenext;
-    int   extend_ct = 0;
-
     // For exceptions.
     lineNo = 0;
     tag = _tag;
@@ -217,165 +419,57 @@ IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
     if(!CheckIfOpen())
         return(NULL);
 
-    /* start from beginning */
-    rewind(fp);
+    if(!index && !LoadIndex()) {
+        ThrowException(ERR_NOT_OPEN);
+        return(NULL);
+    }
 
-    /* check for section first-- if it's non-NULL, then position file at
-       line after [section] */
+    /* without a section every line in the file is searched, otherwise
+       only those between the first [section] and the next section */
+    const Index::Tags *tags = &index->all;
+    unsigned int scanEnd = index->lineCount;
     if(section != NULL){
-        sprintf(bracketSection, "[%s]", section);
-
-        /* find [section], and position fp just after it */
-        while (!feof(fp)) {
-
-            if (NULL == fgets(line, LINELEN + 1, fp)) {
-                /* got to end of file without finding it */
-                ThrowException(ERR_SECTION_NOT_FOUND);
+        Index::Sections::const_iterator s = index->sections.find(section);
+        if(s == index->sections.end()) {
+            lineNo = scanEnd;
+            if(index->errorLineNo) {
+                ThrowException(index->errorCode);
                 return(NULL);
             }
-
-            if(check_line_endings(line)) {
-                ThrowException(ERR_CONVERSION);
-                return(NULL);
-            }
-
-            /* got a line */
-            lineNo++;
-
-            /* strip off newline */
-            newLinePos = strlen(line) - 1;        /* newline is on back from 0 */
-            if (newLinePos < 0) {
-                newLinePos = 0;
-            }
-            if (line[newLinePos] == '\n') {
-                line[newLinePos] = 0;        /* make the newline 0 */
-            }
-
-            if (NULL == (nonWhite = SkipWhite(line))) {
-                /* blank line-- skip */
-                continue;
-            }
-
-            /* not a blank line, and nonwhite is first char */
-            if (strncmp(bracketSection, nonWhite, strlen(bracketSection)) != 0){
-                /* not on this line */
-                continue;
-            }
-
-            /* it matches-- fp is now set up for search on tag */
-            break;
-        }
-    }
-
-    while (!feof(fp)) {
-        /* check for end of file */
-        if (NULL == fgets(line, LINELEN + 1, (FILE *) fp)) {
-            /* got to end of file without finding it */
-            ThrowException(ERR_TAG_NOT_FOUND);
-            return(NULL);
-        }
-
-        if(check_line_endings(line)) {
-            ThrowException(ERR_CONVERSION);
-            return(NULL);
-        }
-
-        /* got a line */
-        lineNo++;
-
-        /* strip off newline */
-        newLinePos = strlen(line) - 1;        /* newline is on back from 0 */
-        if (newLinePos < 0) {
-            newLinePos = 0;
-        }
-        if (line[newLinePos] == '\n') {
-            line[newLinePos] = 0;        /* make the newline 0 */
-        }
-        // honor backslash (\) as line-end escape
-        if (newLinePos > 0 && line[newLinePos-1] == '\\') {
-           newLinePos = newLinePos-1;
-           line[newLinePos] = 0;
-           if (!extend_ct) {
-               elineptr = (char*)eline; //first time
-               strncpy(elineptr,line,newLinePos);
-               elinenext = elineptr + newLinePos;
-           } else {
-               strncpy(elinenext,line,newLinePos);
-               elinenext = elinenext + newLinePos;
-           }
-           *elinenext = 0;
-           extend_ct++;
-           if (extend_ct > MAX_EXTEND_LINES) {
-              fprintf(stderr,
-                 "INIFILE lineno=%d:Too many backslash line extends (limit=%d)\n",
-                 lineNo, MAX_EXTEND_LINES);
-              ThrowException(ERR_OVER_EXTENDED);
-              return(NULL);
-           }
-           continue; // get next line to extend
-        } else {
-            if (extend_ct) {
-               strncpy(elinenext,line,newLinePos);
-               elinenext = elinenext + newLinePos;
-               *elinenext = 0;
-            }
-        }
-        if (!extend_ct) {
-           elineptr = (char*)line;
-        }
-        extend_ct = 0;
-
-        /* skip leading whitespace */
-        if (NULL == (nonWhite = SkipWhite(elineptr))) {
-            /* blank line-- skip */
-            continue;
-        }
-
-        /* check for '[' char-- if so, it's a section tag, and we're out
-           of our section */
-        if (NULL != section && nonWhite[0] == '[') {
-            ThrowException(ERR_TAG_NOT_FOUND);
+            ThrowException(ERR_SECTION_NOT_FOUND);
             return(NULL);
         }
+        tags = &s->second.tags;
+        scanEnd = s->second.endLineNo;
+    }
 
-        len = strlen(tag);
-        if (strncmp(tag, nonWhite, len) != 0) {
-            /* not on this line */
-            continue;
-        }
+    const Index::Entry *entry = NULL;
+    Index::Tags::const_iterator t = tags->find(tag);
+    size_t n = _num > 1 ? _num - 1 : 0;
+    if(t != tags->end() && n < t->second.size()) {
+        entry = &t->second[n];
+        scanEnd = entry->lineNo;
+    }
 
-        /* it matches the first part of the string-- if whitespace or = is
-           next char then call it a match */
-        tagEnd = nonWhite[len];
-        if (tagEnd == ' ' || tagEnd == '\r' || tagEnd == '\t'
-            || tagEnd == '\n' || tagEnd == '=') {
-            /* it matches-- return string after =, or NULL */
-            if (--_num > 0) {
-                /* Not looking for this one, so skip it... */
-                continue;
-            }
-            nonWhite += len;
-            valueString = AfterEqual(nonWhite);
-            /* Eliminate white space at the end of a line also. */
-            if (NULL == valueString) {
-                ThrowException(ERR_TAG_NOT_FOUND);
-                return(NULL);
-            }
-            endValueString = valueString + strlen(valueString) - 1;
-            while (*endValueString == ' ' || *endValueString == '\t'
-                   || *endValueString == '\r') {
-                *endValueString = 0;
-                endValueString--;
-            }
-	    if (lineno)
-		*lineno = lineNo;
-            return(valueString);
-        }
-        /* else continue */
+    /* report a bad line in the part of the file that a top to bottom
+       search would have gone through */
+    lineNo = scanEnd;
+    if(index->errorLineNo && index->errorLineNo <= scanEnd) {
+        lineNo = index->errorLineNo;
+        ThrowException(index->errorCode);
+        return(NULL);
     }
 
-    ThrowException(ERR_TAG_NOT_FOUND);
-    return(NULL);
+    if(entry == NULL || !entry->hasValue) {
+        ThrowException(ERR_TAG_NOT_FOUND);
+        return(NULL);
+    }
+    if (lineno)
+        *lineno = lineNo;
+    /* the iniFind() wrappers close their IniFile before the caller gets
+       to read the value */
+    lastFound = index;
+    return(entry->value.c_str());
 }
 
 const char *
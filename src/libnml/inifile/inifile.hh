@@ -18,6 +18,8 @@
 
 #include <inifile.h>
 #include <string>
+#include <map>
+#include <memory>
 #include <boost/lexical_cast.hpp>
 
 #ifndef __cplusplus
@@ -123,6 +125,15 @@ public:
     ErrorCode                   TildeExpansion(const char *file, char *path,
 					       size_t n);
 
+    // Files are parsed once and the result shared by every IniFile that
+    // opens the same, unchanged file. This drops all of it, e.g. for a
+    // caller that edits the file in place without changing its mtime.
+    // The strings Find() returned point into these results: they stay
+    // valid while an IniFile has the file open, and until the next
+    // Find() as with the old static buffer, but no longer than that
+    // once the cache is cleared.
+    static void                 ClearCache(void);
+
 protected:
     struct StrIntPair {
         const char             *pStr;
@@ -144,9 +155,14 @@ protected:
 
 
 private:
+    struct Index;
+    struct CacheKey;
+    typedef std::map<CacheKey, std::shared_ptr<Index> > Cache;
+
     FILE                        *fp;
     struct flock                lock;
     bool                        owned;
+    std::shared_ptr<Index>      index;
 
     Exception                   exception;
     int                         errMask;
@@ -158,9 +174,12 @@ private:
 
     bool                        CheckIfOpen(void);
     bool                        LockFile(void);
+    bool                        LoadIndex(void);
+    static Cache &              IndexCache(void);
+    static std::shared_ptr<Index> lastFound;  // holds the last Find() result
     void                        ThrowException(ErrorCode);
-    char                        *AfterEqual(const char *string);
-    char                        *SkipWhite(const char *string);
+    static char                 *AfterEqual(const char *string);
+    static char                 *SkipWhite(const char *string);
 };
 #endif
 
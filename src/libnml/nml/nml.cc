@@ -1275,6 +1275,57 @@ NMLTYPE NML::read(void *temp_data, long temp_size)
     return return_value;
 }
 
+/***********************************************************
+* NML Member Function: view_begin()
+* Purpose: Like peek() but returns a pointer to the message where it
+* sits in the buffer rather than copying it to get_address().
+* Returns:
+*  NULL if there is no new message, the buffer can not be viewed or an
+*  error occurred; check view->data and error_type to tell them apart.
+*  o.w. the message, which must be cast to the type of its type field.
+* Notes:
+*   1. The message can change while it is being looked at. Whatever was
+* copied out of it can only be used if view_end() then returns 1.
+*   2. Only raw SHMEM buffers support this; for others cms->status is
+* CMS_NO_IMPLEMENTATION_ERROR and peek() should be used instead.
+***********************************************************/
+const NMLmsg *NML::view_begin(CMS_VIEW * view)
+{
+    error_type = NML_NO_ERROR;
+    view->data = NULL;
+    if (NULL == cms) {
+	if (error_type != NML_INVALID_CONFIGURATION) {
+	    error_type = NML_INVALID_CONFIGURATION;
+	    rcs_print_error("NML::view_begin: CMS not configured.\n");
+	}
+	return (NULL);
+    }
+    if (cms->is_phantom || cms->neutral) {
+	cms->status = CMS_NO_IMPLEMENTATION_ERROR;
+	return (NULL);
+    }
+    switch (cms->view_begin(view)) {
+    case CMS_READ_OK:
+	return ((const NMLmsg *) view->data);
+    case CMS_READ_OLD:
+    case CMS_NO_IMPLEMENTATION_ERROR:
+	return (NULL);
+    default:
+	set_error();
+	return (NULL);
+    }
+}
+
+/* Returns 1 if the message from view_begin() was not overwritten while
+ it was being looked at. */
+int NML::view_end(CMS_VIEW * view)
+{
+    if (NULL == cms || NULL == view->data) {
+	return 0;
+    }
+    return cms->view_end(view);
+}
+
 /* Same as the peek with no arguments except that the data is
  stored in a user supplied location . */
 NMLTYPE NML::peek(void *temp_data, long temp_size)
@@ -1484,6 +1535,9 @@ int NML::format_output()
 		    }
 		    return (-1);
 		}
+		if (-1 == cms->check_decoded_msg()) {
+		    return (-1);
+		}
 	    }
 	}
 	break;
@@ -1927,6 +1981,9 @@ int NML::format_input(NMLmsg * nml_msg)
 		    cms->BufferName, cms->ProcessName);
 		return (-1);
 	    }
+	    if (-1 == cms->check_decoded_msg()) {
+		return (-1);
+	    }
 	}
 	/* Choose a size that will ensure the entire message will be read
 	   out. */
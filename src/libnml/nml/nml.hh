@@ -32,6 +32,7 @@ class LinkedList;
 
 class NMLmsg;			/* Use only partial definition to avoid */
 				/* depending on nmlmsg.hh. */
+struct CMS_VIEW;		/* cms.hh */
 
 /* Typedef for pointer to the function used to decode a message */
  /* by its id number. */
@@ -97,6 +98,9 @@ class NML:public virtual CMS_USER {
     NMLTYPE peek();		/* Read buffer without changing was_read */
     NMLTYPE read(void *, long);
     NMLTYPE peek(void *, long);
+    const NMLmsg *view_begin(CMS_VIEW * view);	/* Look at the message in
+						   place, see nml.cc */
+    int view_end(CMS_VIEW * view);
     int write(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write a message. (Use reference) */
     int write(NMLmsg * nml_msg, int *serial_number = NULL);	/* Write a message. (Use pointer) */
     int write_if_read(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write only if buffer
@@ -907,6 +907,16 @@ int rtapi_task_pause(int task_id)
     return 0;
 }
 
+void rtapi_task_parallel(void (*fn) (void *, int), void *arg, int count)
+{
+    int n;
+
+    /* no worker threads in kernel space, run them in order */
+    for (n = 0; n < count; n++) {
+	fn(arg, n);
+    }
+}
+
 int rtapi_task_self(void)
 {
     RT_TASK *ptr;
@@ -1717,6 +1727,7 @@ EXPORT_SYMBOL(rtapi_wait);
 EXPORT_SYMBOL(rtapi_task_resume);
 EXPORT_SYMBOL(rtapi_task_pause);
 EXPORT_SYMBOL(rtapi_task_self);
+EXPORT_SYMBOL(rtapi_task_parallel);
 EXPORT_SYMBOL(rtapi_shmem_new);
 EXPORT_SYMBOL(rtapi_shmem_delete);
 EXPORT_SYMBOL(rtapi_shmem_getptr);
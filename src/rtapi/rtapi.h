@@ -419,6 +419,17 @@ RTAPI_BEGIN_DECLS
 */
     extern int rtapi_task_self(void);
 
+/** 'rtapi_task_parallel()' calls 'fn(arg, n)' for each 'n' from 0 to
+    'count'-1 and returns when all of the calls have returned.  If the
+    RTAPI implementation has worker threads available, the calls may
+    run at the same time on several CPUs, otherwise they run one after
+    the other in the calling task.  The calls must therefore not depend
+    on each other's results or order.  Call only from within a realtime
+    task.
+*/
+    extern void rtapi_task_parallel(void (*fn) (void *, int), void *arg,
+	int count);
+
 #if defined(RTAPI_USPACE) || defined(USPACE)
 
 #define RTAPI_TASK_PLL_SUPPORT
@@ -16,6 +16,9 @@
 #ifndef RTAPI_ATOMIC_H
 #define RTAPI_ATOMIC_H
 
+// <stdatomic.h> is C only, so C++ users get just the rtapi_ names below
+#ifndef __cplusplus
+
 #if defined(__GNUC__) && ((__GNUC__ << 8) | __GNUC_MINOR__) >= 0x409
 #define RTAPI_USE_STDATOMIC
 #elif defined(__STDC_VERSION__) && __STDC_VERSION > 201112L
@@ -47,4 +50,12 @@ enum memory_order {
 
 #endif
 
+#endif /* __cplusplus */
+
+// Acquire/release access to a plain integer shared with another thread,
+// for code that is also built as C++
+#define rtapi_atomic_load_acquire(obj) __atomic_load_n((obj), __ATOMIC_ACQUIRE)
+#define rtapi_atomic_store_release(obj, desired) \
+    __atomic_store_n((obj), (desired), __ATOMIC_RELEASE)
+
 #endif
@@ -95,6 +95,9 @@ struct RtapiApp
     virtual int run_threads(int fd, int (*callback)(int fd)) = 0;
     virtual long long do_get_time(void) = 0;
     virtual void do_delay(long ns) = 0;
+    virtual void run_parallel(void (*fn)(void *, int), void *arg, int count) {
+        for(int i = 0; i < count; i++) fn(arg, i);
+    }
     int policy;
     long period;
 };
@@ -38,6 +38,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <errno.h>
 #ifdef HAVE_SYS_IO_H
 #include <sys/io.h>
@@ -47,6 +48,8 @@
 #ifdef __linux__
 #include <malloc.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #endif
 #ifdef __FreeBSD__
 #include <pthread_np.h>
@@ -444,7 +447,10 @@ static int master(int fd, vector<string> args) {
         perror("pthread_create (queue function)");
         return -1;
     }
-    do_load_cmd("hal_lib", vector<string>()); instance_count = 0;
+    vector<string> hal_lib_args;
+    if(const char *hal_size = getenv("HAL_SIZE"))
+        hal_lib_args.push_back(string("hal_size=") + hal_size);
+    do_load_cmd("hal_lib", hal_lib_args); instance_count = 0;
     App(); // force rtapi_app to be created
     int result=0;
     if(args.size()) {
@@ -596,6 +602,160 @@ struct PosixTask : rtapi_task
     pthread_t thr;                /* thread's context */
 };
 
+/* Worker threads for rtapi_task_parallel().  They are only started when
+   RTAPI_WORKER_CPUS lists the CPUs to pin them to (e.g. "1,2"), since a
+   worker is only useful to a realtime thread if it has a CPU to itself.
+
+   A batch of calls is published through 'ticket', which packs the
+   batch number, the number of calls and the next call to hand out.
+   Calls are claimed with a compare-and-swap on the whole ticket, so a
+   worker that is late for one batch can never claim a call of the
+   next.  The calling task claims calls as well, then spins until
+   'remaining' reaches zero.  Idle workers spin for RTAPI_WORKER_SPIN
+   pause instructions (default 100, a few microseconds) and then sleep
+   on the 'wake' futex.  While running a call, a worker carries the
+   calling task in the rtapi task key, so rtapi_task_self() and friends
+   answer for that task. */
+struct WorkerPool
+{
+    WorkerPool() : ticket(0), remaining(0), wake(0), sleepers(0),
+        busy(false), fn(nullptr), arg(nullptr), task(nullptr), spin(100) {}
+
+    void start(const char *cpus, int prio, pthread_key_t key);
+    bool run(void (*fn)(void *, int), void *arg, int count, void *task);
+
+private:
+    static const int MAX_COUNT = 0xffff;
+    static void *worker(void *arg);
+    void claim_and_run();
+    static void relax() {
+#if defined(__i386) || defined(__amd64)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    std::atomic<unsigned long long> ticket;
+    std::atomic<int> remaining;
+    std::atomic<int> wake;
+    std::atomic<int> sleepers;
+    std::atomic<bool> busy;
+    void (*fn)(void *, int);
+    void *arg;
+    void *task;
+    int spin;
+    pthread_key_t key;
+    std::vector<pthread_t> workers;
+};
+
+void WorkerPool::claim_and_run() {
+    unsigned long long t = ticket.load(std::memory_order_acquire);
+    while(true) {
+        unsigned count = (t >> 16) & MAX_COUNT, n = t & MAX_COUNT;
+        if(n >= count) return;
+        if(!ticket.compare_exchange_weak(t, t + 1,
+                std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+        // 'remaining' can't reach zero before this call is done, so
+        // fn, arg and task still belong to the batch that was claimed from
+        pthread_setspecific(key, task);
+        fn(arg, n);
+        remaining.fetch_sub(1, std::memory_order_release);
+        t = ticket.load(std::memory_order_acquire);
+    }
+}
+
+void *WorkerPool::worker(void *arg) {
+    WorkerPool *pool = reinterpret_cast<WorkerPool*>(arg);
+    int seen = pool->wake.load();
+    while(true) {
+        int spin = 0, w;
+        while((w = pool->wake.load(std::memory_order_acquire)) == seen) {
+            if(++spin < pool->spin) { relax(); continue; }
+            pool->sleepers++;
+#ifdef __linux__
+            if(pool->wake.load() == seen)
+                syscall(SYS_futex, &pool->wake, FUTEX_WAIT_PRIVATE, seen,
+                        nullptr, nullptr, 0);
+#else
+            if(pool->wake.load() == seen) sched_yield();
+#endif
+            pool->sleepers--;
+            spin = 0;
+        }
+        seen = w;
+        pool->claim_and_run();
+    }
+    return nullptr;
+}
+
+void WorkerPool::start(const char *cpus, int prio, pthread_key_t key_) {
+    key = key_;
+    if(getenv("RTAPI_WORKER_SPIN"))
+        spin = atoi(getenv("RTAPI_WORKER_SPIN"));
+    string list(cpus);
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == string::npos) end = list.size();
+        int cpu = atoi(list.substr(pos, end - pos).c_str());
+        pos = end + 1;
+
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = prio;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+#ifdef __FreeBSD__
+        cpuset_t cpuset;
+#else
+        cpu_set_t cpuset;
+#endif
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+        pthread_t thr;
+        int res = pthread_create(&thr, &attr, &worker, this);
+        pthread_attr_destroy(&attr);
+        if(res != 0) {
+            rtapi_print_msg(RTAPI_MSG_ERR,
+                "rtapi_app: could not start worker thread on CPU %d: %s\n",
+                cpu, strerror(res));
+            continue;
+        }
+        workers.push_back(thr);
+        rtapi_print_msg(RTAPI_MSG_INFO,
+            "rtapi_app: started worker thread on CPU %d\n", cpu);
+    }
+}
+
+bool WorkerPool::run(void (*fn_)(void *, int), void *arg_, int count,
+        void *task_) {
+    if(workers.empty() || count < 2 || count > MAX_COUNT) return false;
+    // another realtime thread preempted one that is using the pool
+    if(busy.exchange(true, std::memory_order_acquire)) return false;
+    unsigned long long batch =
+        (ticket.load(std::memory_order_relaxed) >> 32) + 1;
+    fn = fn_;
+    arg = arg_;
+    task = task_;
+    remaining.store(count, std::memory_order_relaxed);
+    ticket.store((batch << 32) | ((unsigned long long)count << 16),
+        std::memory_order_release);
+    wake++;
+#ifdef __linux__
+    if(sleepers.load())
+        syscall(SYS_futex, &wake, FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+#endif
+    claim_and_run();
+    while(remaining.load(std::memory_order_acquire)) relax();
+    busy.store(false, std::memory_order_release);
+    return true;
+}
+
 struct Posix : RtapiApp
 {
     Posix(int policy = SCHED_FIFO) : RtapiApp(policy), do_thread_lock(policy != SCHED_FIFO) {
@@ -617,9 +777,15 @@ struct Posix : RtapiApp
     unsigned char do_inb(unsigned int port);
     void do_outb(unsigned char value, unsigned int port);
     int run_threads(int fd, int (*callback)(int fd));
+    void run_parallel(void (*fn)(void *, int), void *arg, int count) {
+        if(!pool.run(fn, arg, count, pthread_getspecific(key)))
+            RtapiApp::run_parallel(fn, arg, count);
+    }
     static void *wrapper(void *arg);
     bool do_thread_lock;
     pthread_mutex_t thread_lock;
+    WorkerPool pool;
+    bool pool_started = false;
 
     static pthread_once_t key_once;
     static pthread_key_t key;
@@ -991,6 +1157,14 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
 
   int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
 
+  // workers only make sense for truly realtime threads; without
+  // SCHED_FIFO the threads are serialized by thread_lock anyway
+  if(!pool_started && !do_thread_lock && nprocs > 1) {
+      pool_started = true;
+      if(getenv("RTAPI_WORKER_CPUS"))
+          pool.start(getenv("RTAPI_WORKER_CPUS"), prio_highest(), key);
+  }
+
   pthread_attr_t attr;
   if(pthread_attr_init(&attr) < 0)
       return -errno;
@@ -1194,6 +1368,11 @@ int rtapi_task_self()
     return App().task_self();
 }
 
+void rtapi_task_parallel(void (*fn)(void *, int), void *arg, int count)
+{
+    App().run_parallel(fn, arg, count);
+}
+
 long long rtapi_task_pll_get_reference(void)
 {
     return App().task_pll_get_reference();
@@ -0,0 +1,87 @@
+#!/usr/bin/python
+# Parse a program once through the GLCanon callbacks and once into a
+# native gcode.preview, and check that both give the same geometry
+import tempfile
+import gcode
+import sys
+from rs274.glcanon import GLCanon
+
+class Canon(GLCanon):
+    def __init__(self):
+        GLCanon.__init__(self, {'dwell': 'dwell', 'm1xx': 'm1xx'}, 'XYZ')
+
+    def set_traverse_rate(self, rate): pass
+    def get_external_length_units(self): return 1.0
+    def get_external_angular_units(self): return 1.0
+    def get_axis_mask(self): return 7 # (x y z)
+    def get_block_delete(self): return False
+    def get_tool(self, pocket):
+        return -1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0
+
+def parse(canon):
+    canon.parameter_file = parameter.name
+    result, seq = gcode.parse(sys.argv[1], canon, '', '', '')
+    if result > gcode.MIN_ERROR: raise SystemExit, gcode.strerror(result)
+
+def close(a, b):
+    a = list(a); b = list(b)
+    return len(a) == len(b) and all(abs(x - y) < 1e-9 for x, y in zip(a, b))
+
+def same_segment(c, n):
+    if len(c) == 4: # traverse, no feed rate
+        lineno, start, end, tlo = c
+        feedrate = n[3]
+    else:
+        lineno, start, end, feedrate, tlo = c
+    return (lineno == n[0] and close(start, n[1]) and close(end, n[2])
+        and abs(feedrate - n[3]) < 1e-9 and close(tlo, n[4]))
+
+def same_dwell(c, n):
+    lineno, color, x, y, z, plane = c
+    return lineno == n[0] and close((x, y, z), n[1]) and plane == n[2]
+
+def compare(name, callback, native, same):
+    native = [native[i] for i in range(len(native))]
+    if len(callback) != len(native):
+        print name, "differ: %d callback, %d native" % (len(callback), len(native))
+        return
+    for i, (c, n) in enumerate(zip(callback, native)):
+        if not same(c, n):
+            print name, "differ at", i, c, n
+            return
+    print name, "same", len(callback) > 0
+
+parameter = tempfile.NamedTemporaryFile()
+
+callback = Canon()
+parse(callback)
+
+native = Canon()
+# small chunks, so segments are built by the workers in several pieces
+native.preview = gcode.preview()
+native.preview.chunk_size = 7
+native.preview.threads = 2
+parse(native)
+
+compare("traverse", callback.traverse, native.preview.traverse, same_segment)
+compare("feed", callback.feed, native.preview.feed, same_segment)
+compare("arcfeed", callback.arcfeed, native.preview.arcfeed, same_segment)
+compare("dwells", callback.dwells, native.preview.dwells, same_dwell)
+
+# every line is recorded, even though lines only reach the preview with
+# the chunk they belong to
+seqs = [native.preview.lines[i].sequence_number
+    for i in range(len(native.preview.lines))]
+print "lines", len(seqs) > 0 and seqs == sorted(set(seqs))
+
+# each view keeps its own shape, and nothing may be appended while one is held
+views = [memoryview(native.preview.feed), memoryview(native.preview.dwells)]
+print "shapes", views[0].shape == (len(native.preview.feed),), \
+    views[1].shape == (len(native.preview.dwells),)
+try:
+    parse(native)
+except BufferError:
+    print "held BufferError"
+del views
+parse(native)
+compare("reparsed feed", callback.feed, native.preview.feed, same_segment)
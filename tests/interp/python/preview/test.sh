@@ -0,0 +1,2 @@
+#!/bin/sh
+python preview.py test.ngc
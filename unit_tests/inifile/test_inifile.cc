@@ -0,0 +1,271 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <inifile.hh>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// The indexed IniFile::Find() against the top to bottom scan it replaced,
+// over every INI file under configs/.
+
+struct ScanResult {
+    bool found;
+    std::string value;
+    int lineno;
+};
+
+static const char *scan_skip_white(const char *s)
+{
+    for(; *s; s++) {
+        if(*s == ';' || *s == '#')
+            return NULL;
+        if(*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n')
+            return s;
+    }
+    return NULL;
+}
+
+static const char *scan_after_equal(const char *s)
+{
+    s = strchr(s, '=');
+    if(!s)
+        return NULL;
+    for(s++; *s; s++) {
+        if(*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n')
+            return s;
+    }
+    return NULL;
+}
+
+static bool scan_bad_line_endings(const std::string &line)
+{
+    for(const char *cr = strchr(line.c_str(), '\r'); cr;
+        cr = strchr(cr + 1, '\r')) {
+        if(cr[1] != '\0')
+            return true;
+    }
+    return false;
+}
+
+// the search the old Find() did on every call
+static ScanResult scan_find(const std::vector<std::string> &lines,
+                            const char *tag, const char *section, int num)
+{
+    ScanResult none = { false, "", 0 };
+    size_t i = 0;
+    int lineNo = 0;
+
+    if(section) {
+        std::string bracketSection = std::string("[") + section + "]";
+        for(;; i++) {
+            if(i == lines.size())
+                return none;
+            if(scan_bad_line_endings(lines[i]))
+                return none;
+            lineNo++;
+            const char *nonWhite = scan_skip_white(lines[i].c_str());
+            if(nonWhite && !strncmp(bracketSection.c_str(), nonWhite,
+                                    bracketSection.size())) {
+                i++;
+                break;
+            }
+        }
+    }
+
+    std::string eline;
+    int extend_ct = 0;
+    for(; i < lines.size(); i++) {
+        const std::string &line = lines[i];
+        if(scan_bad_line_endings(line))
+            return none;
+        lineNo++;
+        if(!line.empty() && line[line.size() - 1] == '\\') {
+            if(!extend_ct)
+                eline.clear();
+            eline.append(line, 0, line.size() - 1);
+            if(++extend_ct > 20)
+                return none;
+            continue;
+        }
+        const char *full = line.c_str();
+        if(extend_ct) {
+            eline += line;
+            full = eline.c_str();
+            extend_ct = 0;
+        }
+
+        const char *nonWhite = scan_skip_white(full);
+        if(!nonWhite)
+            continue;
+        if(section && nonWhite[0] == '[')
+            return none;
+        size_t len = strlen(tag);
+        if(strncmp(tag, nonWhite, len))
+            continue;
+        char tagEnd = nonWhite[len];
+        if(tagEnd != ' ' && tagEnd != '\r' && tagEnd != '\t'
+           && tagEnd != '\n' && tagEnd != '=')
+            continue;
+        if(--num > 0)
+            continue;
+        const char *value = scan_after_equal(nonWhite + len);
+        if(!value)
+            return none;
+        std::string v(value);
+        while(!v.empty() && (v[v.size() - 1] == ' ' || v[v.size() - 1] == '\t'
+                             || v[v.size() - 1] == '\r'))
+            v.erase(v.size() - 1);
+        ScanResult found = { true, v, lineNo };
+        return found;
+    }
+    return none;
+}
+
+static void find_ini_files(const std::string &dir,
+                           std::vector<std::string> *files)
+{
+    DIR *d = opendir(dir.c_str());
+    if(!d)
+        return;
+    while(struct dirent *e = readdir(d)) {
+        if(e->d_name[0] == '.')
+            continue;
+        std::string path = dir + "/" + e->d_name;
+        struct stat st;
+        if(stat(path.c_str(), &st))
+            continue;
+        if(S_ISDIR(st.st_mode))
+            find_ini_files(path, files);
+        else if(path.size() > 4 && !path.compare(path.size() - 4, 4, ".ini"))
+            files->push_back(path);
+    }
+    closedir(d);
+}
+
+static std::vector<std::string> read_lines(const std::string &path)
+{
+    std::vector<std::string> lines;
+    FILE *fp = fopen(path.c_str(), "r");
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    while(fp && (len = getline(&line, &size, fp)) >= 0) {
+        if(len > 0 && line[len - 1] == '\n')
+            len--;
+        lines.push_back(std::string(line, len));
+    }
+    free(line);
+    if(fp)
+        fclose(fp);
+    return lines;
+}
+
+struct Query {
+    std::string tag;
+    std::string section;    // empty for none
+};
+
+// every tag in the file, looked up in its own section, the next one, a
+// missing one and without a section, and the same for a tag that is a
+// prefix of it and one that is not there
+static std::vector<Query> collect_queries(const std::vector<std::string> &lines)
+{
+    std::vector<std::string> sections;
+    std::vector<std::pair<std::string, size_t> > tags;
+
+    sections.push_back("");
+    for(size_t i = 0; i < lines.size(); i++) {
+        const char *nonWhite = scan_skip_white(lines[i].c_str());
+        if(!nonWhite)
+            continue;
+        if(nonWhite[0] == '[') {
+            const char *close = strchr(nonWhite, ']');
+            if(close)
+                sections.push_back(std::string(nonWhite + 1, close));
+            continue;
+        }
+        size_t n = strcspn(nonWhite, " \t\r=");
+        size_t in = sections.size() - 1;
+        tags.push_back(std::make_pair(std::string(nonWhite, n), in));
+        if(n > 1)
+            tags.push_back(std::make_pair(std::string(nonWhite, n - 1), in));
+    }
+    tags.push_back(std::make_pair(std::string("NO_SUCH_TAG"), sections.size() - 1));
+    sections.push_back("NO_SUCH_SECTION");
+
+    std::vector<Query> queries;
+    for(size_t t = 0; t < tags.size(); t++) {
+        size_t in = tags[t].second;
+        Query q;
+        q.tag = tags[t].first;
+        q.section = "";
+        queries.push_back(q);
+        q.section = sections[in];
+        queries.push_back(q);
+        q.section = sections[in + 1];
+        queries.push_back(q);
+        q.section = "NO_SUCH_SECTION";
+        queries.push_back(q);
+    }
+    return queries;
+}
+
+TEST_CASE("indexed Find matches a scan of every config")
+{
+    std::vector<std::string> files;
+    find_ini_files(CONFIGS_DIR, &files);
+    REQUIRE(files.size() > 100);
+
+    for(size_t f = 0; f < files.size(); f++) {
+        std::vector<std::string> lines = read_lines(files[f]);
+        std::vector<Query> queries = collect_queries(lines);
+
+        IniFile ini;
+        REQUIRE(ini.Open(files[f].c_str()));
+        for(size_t i = 0; i < queries.size(); i++) {
+            const char *tag = queries[i].tag.c_str();
+            const char *section = queries[i].section.empty() ?
+                NULL : queries[i].section.c_str();
+            for(int num = 1; num <= 3; num++) {
+                ScanResult expected = scan_find(lines, tag, section, num);
+                int lineno = 0;
+                const char *value = ini.Find(tag, section, num, &lineno);
+                if((value != NULL) == expected.found &&
+                   (!value || (value == expected.value &&
+                               lineno == expected.lineno)))
+                    continue;
+                INFO(files[f] << " [" << (section ? section : "(none)")
+                     << "]" << tag << " #" << num);
+                CHECK((value != NULL) == expected.found);
+                if(value && expected.found) {
+                    CHECK(value == expected.value);
+                    CHECK(lineno == expected.lineno);
+                }
+            }
+        }
+        ini.Close();
+    }
+}
+
+TEST_CASE("values from a pipe outlive the IniFile until the next Find")
+{
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    const char text[] = "[EMC]\nMACHINE = pipe\nDEBUG = 0\n";
+    REQUIRE(write(fds[1], text, sizeof(text) - 1) == (ssize_t)(sizeof(text) - 1));
+    close(fds[1]);
+    FILE *fp = fdopen(fds[0], "r");
+    REQUIRE(fp != NULL);
+
+    const char *machine = iniFind(fp, "MACHINE", "EMC");
+    REQUIRE(machine != NULL);
+    IniFile::ClearCache();
+    CHECK(std::string(machine) == "pipe");
+    fclose(fp);
+}
@@ -63,10 +63,92 @@ TEST pmCartCartAntiParallel_numerical() {
     PASS();
 }
 
+TEST findSCurveVPeak_trapezoidal() {
+    // Without a jerk limit this is the constant-acceleration result
+    ASSERT_IN_RANGE(sqrt(4.0 + 2.0 * 100.0 * 0.5),
+            findSCurveVPeak(100.0, 0.0, 2.0, 0.5), 1e-12);
+    ASSERT_EQ(2.0, findSCurveVPeak(100.0, 1000.0, 2.0, 0.0));
+
+    // and a very high one approaches it
+    ASSERT_IN_RANGE(sqrt(2.0 * 100.0 * 10.0),
+            findSCurveVPeak(100.0, 1e9, 0.0, 10.0), 1e-3);
+    PASS();
+}
+
+TEST findSCurveVPeak_stopDistance() {
+    const double a_max = 100.0, j_max = 1000.0;
+    const double v_finals[] = {0.0, 1.0, 10.0};
+    // Short distances never reach a_max, long ones have a constant phase
+    const double distances[] = {1e-4, 0.01, 0.2, 1.0, 50.0};
+    unsigned int i, k;
+
+    for (i = 0; i < sizeof(v_finals) / sizeof(v_finals[0]); ++i) {
+        for (k = 0; k < sizeof(distances) / sizeof(distances[0]); ++k) {
+            double v = findSCurveVPeak(a_max, j_max, v_finals[i], distances[k]);
+            ASSERT(v > v_finals[i]);
+            // Slowing from the peak takes exactly the given distance
+            ASSERT_IN_RANGE(distances[k],
+                    findSCurveStopDistance(v, 0.0, v_finals[i], a_max, j_max),
+                    1e-9 * (1.0 + distances[k]));
+            // and is slower than the trapezoidal profile allows
+            ASSERT(v < findSCurveVPeak(a_max, 0.0, v_finals[i], distances[k]));
+        }
+    }
+    PASS();
+}
+
+TEST findSCurveStopDistance_state() {
+    const double a_max = 100.0, j_max = 1000.0;
+
+    // Nothing to do at the final velocity
+    ASSERT_EQ(0.0, findSCurveStopDistance(5.0, 0.0, 5.0, a_max, j_max));
+
+    // Already braking takes less room than starting from zero acceleration,
+    // and accelerating takes more
+    double d0 = findSCurveStopDistance(5.0, 0.0, 0.0, a_max, j_max);
+    ASSERT(findSCurveStopDistance(5.0, -50.0, 0.0, a_max, j_max) < d0);
+    ASSERT(findSCurveStopDistance(5.0, 50.0, 0.0, a_max, j_max) > d0);
+
+    // Ramping a = -sqrt(2 j v) back to zero ends exactly at rest, after
+    // a^3 / (6 j^2)
+    double a = -sqrt(2.0 * j_max * 0.5);
+    ASSERT_IN_RANGE(-a * a * a / (6.0 * j_max * j_max),
+            findSCurveStopDistance(0.5, a, 0.0, a_max, j_max), 1e-12);
+    PASS();
+}
+
+TEST findSCurveAccelGoal_steps() {
+    const double j_max = 1000.0, dt = 0.001;
+    const double dvs[] = {1e-5, 0.001, 0.0035, 0.1, 4.3};
+    unsigned int i;
+
+    for (i = 0; i < sizeof(dvs) / sizeof(dvs[0]); ++i) {
+        // Following the goal each cycle reaches dv exactly, stepping the
+        // acceleration down by at most j_max * dt, and ends at zero
+        double v = 0.0, acc = findSCurveAccelGoal(dvs[i], j_max, dt);
+        int n;
+        for (n = 0; n < 1000 && acc > 0.0; ++n) {
+            v += acc * dt;
+            double next = findSCurveAccelGoal(dvs[i] - v, j_max, dt);
+            ASSERT(acc - next <= j_max * dt * (1.0 + 1e-9));
+            acc = next;
+        }
+        ASSERT_IN_RANGE(dvs[i], v, 1e-12);
+        ASSERT(acc <= j_max * dt);
+    }
+    ASSERT_EQ(0.0, findSCurveAccelGoal(0.0, j_max, dt));
+    ASSERT_IN_RANGE(0.5 / dt, findSCurveAccelGoal(0.5, 0.0, dt), 1e-9);
+    PASS();
+}
+
 
  SUITE(blendmath) {
      RUN_TEST(pmCartCartParallel_numerical);
      RUN_TEST(pmCartCartAntiParallel_numerical);
+     RUN_TEST(findSCurveVPeak_trapezoidal);
+     RUN_TEST(findSCurveVPeak_stopDistance);
+     RUN_TEST(findSCurveStopDistance_state);
+     RUN_TEST(findSCurveAccelGoal_steps);
 
  }
 
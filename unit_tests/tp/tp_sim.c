@@ -0,0 +1,559 @@
+/********************************************************************
+* Description: tp_sim.c
+*   Offline trajectory planner simulation and benchmark.
+*
+*   Replays the canonical move stream printed by the standalone
+*   interpreter (rs274 -g file.ngc) through the real trajectory planner
+*   at a fixed servo period, as fast as the planner can run.  Reports the
+*   machining time, peak axis velocity / acceleration and path jerk,
+*   constraint violations, and the time spent in each tpRunCycle call,
+*   so planner changes and [TRAJ] tuning can be compared without a
+*   machine.
+*
+*   Positions are taken in the program's units, and the axis limits
+*   given on the command line are in the same units.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2020 All rights reserved.
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "emcpose.h"
+#include "tp.h"
+#include "tcq.h"
+#include "tc.h"
+#include "motion.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+
+/* The planner reaches the rest of motion through these */
+emcmot_status_t *emcmotStatus;
+emcmot_config_t *emcmotConfig;
+emcmot_debug_t *emcmotDebug;
+
+static emcmot_status_t sim_status;
+static emcmot_config_t sim_config;
+static emcmot_debug_t sim_debug;
+
+void rtapi_print_msg(msg_level_t level, const char *fmt, ...)
+{
+    va_list args;
+
+    if (level > RTAPI_MSG_ERR) {
+        return;
+    }
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void emcmotDioWrite(int index, char value) {}
+void emcmotAioWrite(int index, double value) {}
+void emcmotSetRotaryUnlock(int axis, int unlock) {}
+int emcmotGetRotaryIsUnlocked(int axis) { return 1; }
+
+typedef struct {
+    double period;          /* servo period, seconds */
+    double vel[3];          /* XYZ axis velocity limits */
+    double acc[3];          /* XYZ axis acceleration limits */
+    double vlimit;          /* [TRAJ]MAX_LINEAR_VELOCITY */
+    double margin;          /* fraction a limit may be exceeded by before it counts */
+    const char *trace;      /* per-cycle trace output, or NULL */
+} sim_options_t;
+
+typedef struct {
+    long cycles;
+    int segments;
+    double run_ns;          /* total time spent in tpRunCycle */
+    double max_ns;
+    double max_vel[3];
+    double max_acc[3];
+    double max_speed;       /* XYZ path speed */
+    double max_jerk;        /* XYZ path jerk magnitude */
+    long vel_violations;
+    long acc_violations;
+    long jerk_violations;   /* path jerk over [TRAJ]MAX_LINEAR_JERK, if set */
+} sim_stats_t;
+
+static sim_options_t opt = {
+    0.001,
+    {10.0, 10.0, 10.0},
+    {100.0, 100.0, 100.0},
+    0.0,
+    0.01,
+    NULL,
+};
+
+static sim_stats_t stats;
+static TP_STRUCT tp;
+static FILE *trace;
+
+/* interpreter state tracked from the canon stream */
+static EmcPose prog_pos;
+static double feed_rate;    /* units per second */
+static enum { PLANE_XY, PLANE_YZ, PLANE_XZ } plane = PLANE_XY;
+static int next_id = 1;
+
+/* kinematic state from the last two cycles, for finite differences */
+static PmCartesian last_pos, last_vel, last_acc;
+static int history;
+
+static double elapsed_ns(struct timespec const *a, struct timespec const *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+static void sample(void)
+{
+    EmcPose pose;
+    PmCartesian pos, vel, acc, jerk;
+    double dt = opt.period;
+    double v[3], a[3];
+    int i;
+
+    tpGetPos(&tp, &pose);
+    emcPoseGetXYZ(&pose, &pos);
+
+    if (history > 0) {
+        pmCartCartSub(&pos, &last_pos, &vel);
+        pmCartScalMultEq(&vel, 1.0 / dt);
+    } else {
+        vel = last_vel;
+    }
+    if (history > 1) {
+        pmCartCartSub(&vel, &last_vel, &acc);
+        pmCartScalMultEq(&acc, 1.0 / dt);
+    } else {
+        acc = last_acc;
+    }
+    pmCartCartSub(&acc, &last_acc, &jerk);
+    pmCartScalMultEq(&jerk, 1.0 / dt);
+
+    v[0] = vel.x; v[1] = vel.y; v[2] = vel.z;
+    a[0] = acc.x; a[1] = acc.y; a[2] = acc.z;
+    for (i = 0; i < 3; ++i) {
+        stats.max_vel[i] = fmax(stats.max_vel[i], fabs(v[i]));
+        if (fabs(v[i]) > opt.vel[i] * (1.0 + opt.margin)) {
+            stats.vel_violations++;
+        }
+        if (history > 1) {
+            stats.max_acc[i] = fmax(stats.max_acc[i], fabs(a[i]));
+            if (fabs(a[i]) > opt.acc[i] * (1.0 + opt.margin)) {
+                stats.acc_violations++;
+            }
+        }
+    }
+
+    double speed, acc_mag, jerk_mag = 0.0;
+    pmCartMag(&vel, &speed);
+    pmCartMag(&acc, &acc_mag);
+    if (history > 2) {
+        pmCartMag(&jerk, &jerk_mag);
+        stats.max_jerk = fmax(stats.max_jerk, jerk_mag);
+        if (emcmotConfig->maxJerk > 0.0 &&
+                jerk_mag > emcmotConfig->maxJerk * (1.0 + opt.margin)) {
+            stats.jerk_violations++;
+        }
+    }
+    stats.max_speed = fmax(stats.max_speed, speed);
+
+    if (trace) {
+        fprintf(trace, "%.6f %.6f %.6f %.6f %.6f %.6f %.6f\n",
+                stats.cycles * dt, pos.x, pos.y, pos.z,
+                speed, acc_mag, jerk_mag);
+    }
+
+    last_pos = pos;
+    last_vel = vel;
+    last_acc = acc;
+    if (history < 3) {
+        history++;
+    }
+}
+
+static void run_cycle(void)
+{
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    tpRunCycle(&tp, (long)(opt.period * 1e9));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double ns = elapsed_ns(&t0, &t1);
+    stats.run_ns += ns;
+    stats.max_ns = fmax(stats.max_ns, ns);
+    stats.cycles++;
+    sample();
+}
+
+/* Run until the queue has room for another segment */
+static void run_until_not_full(void)
+{
+    while (tcqFull(&tp.queue)) {
+        run_cycle();
+    }
+}
+
+/* Run until every queued segment has finished */
+static int run_until_done(void)
+{
+    EmcPose pos;
+    long stalled = 0;
+
+    while (!tpIsDone(&tp)) {
+        EmcPose before;
+        tpGetPos(&tp, &before);
+        run_cycle();
+        tpGetPos(&tp, &pos);
+        if (!memcmp(&pos, &before, sizeof(pos))) {
+            if (++stalled > (long)(10.0 / opt.period)) {
+                fprintf(stderr, "tp_sim: planner stalled for 10 s with %d segments queued\n",
+                        tpQueueDepth(&tp));
+                return -1;
+            }
+        } else {
+            stalled = 0;
+        }
+    }
+    return 0;
+}
+
+/* Limits for a straight move, the same way canon derives them from the axes */
+static void straight_limits(EmcPose const *end, double *vel, double *acc)
+{
+    double d[3] = {
+        end->tran.x - prog_pos.tran.x,
+        end->tran.y - prog_pos.tran.y,
+        end->tran.z - prog_pos.tran.z,
+    };
+    double len = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    double tv = 0.0, ta = 0.0;
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+        tv = fmax(tv, fabs(d[i]) / opt.vel[i]);
+        ta = fmax(ta, fabs(d[i]) / opt.acc[i]);
+    }
+    *vel = tv > 0.0 ? len / tv : 0.0;
+    *acc = ta > 0.0 ? len / ta : 0.0;
+}
+
+static void add_line(EmcPose end, int motion_type)
+{
+    double vel, acc;
+
+    straight_limits(&end, &vel, &acc);
+    double req = motion_type == EMC_MOTION_TYPE_TRAVERSE ? vel : fmin(vel, feed_rate);
+
+    run_until_not_full();
+    tpSetId(&tp, next_id++);
+    int res = tpAddLine(&tp, end, motion_type, req, vel, acc, FS_ENABLED, 0, -1);
+    if (res < 0) {
+        fprintf(stderr, "tp_sim: can't add line %d, error code %d\n", next_id - 1, res);
+    } else if (res == 0) {
+        stats.segments++;
+    }
+    prog_pos = end;
+}
+
+static void add_arc(double first_end, double second_end,
+        double first_axis, double second_axis, int rotation,
+        double axis_end, EmcPose end)
+{
+    PmCartesian center, normal;
+    int a1, a2;
+
+    switch (plane) {
+    case PLANE_YZ:
+        end.tran.y = first_end; end.tran.z = second_end; end.tran.x = axis_end;
+        center.y = first_axis; center.z = second_axis; center.x = axis_end;
+        normal.x = 1.0; normal.y = 0.0; normal.z = 0.0;
+        a1 = 1; a2 = 2;
+        break;
+    case PLANE_XZ:
+        end.tran.z = first_end; end.tran.x = second_end; end.tran.y = axis_end;
+        center.z = first_axis; center.x = second_axis; center.y = axis_end;
+        normal.x = 0.0; normal.y = 1.0; normal.z = 0.0;
+        a1 = 2; a2 = 0;
+        break;
+    default:
+        end.tran.x = first_end; end.tran.y = second_end; end.tran.z = axis_end;
+        center.x = first_axis; center.y = second_axis; center.z = axis_end;
+        normal.x = 0.0; normal.y = 0.0; normal.z = 1.0;
+        a1 = 0; a2 = 1;
+        break;
+    }
+
+    // In-plane limits from the slower of the two planar axes, like canon
+    double line_vel, line_acc;
+    straight_limits(&end, &line_vel, &line_acc);
+    double vel = fmin(opt.vel[a1], opt.vel[a2]);
+    double acc = fmin(opt.acc[a1], opt.acc[a2]);
+    if (line_vel > 0.0) {
+        vel = fmin(vel, line_vel);
+        acc = fmin(acc, line_acc);
+    }
+    int turn = rotation > 0 ? rotation - 1 : rotation;
+
+    run_until_not_full();
+    tpSetId(&tp, next_id++);
+    int res = tpAddCircle(&tp, end, center, normal, turn, EMC_MOTION_TYPE_ARC,
+            fmin(vel, feed_rate), vel, acc, FS_ENABLED, 0);
+    if (res < 0) {
+        fprintf(stderr, "tp_sim: can't add arc %d, error code %d\n", next_id - 1, res);
+    } else if (res == 0) {
+        stats.segments++;
+    }
+    prog_pos = end;
+}
+
+/* Parse up to max comma separated numbers following the '(' at args */
+static int parse_args(char const *args, double *v, int max)
+{
+    int n = 0;
+    char *end;
+
+    while (n < max) {
+        args++;
+        v[n] = strtod(args, &end);
+        if (end == args) {
+            break;
+        }
+        n++;
+        args = end;
+        while (*args == ' ') {
+            args++;
+        }
+        if (*args != ',') {
+            break;
+        }
+    }
+    return n;
+}
+
+/* Handle one line of rs274 output, e.g.
+ *    12 N..... STRAIGHT_FEED(1.0000, 2.0000, 0.0000, 0.0000, 0.0000, 0.0000)
+ */
+static int handle_line(char *line)
+{
+    double v[9];
+    char *args = strchr(line, '(');
+    char *name;
+
+    if (!args) {
+        return 0;
+    }
+    *args = '\0';
+    name = strrchr(line, ' ');
+    name = name ? name + 1 : line;
+    *args = '(';
+
+    EmcPose end = prog_pos;
+
+    if (!strncmp(name, "STRAIGHT_FEED(", 14) || !strncmp(name, "STRAIGHT_TRAVERSE(", 18)) {
+        if (parse_args(args, v, 6) < 3) {
+            return -1;
+        }
+        end.tran.x = v[0]; end.tran.y = v[1]; end.tran.z = v[2];
+        end.a = v[3]; end.b = v[4]; end.c = v[5];
+        add_line(end, name[9] == 'F' ? EMC_MOTION_TYPE_FEED : EMC_MOTION_TYPE_TRAVERSE);
+    } else if (!strncmp(name, "ARC_FEED(", 9)) {
+        if (parse_args(args, v, 9) < 6) {
+            return -1;
+        }
+        end.a = v[6]; end.b = v[7]; end.c = v[8];
+        add_arc(v[0], v[1], v[2], v[3], (int)v[4], v[5], end);
+    } else if (!strncmp(name, "SET_FEED_RATE(", 14)) {
+        if (parse_args(args, v, 1) < 1) {
+            return -1;
+        }
+        feed_rate = v[0] / 60.0;
+    } else if (!strncmp(name, "SELECT_PLANE(", 13)) {
+        if (strstr(args, "CANON_PLANE_YZ")) {
+            plane = PLANE_YZ;
+        } else if (strstr(args, "CANON_PLANE_XZ")) {
+            plane = PLANE_XZ;
+        } else {
+            plane = PLANE_XY;
+        }
+    } else if (!strncmp(name, "SET_MOTION_CONTROL_MODE(", 24)) {
+        char *comma = strchr(args, ',');
+        if (strstr(args, "CANON_EXACT_STOP")) {
+            tpSetTermCond(&tp, TC_TERM_COND_STOP, 0.0);
+        } else if (strstr(args, "CANON_EXACT_PATH")) {
+            tpSetTermCond(&tp, TC_TERM_COND_EXACT, 0.0);
+        } else if (strstr(args, "CANON_CONTINUOUS")) {
+            tpSetTermCond(&tp, TC_TERM_COND_PARABOLIC, comma ? strtod(comma + 1, NULL) : 0.0);
+        }
+    } else if (!strncmp(name, "DWELL(", 6)) {
+        if (parse_args(args, v, 1) < 1) {
+            return -1;
+        }
+        if (run_until_done()) {
+            return -1;
+        }
+        long n = (long)ceil(v[0] / opt.period);
+        while (n-- > 0) {
+            run_cycle();
+        }
+    }
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: tp_sim [options] [canon-file]\n"
+            "Replays rs274 -g output (stdin by default) through the trajectory planner.\n"
+            "  -t period   servo period in seconds (0.001)\n"
+            "  -v vel      X, Y and Z axis velocity limit, units/s (10)\n"
+            "  -a acc      X, Y and Z axis acceleration limit, units/s^2 (100)\n"
+            "  -l vel      [TRAJ]MAX_LINEAR_VELOCITY (axis velocity limit)\n"
+            "  -j jerk     [TRAJ]MAX_LINEAR_JERK, 0 for trapezoidal (0)\n"
+            "  -d depth    [TRAJ]ARC_BLEND_OPTIMIZATION_DEPTH (50)\n"
+            "  -g cycles   [TRAJ]ARC_BLEND_GAP_CYCLES (4)\n"
+            "  -r freq     [TRAJ]ARC_BLEND_RAMP_FREQ (100)\n"
+            "  -k ratio    [TRAJ]ARC_BLEND_KINK_RATIO (0.1)\n"
+            "  -b          disable arc blending ([TRAJ]ARC_BLEND_ENABLE = 0)\n"
+            "  -f scale    feed override (1.0)\n"
+            "  -q size     queue size (%d)\n"
+            "  -m margin   fraction a limit may be exceeded before it is reported (0.01)\n"
+            "  -o file     write a trace of t, x, y, z, speed, acceleration and jerk\n"
+            "Exits with status 1 if any axis limit, or the jerk limit given with -j,\n"
+            "was exceeded.\n",
+            DEFAULT_TC_QUEUE_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+    int queue_size = DEFAULT_TC_QUEUE_SIZE;
+    double feed_scale = 1.0;
+    int c, i;
+
+    emcmotStatus = &sim_status;
+    emcmotConfig = &sim_config;
+    emcmotDebug = &sim_debug;
+
+    emcmotConfig->arcBlendEnable = 1;
+    emcmotConfig->arcBlendFallbackEnable = 0;
+    emcmotConfig->arcBlendOptDepth = 50;
+    emcmotConfig->arcBlendGapCycles = 4;
+    emcmotConfig->arcBlendRampFreq = 100.0;
+    emcmotConfig->arcBlendTangentKinkRatio = 0.1;
+    emcmotConfig->maxJerk = 0.0;
+    emcmotConfig->numSpindles = 1;
+
+    while ((c = getopt(argc, argv, "t:v:a:l:j:d:g:r:k:bf:q:m:o:h")) != -1) {
+        switch (c) {
+        case 't': opt.period = atof(optarg); break;
+        case 'v': opt.vel[0] = opt.vel[1] = opt.vel[2] = atof(optarg); break;
+        case 'a': opt.acc[0] = opt.acc[1] = opt.acc[2] = atof(optarg); break;
+        case 'l': opt.vlimit = atof(optarg); break;
+        case 'j': emcmotConfig->maxJerk = atof(optarg); break;
+        case 'd': emcmotConfig->arcBlendOptDepth = atoi(optarg); break;
+        case 'g': emcmotConfig->arcBlendGapCycles = atoi(optarg); break;
+        case 'r': emcmotConfig->arcBlendRampFreq = atof(optarg); break;
+        case 'k': emcmotConfig->arcBlendTangentKinkRatio = atof(optarg); break;
+        case 'b': emcmotConfig->arcBlendEnable = 0; break;
+        case 'f': feed_scale = atof(optarg); break;
+        case 'q': queue_size = atoi(optarg); break;
+        case 'm': opt.margin = atof(optarg); break;
+        case 'o': opt.trace = optarg; break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (opt.period <= 0.0 || opt.vel[0] <= 0.0 || opt.acc[0] <= 0.0 || queue_size < 2) {
+        usage();
+        return 2;
+    }
+    if (opt.vlimit <= 0.0) {
+        opt.vlimit = opt.vel[0];
+    }
+
+    FILE *in = stdin;
+    if (optind < argc && strcmp(argv[optind], "-")) {
+        in = fopen(argv[optind], "r");
+        if (!in) {
+            perror(argv[optind]);
+            return 2;
+        }
+    }
+    if (opt.trace) {
+        trace = fopen(opt.trace, "w");
+        if (!trace) {
+            perror(opt.trace);
+            return 2;
+        }
+    }
+
+    emcmotConfig->maxFeedScale = fmax(feed_scale, 1.0);
+    emcmotStatus->net_feed_scale = feed_scale;
+    emcmotStatus->enables_new = FS_ENABLED;
+    for (i = 0; i < 3; ++i) {
+        emcmotDebug->axes[i].vel_limit = opt.vel[i];
+        emcmotDebug->axes[i].acc_limit = opt.acc[i];
+    }
+
+    TC_STRUCT *tc_space = calloc(queue_size + 10, sizeof(TC_STRUCT));
+    syncdio_t *syncdio_space = calloc(queue_size, sizeof(syncdio_t));
+    if (!tc_space || !syncdio_space ||
+            tpCreate(&tp, queue_size, tc_space, syncdio_space) != 0) {
+        fprintf(stderr, "tp_sim: failed to create the trajectory planner\n");
+        return 2;
+    }
+    tpSetCycleTime(&tp, opt.period);
+    tpSetVmax(&tp, opt.vlimit, opt.vlimit);
+    tpSetVlimit(&tp, opt.vlimit);
+    tpSetAmax(&tp, opt.acc[0]);
+    ZERO_EMC_POSE(prog_pos);
+    tpSetPos(&tp, &prog_pos);
+
+    char line[1024];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        if (handle_line(line)) {
+            fprintf(stderr, "tp_sim: can't handle line %d: %s", lineno, line);
+            return 2;
+        }
+    }
+    if (run_until_done()) {
+        return 2;
+    }
+
+    printf("segments:                 %d\n", stats.segments);
+    printf("servo cycles:             %ld\n", stats.cycles);
+    printf("machining time:           %.4f s\n", stats.cycles * opt.period);
+    printf("max path speed:           %.4f\n", stats.max_speed);
+    printf("max axis velocity:        %.4f %.4f %.4f\n",
+            stats.max_vel[0], stats.max_vel[1], stats.max_vel[2]);
+    printf("max axis acceleration:    %.4f %.4f %.4f\n",
+            stats.max_acc[0], stats.max_acc[1], stats.max_acc[2]);
+    printf("max path jerk:            %.4f\n", stats.max_jerk);
+    printf("velocity violations:      %ld\n", stats.vel_violations);
+    printf("acceleration violations:  %ld\n", stats.acc_violations);
+    printf("jerk violations:          %ld\n", stats.jerk_violations);
+    printf("tpRunCycle:               %.0f ns mean, %.0f ns max\n",
+            stats.cycles ? stats.run_ns / stats.cycles : 0.0, stats.max_ns);
+
+    if (trace) {
+        fclose(trace);
+    }
+    free(tc_space);
+    free(syncdio_space);
+    return (stats.vel_violations || stats.acc_violations ||
+            stats.jerk_violations) ? 1 : 0;
+}